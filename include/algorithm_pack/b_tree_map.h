@@ -0,0 +1,588 @@
+﻿#ifndef ALGORITHM_PACK_B_TREE_MAP_H
+#define ALGORITHM_PACK_B_TREE_MAP_H
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace alpa {
+/**
+ * @brief Realization of the B+ tree based ordered map with integer keys.
+ *
+ * Alternative to the Treap for integer keys, which provides the same
+ * Insert/Find/Erase interface. Each node stores up to `kNodeCapacity` sorted
+ * keys in a contiguous array, so a lookup touches O(log_b n) nodes instead of
+ * O(log n). Position inside a node is found without branches by counting keys
+ * which are less than the searched one. When the target supports it, the count
+ * is computed with AVX2 or SSE compares, otherwise a scalar loop is used.
+ * Values are stored only in leaves, leaves are linked in the key order.
+ *
+ * @tparam K integer key type.
+ * @tparam V value type. Has to be default constructible and move assignable.
+ * @tparam kNodeCapacity maximum number of keys in a node. Has to be a multiple
+ * of 8.
+ */
+template <typename K, typename V, size_t kNodeCapacity = 32>
+class BTreeMap {
+  static_assert(std::is_integral_v<K>, "Keys have to be integers");
+  static_assert(kNodeCapacity >= 8 && kNodeCapacity % 8 == 0,
+                "Node capacity has to be a multiple of 8");
+
+ public:
+  /**
+   * @brief Constructs an empty map.
+   */
+  BTreeMap() = default;
+  BTreeMap(const BTreeMap&) = delete;
+  BTreeMap(BTreeMap&&) = delete;
+  BTreeMap& operator=(const BTreeMap&) = delete;
+  BTreeMap& operator=(BTreeMap&&) = delete;
+  /**
+   * @brief Destroy the map object by deleting each node.
+   */
+  ~BTreeMap() { DeleteTree(root_); }
+  /**
+   * @brief Inserts given (key, value) into the map.
+   *
+   * If the given key is already present in the map, the later is unchanged.
+   * Complexity O(b log_b n), where b is the node capacity.
+   *
+   * @param key user provided key with which the value should be stored
+   * @param value value which is intended to be stored
+   *
+   * @return V* pointer to the inserted value or to the value which is already
+   * associated with the key. Cannot return nullptr. Unlike in the Treap, values
+   * are relocated when nodes are changed, therefore the pointer is valid only
+   * until the next insertion or deletion.
+   */
+  V* Insert(const K& key, const V& value) {
+    if (!root_) root_ = new Leaf();
+    Split split;
+    V* result = Insert(root_, key, value, split);
+    if (split.right) {
+      auto* new_root = new Inner();
+      new_root->keys[0] = split.key;
+      new_root->size = 1;
+      new_root->children[0] = root_;
+      new_root->children[1] = split.right;
+      root_ = new_root;
+    }
+    return result;
+  }
+  /**
+   * @brief Removes the key and associated value from the map.
+   *
+   * If there is no key equivalent to the given one the map will not be
+   * changed. Complexity O(b log_b n).
+   *
+   * @return true if the equivalent key was found in the map and it was
+   * deleted, false otherwise.
+   */
+  bool Erase(const K& key) {
+    if (!root_ || !Erase(root_, key)) return false;
+    --size_;
+    if (root_->size == 0) {
+      Node* old_root = root_;
+      if (old_root->is_leaf) {
+        root_ = nullptr;
+        delete static_cast<Leaf*>(old_root);
+      } else {
+        root_ = static_cast<Inner*>(old_root)->children[0];
+        delete static_cast<Inner*>(old_root);
+      }
+    }
+    return true;
+  }
+  /**
+   * @brief Searches the given key in the map. Complexity O(b log_b n).
+   *
+   * @return V* non owning pointer to the value associated with the given key.
+   * If the key is not found nullptr will be returned.
+   */
+  V* Find(const K& key) {
+    if (!root_) return nullptr;
+    Leaf* leaf = FindLeaf(key);
+    size_t pos = CountLess(leaf->keys, key);
+    if (pos < leaf->size && leaf->keys[pos] == key) return &leaf->values[pos];
+    return nullptr;
+  }
+  /**
+   * @overload
+   */
+  const V* Find(const K& key) const {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+    return const_cast<BTreeMap*>(this)->Find(key);
+  }
+  /**
+   * @brief Calls the visitor for each element with key in the range [from, to)
+   * in ascending key order. Complexity O(b log_b n + k), where k is the number
+   * of visited elements.
+   *
+   * @param visitor callable with signature `void(const K& key, V& value)`. It
+   * must not insert or erase elements.
+   */
+  template <typename Visitor>
+  void VisitRange(const K& from, const K& to, Visitor visitor) {
+    if (!root_) return;
+    Leaf* leaf = FindLeaf(from);
+    size_t pos = CountLess(leaf->keys, from);
+    for (; leaf; leaf = leaf->next, pos = 0) {
+      for (; pos < leaf->size; ++pos) {
+        const K& key = leaf->keys[pos];
+        if (!(key < to)) return;
+        visitor(key, leaf->values[pos]);
+      }
+    }
+  }
+  /**
+   * @brief Removes all elements from the map. Complexity O(n).
+   */
+  void Clear() {
+    DeleteTree(root_);
+    root_ = nullptr;
+    size_ = 0;
+  }
+  /**
+   * @brief Checks whether the map is empty or not.
+   * @return true if the map is empty, false otherwise.
+   */
+  [[nodiscard]] bool Empty() const { return root_ == nullptr; }
+  /**
+   * @brief Gets the number of elements in the map.
+   */
+  [[nodiscard]] size_t Size() const { return size_; }
+
+ private:
+  /**Value of unused key slots. It is never less than any key, so unused slots
+   * do not change the result of CountLess().*/
+  static constexpr K kPadKey = std::numeric_limits<K>::max();
+  /**Minimal number of keys in a node, except the root.*/
+  static constexpr size_t kMinSize = kNodeCapacity / 2 - 1;
+
+#if defined(__AVX2__)
+  static constexpr bool kVectorized = sizeof(K) == 4 || sizeof(K) == 8;
+  static constexpr size_t kLanes = 32 / sizeof(K);
+#elif defined(__SSE4_2__)
+  static constexpr bool kVectorized = sizeof(K) == 4 || sizeof(K) == 8;
+  static constexpr size_t kLanes = 16 / sizeof(K);
+#elif defined(__SSE2__)
+  // 64 bit compares are available only since SSE4.2
+  static constexpr bool kVectorized = sizeof(K) == 4;
+  static constexpr size_t kLanes = 16 / sizeof(K);
+#else
+  static constexpr bool kVectorized = false;
+  static constexpr size_t kLanes = 1;
+#endif
+  /**Signed integer of the key size, which is used as a vector lane.*/
+  using Lane = std::conditional_t<sizeof(K) == 4, int32_t, int64_t>;
+
+  /**
+   * @brief Base of leaf and inner nodes. Keys are sorted, slots starting from
+   * `size` are filled with kPadKey.
+   */
+  struct Node {
+    explicit Node(bool g_is_leaf) : is_leaf(g_is_leaf) { keys.fill(kPadKey); }
+
+    alignas(32) std::array<K, kNodeCapacity> keys;
+    size_t size = 0;
+    bool is_leaf;
+  };
+  /**
+   * @brief Leaf node, which stores values of its keys.
+   */
+  struct Leaf : Node {
+    Leaf() : Node(/*g_is_leaf=*/true) {}
+
+    std::array<V, kNodeCapacity> values{};
+    Leaf* next = nullptr;
+  };
+  /**
+   * @brief Inner node. All keys of the child i are not greater than keys[i]
+   * and greater than keys[i - 1].
+   */
+  struct Inner : Node {
+    Inner() : Node(/*g_is_leaf=*/false) {}
+
+    std::array<Node*, kNodeCapacity + 1> children{};
+  };
+  /**
+   * @brief Result of the node split: the largest key of the left part and the
+   * new right node, which should be added to the parent.
+   */
+  struct Split {
+    K key{};
+    Node* right = nullptr;
+  };
+  /**
+   * @brief Counts keys of the node which are less than the given key. The
+   * result is the position of the lower bound in the leaf and the index of the
+   * child to descend into in the inner node. Complexity O(b) without branches.
+   */
+  static size_t CountLess(const std::array<K, kNodeCapacity>& keys, K key) {
+    size_t count = 0;
+    if constexpr (kVectorized) {
+      // Unsigned keys are compared as signed ones after flipping the sign bit
+      const Lane bias =
+          std::is_signed_v<K> ? Lane{0} : std::numeric_limits<Lane>::min();
+      const Lane needle = ToLane(key) ^ bias;
+      for (size_t i = 0; i < kNodeCapacity; i += kLanes) {
+        count += CountLessInBlock(keys.data() + i, needle, bias);
+      }
+    } else {
+      for (const K& node_key : keys) {
+        count += static_cast<size_t>(node_key < key);
+      }
+    }
+    return count;
+  }
+  /**@brief Reinterprets the key bits as a signed lane value.*/
+  static Lane ToLane(K key) {
+    Lane lane = 0;
+    std::memcpy(&lane, &key, sizeof(K));
+    return lane;
+  }
+  /**
+   * @brief Counts keys in the block of kLanes keys which are less than the
+   * needle. Keys are xor-ed with the bias before the signed comparison.
+   */
+  static size_t CountLessInBlock([[maybe_unused]] const K* keys,
+                                 [[maybe_unused]] Lane needle,
+                                 [[maybe_unused]] Lane bias) {
+#if defined(__AVX2__)
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys));
+    if constexpr (sizeof(K) == 4) {
+      block = _mm256_xor_si256(block, _mm256_set1_epi32(bias));
+      __m256i less = _mm256_cmpgt_epi32(_mm256_set1_epi32(needle), block);
+      return PopCount(_mm256_movemask_ps(_mm256_castsi256_ps(less)));
+    } else {
+      block = _mm256_xor_si256(block, _mm256_set1_epi64x(bias));
+      __m256i less = _mm256_cmpgt_epi64(_mm256_set1_epi64x(needle), block);
+      return PopCount(_mm256_movemask_pd(_mm256_castsi256_pd(less)));
+    }
+#elif defined(__SSE2__)
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys));
+    if constexpr (sizeof(K) == 4) {
+      block = _mm_xor_si128(block, _mm_set1_epi32(bias));
+      __m128i less = _mm_cmpgt_epi32(_mm_set1_epi32(needle), block);
+      return PopCount(_mm_movemask_ps(_mm_castsi128_ps(less)));
+    } else {
+#if defined(__SSE4_2__)
+      block = _mm_xor_si128(block, _mm_set1_epi64x(bias));
+      __m128i less = _mm_cmpgt_epi64(_mm_set1_epi64x(needle), block);
+      return PopCount(_mm_movemask_pd(_mm_castsi128_pd(less)));
+#else
+      return 0;
+#endif
+    }
+#else
+    return 0;
+#endif
+  }
+  /**@brief Counts set bits in the compare mask.*/
+  static size_t PopCount(int mask) {
+    return std::bitset<32>(static_cast<unsigned>(mask)).count();
+  }
+  /**
+   * @brief Descends from the root to the leaf, which may contain the given
+   * key. Root should not be nullptr.
+   */
+  Leaf* FindLeaf(const K& key) const {
+    Node* node = root_;
+    while (!node->is_leaf) {
+      auto* inner = static_cast<Inner*>(node);
+      node = inner->children[CountLess(inner->keys, key)];
+    }
+    return static_cast<Leaf*>(node);
+  }
+  /**
+   * @brief Inserts (key, value) into the subtree of the given node.
+   *
+   * @param split filled if the node was split. In that case the caller has to
+   * add the new right node to the parent.
+   * @return V* pointer to the inserted or already present value.
+   */
+  V* Insert(Node* node, const K& key, const V& value, Split& split) {
+    if (node->is_leaf) {
+      return InsertIntoLeaf(static_cast<Leaf*>(node), key, value, split);
+    }
+    auto* inner = static_cast<Inner*>(node);
+    size_t idx = CountLess(inner->keys, key);
+    Split child_split;
+    V* result = Insert(inner->children[idx], key, value, child_split);
+    if (child_split.right) InsertIntoInner(inner, idx, child_split, split);
+    return result;
+  }
+  /**
+   * @overload
+   */
+  V* InsertIntoLeaf(Leaf* leaf, const K& key, const V& value, Split& split) {
+    size_t pos = CountLess(leaf->keys, key);
+    if (pos < leaf->size && leaf->keys[pos] == key) return &leaf->values[pos];
+    ++size_;
+    if (leaf->size < kNodeCapacity) return PutIntoLeaf(leaf, pos, key, value);
+    constexpr size_t kHalf = kNodeCapacity / 2;
+    auto* right = new Leaf();
+    std::move(leaf->keys.begin() + kHalf, leaf->keys.end(),
+              right->keys.begin());
+    std::move(leaf->values.begin() + kHalf, leaf->values.end(),
+              right->values.begin());
+    std::fill(leaf->keys.begin() + kHalf, leaf->keys.end(), kPadKey);
+    std::fill(leaf->values.begin() + kHalf, leaf->values.end(), V{});
+    right->size = kNodeCapacity - kHalf;
+    leaf->size = kHalf;
+    right->next = leaf->next;
+    leaf->next = right;
+    split.key = leaf->keys[kHalf - 1];
+    split.right = right;
+    // The left part must not receive keys greater than the separator
+    if (pos < kHalf) return PutIntoLeaf(leaf, pos, key, value);
+    return PutIntoLeaf(right, pos - kHalf, key, value);
+  }
+  /**
+   * @brief Puts (key, value) into the given position of the non full leaf.
+   */
+  static V* PutIntoLeaf(Leaf* leaf, size_t pos, const K& key, const V& value) {
+    assert(leaf->size < kNodeCapacity);
+    std::move_backward(leaf->keys.begin() + pos,
+                       leaf->keys.begin() + leaf->size,
+                       leaf->keys.begin() + leaf->size + 1);
+    std::move_backward(leaf->values.begin() + pos,
+                       leaf->values.begin() + leaf->size,
+                       leaf->values.begin() + leaf->size + 1);
+    leaf->keys[pos] = key;
+    leaf->values[pos] = value;
+    ++leaf->size;
+    return &leaf->values[pos];
+  }
+  /**
+   * @brief Adds the split result of the child `idx` to the inner node. If the
+   * node is full, it is split in turn and `split` is filled.
+   */
+  static void InsertIntoInner(Inner* inner, size_t idx,
+                              const Split& child_split, Split& split) {
+    if (inner->size < kNodeCapacity) {
+      std::move_backward(inner->keys.begin() + idx,
+                         inner->keys.begin() + inner->size,
+                         inner->keys.begin() + inner->size + 1);
+      std::move_backward(inner->children.begin() + idx + 1,
+                         inner->children.begin() + inner->size + 1,
+                         inner->children.begin() + inner->size + 2);
+      inner->keys[idx] = child_split.key;
+      inner->children[idx + 1] = child_split.right;
+      ++inner->size;
+      return;
+    }
+    std::array<K, kNodeCapacity + 1> keys;
+    std::array<Node*, kNodeCapacity + 2> children;
+    std::copy(inner->keys.begin(), inner->keys.begin() + idx, keys.begin());
+    keys[idx] = child_split.key;
+    std::copy(inner->keys.begin() + idx, inner->keys.end(),
+              keys.begin() + idx + 1);
+    std::copy(inner->children.begin(), inner->children.begin() + idx + 1,
+              children.begin());
+    children[idx + 1] = child_split.right;
+    std::copy(inner->children.begin() + idx + 1, inner->children.end(),
+              children.begin() + idx + 2);
+    // keys[kMid] goes to the parent
+    constexpr size_t kMid = (kNodeCapacity + 1) / 2;
+    auto* right = new Inner();
+    std::copy(keys.begin(), keys.begin() + kMid, inner->keys.begin());
+    std::fill(inner->keys.begin() + kMid, inner->keys.end(), kPadKey);
+    std::copy(children.begin(), children.begin() + kMid + 1,
+              inner->children.begin());
+    std::fill(inner->children.begin() + kMid + 1, inner->children.end(),
+              nullptr);
+    inner->size = kMid;
+    std::copy(keys.begin() + kMid + 1, keys.end(), right->keys.begin());
+    std::copy(children.begin() + kMid + 1, children.end(),
+              right->children.begin());
+    right->size = kNodeCapacity - kMid;
+    split.key = keys[kMid];
+    split.right = right;
+  }
+  /**
+   * @brief Removes the key from the subtree of the given node. Children which
+   * become smaller than kMinSize are rebalanced, the node itself may become
+   * smaller and has to be fixed by the caller.
+   *
+   * @return true if the key was found and removed.
+   */
+  bool Erase(Node* node, const K& key) {
+    if (node->is_leaf) {
+      auto* leaf = static_cast<Leaf*>(node);
+      size_t pos = CountLess(leaf->keys, key);
+      if (pos >= leaf->size || leaf->keys[pos] != key) return false;
+      EraseFromLeaf(leaf, pos);
+      return true;
+    }
+    auto* inner = static_cast<Inner*>(node);
+    size_t idx = CountLess(inner->keys, key);
+    if (!Erase(inner->children[idx], key)) return false;
+    if (inner->children[idx]->size < kMinSize) Rebalance(inner, idx);
+    return true;
+  }
+  /**
+   * @brief Removes the element in the given position of the leaf.
+   */
+  static void EraseFromLeaf(Leaf* leaf, size_t pos) {
+    std::move(leaf->keys.begin() + pos + 1, leaf->keys.begin() + leaf->size,
+              leaf->keys.begin() + pos);
+    std::move(leaf->values.begin() + pos + 1,
+              leaf->values.begin() + leaf->size, leaf->values.begin() + pos);
+    --leaf->size;
+    leaf->keys[leaf->size] = kPadKey;
+    leaf->values[leaf->size] = V{};
+  }
+  /**
+   * @brief Fixes the child `idx` of the inner node, which has less than
+   * kMinSize keys, by borrowing a key from a sibling or merging with it.
+   */
+  static void Rebalance(Inner* parent, size_t idx) {
+    if (idx > 0 && parent->children[idx - 1]->size > kMinSize) {
+      BorrowFromLeft(parent, idx);
+    } else if (idx < parent->size &&
+               parent->children[idx + 1]->size > kMinSize) {
+      BorrowFromRight(parent, idx);
+    } else {
+      MergeChildren(parent, idx > 0 ? idx - 1 : idx);
+    }
+  }
+  /**
+   * @brief Moves the last key of the child `idx - 1` to the child `idx`.
+   */
+  static void BorrowFromLeft(Inner* parent, size_t idx) {
+    Node* left = parent->children[idx - 1];
+    Node* child = parent->children[idx];
+    std::move_backward(child->keys.begin(),
+                       child->keys.begin() + child->size,
+                       child->keys.begin() + child->size + 1);
+    if (child->is_leaf) {
+      auto* left_leaf = static_cast<Leaf*>(left);
+      auto* child_leaf = static_cast<Leaf*>(child);
+      std::move_backward(child_leaf->values.begin(),
+                         child_leaf->values.begin() + child->size,
+                         child_leaf->values.begin() + child->size + 1);
+      child->keys[0] = left->keys[left->size - 1];
+      child_leaf->values[0] = std::move(left_leaf->values[left->size - 1]);
+      left_leaf->values[left->size - 1] = V{};
+      parent->keys[idx - 1] = left->keys[left->size - 2];
+    } else {
+      auto* left_inner = static_cast<Inner*>(left);
+      auto* child_inner = static_cast<Inner*>(child);
+      std::move_backward(child_inner->children.begin(),
+                         child_inner->children.begin() + child->size + 1,
+                         child_inner->children.begin() + child->size + 2);
+      child->keys[0] = parent->keys[idx - 1];
+      child_inner->children[0] = left_inner->children[left->size];
+      left_inner->children[left->size] = nullptr;
+      parent->keys[idx - 1] = left->keys[left->size - 1];
+    }
+    ++child->size;
+    --left->size;
+    left->keys[left->size] = kPadKey;
+  }
+  /**
+   * @brief Moves the first key of the child `idx + 1` to the child `idx`.
+   */
+  static void BorrowFromRight(Inner* parent, size_t idx) {
+    Node* child = parent->children[idx];
+    Node* right = parent->children[idx + 1];
+    if (child->is_leaf) {
+      auto* child_leaf = static_cast<Leaf*>(child);
+      auto* right_leaf = static_cast<Leaf*>(right);
+      child->keys[child->size] = right->keys[0];
+      child_leaf->values[child->size] = std::move(right_leaf->values[0]);
+      ++child->size;
+      EraseFromLeaf(right_leaf, 0);
+      parent->keys[idx] = child->keys[child->size - 1];
+    } else {
+      auto* child_inner = static_cast<Inner*>(child);
+      auto* right_inner = static_cast<Inner*>(right);
+      child->keys[child->size] = parent->keys[idx];
+      child_inner->children[child->size + 1] = right_inner->children[0];
+      ++child->size;
+      parent->keys[idx] = right->keys[0];
+      std::move(right->keys.begin() + 1, right->keys.begin() + right->size,
+                right->keys.begin());
+      std::move(right_inner->children.begin() + 1,
+                right_inner->children.begin() + right->size + 1,
+                right_inner->children.begin());
+      right_inner->children[right->size] = nullptr;
+      --right->size;
+      right->keys[right->size] = kPadKey;
+    }
+  }
+  /**
+   * @brief Merges the child `idx + 1` into the child `idx` and removes the
+   * separator between them from the parent.
+   */
+  static void MergeChildren(Inner* parent, size_t idx) {
+    Node* left = parent->children[idx];
+    Node* right = parent->children[idx + 1];
+    if (left->is_leaf) {
+      auto* left_leaf = static_cast<Leaf*>(left);
+      auto* right_leaf = static_cast<Leaf*>(right);
+      std::move(right->keys.begin(), right->keys.begin() + right->size,
+                left->keys.begin() + left->size);
+      std::move(right_leaf->values.begin(),
+                right_leaf->values.begin() + right->size,
+                left_leaf->values.begin() + left->size);
+      left->size += right->size;
+      left_leaf->next = right_leaf->next;
+      delete right_leaf;
+    } else {
+      auto* left_inner = static_cast<Inner*>(left);
+      auto* right_inner = static_cast<Inner*>(right);
+      left->keys[left->size] = parent->keys[idx];
+      std::move(right->keys.begin(), right->keys.begin() + right->size,
+                left->keys.begin() + left->size + 1);
+      std::move(right_inner->children.begin(),
+                right_inner->children.begin() + right->size + 1,
+                left_inner->children.begin() + left->size + 1);
+      left->size += right->size + 1;
+      delete right_inner;
+    }
+    std::move(parent->keys.begin() + idx + 1,
+              parent->keys.begin() + parent->size, parent->keys.begin() + idx);
+    std::move(parent->children.begin() + idx + 2,
+              parent->children.begin() + parent->size + 1,
+              parent->children.begin() + idx + 1);
+    parent->children[parent->size] = nullptr;
+    --parent->size;
+    parent->keys[parent->size] = kPadKey;
+  }
+  /**
+   * @brief Deletes all nodes in the tree with the given root. Complexity O(n).
+   * @param root root of tree to be deleted. Can be nullptr.
+   */
+  static void DeleteTree(Node* root) {
+    if (!root) return;
+    if (root->is_leaf) {
+      delete static_cast<Leaf*>(root);
+      return;
+    }
+    auto* inner = static_cast<Inner*>(root);
+    for (size_t i = 0; i <= inner->size; ++i) {
+      DeleteTree(inner->children[i]);
+    }
+    delete inner;
+  }
+
+  Node* root_ = nullptr;
+  size_t size_ = 0;
+};
+}  // namespace alpa
+#endif  // ALGORITHM_PACK_B_TREE_MAP_H
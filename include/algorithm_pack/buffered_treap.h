@@ -0,0 +1,155 @@
+﻿#ifndef ALGORITHM_PACK_BUFFERED_TREAP_H
+#define ALGORITHM_PACK_BUFFERED_TREAP_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "algorithm_pack/treap.h"
+
+namespace alpa {
+/**
+ * @brief Write-optimized treap for bursty ingest.
+ *
+ * Insertions and erasures are appended to an unsorted buffer. When the buffer
+ * is full it is sorted, operations on the same key are collapsed and the
+ * result is applied to the underlying Treap by batch erase and batch union.
+ * Therefore ingest of m elements costs a sort plus O(m log(n / m + 1)) instead
+ * of m random descents. Lookups consult both the buffer and the tree, so their
+ * latency is bounded by O(buffer capacity + log n).
+ *
+ * Semantics of the operations are the same as for Treap: insertion of an
+ * existing key keeps the old value.
+ *
+ * @tparam K type of keys, has to determine `operator<()`.
+ * @tparam V type of values.
+ */
+template <typename K, typename V>
+class BufferedTreap {
+ public:
+  /**
+   * @brief Creates an empty treap.
+   *
+   * @param buffer_capacity number of buffered operations, which triggers
+   * merging of the buffer into the tree.
+   * @param seed will be set in the random generator of the tree.
+   */
+  BufferedTreap(size_t buffer_capacity, uint64_t seed)
+      : buffer_capacity_(std::max<size_t>(buffer_capacity, 1)), tree_(seed) {
+    buffer_.reserve(buffer_capacity_);
+  }
+  BufferedTreap(const BufferedTreap&) = delete;
+  BufferedTreap(BufferedTreap&&) = delete;
+  BufferedTreap& operator=(const BufferedTreap&) = delete;
+  BufferedTreap& operator=(BufferedTreap&&) = delete;
+  ~BufferedTreap() = default;
+  /**
+   * @brief Buffers insertion of the key and value. If the key is already in
+   * the treap its value is kept. Amortized complexity is the cost of sorting
+   * plus O(log(n / m + 1)) per operation, where m is the buffer capacity.
+   */
+  void Insert(const K& key, const V& value) {
+    buffer_.push_back(Operation{key, value});
+    if (buffer_.size() >= buffer_capacity_) Flush();
+  }
+  /**
+   * @brief Buffers erasure of the key. Absent key is ignored. Amortized
+   * complexity is the same as for Insert().
+   */
+  void Erase(const K& key) {
+    buffer_.push_back(Operation{key, std::nullopt});
+    if (buffer_.size() >= buffer_capacity_) Flush();
+  }
+  /**
+   * @brief Searches the given key in the buffer and in the tree. Complexity
+   * O(buffer capacity + log n).
+   *
+   * @return V* non owning pointer to the value associated with the given key,
+   * which is valid until the next modification. If the key is not found
+   * nullptr will be returned.
+   */
+  V* Find(const K& key) {
+    V* result = tree_.Find(key);
+    // Operations are replayed in order, the first insertion after the last
+    // erasure wins
+    for (auto& operation : buffer_) {
+      if (operation.key < key || key < operation.key) continue;
+      if (!operation.value) {
+        result = nullptr;
+      } else if (!result) {
+        result = &*operation.value;
+      }
+    }
+    return result;
+  }
+  /**
+   * @brief Merges buffered operations into the tree.
+   */
+  void Flush() {
+    if (buffer_.empty()) return;
+    std::stable_sort(buffer_.begin(), buffer_.end(),
+                     [](const Operation& lhs, const Operation& rhs) {
+                       return lhs.key < rhs.key;
+                     });
+    std::vector<K> erased;
+    std::vector<std::pair<K, V>> inserted;
+    for (auto group = buffer_.begin(); group != buffer_.end();) {
+      auto group_end = std::find_if(group, buffer_.end(),
+                                    [&group](const Operation& operation) {
+                                      return group->key < operation.key;
+                                    });
+      // Only the operations after the last erasure matter
+      auto last_erase = std::find_if(
+          std::make_reverse_iterator(group_end),
+          std::make_reverse_iterator(group),
+          [](const Operation& operation) { return !operation.value; });
+      auto first_insert = last_erase.base();
+      if (first_insert != group) erased.push_back(group->key);
+      if (first_insert != group_end) {
+        inserted.emplace_back(std::move(first_insert->key),
+                              std::move(*first_insert->value));
+      }
+      group = group_end;
+    }
+    buffer_.clear();
+    tree_.EraseSorted(erased.begin(), erased.end());
+    tree_.InsertSorted(inserted.begin(), inserted.end());
+  }
+  /**
+   * @brief Checks whether the treap is empty or not. Flushes the buffer.
+   * @return true if the treap is empty, false otherwise.
+   */
+  [[nodiscard]] bool Empty() {
+    Flush();
+    return tree_.Empty();
+  }
+  /**
+   * @brief Gets the number of elements in the treap. Flushes the buffer.
+   */
+  [[nodiscard]] size_t Size() {
+    Flush();
+    return tree_.Size();
+  }
+  /**
+   * @brief Gets the number of buffered operations.
+   */
+  [[nodiscard]] size_t BufferedCount() const { return buffer_.size(); }
+
+ private:
+  /**
+   * @brief Buffered operation, erasure has no value.
+   */
+  struct Operation {
+    K key;
+    std::optional<V> value;
+  };
+
+  size_t buffer_capacity_;
+  std::vector<Operation> buffer_;
+  Treap<K, V> tree_;
+};
+}  // namespace alpa
+#endif  // ALGORITHM_PACK_BUFFERED_TREAP_H
@@ -0,0 +1,218 @@
+﻿#ifndef ALGORITHM_PACK_EDIT_HISTORY_H
+#define ALGORITHM_PACK_EDIT_HISTORY_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include "algorithm_pack/implicit_treap.h"
+
+namespace alpa {
+/**
+ * @brief Document stored in ImplicitTreap with undo and redo of range edits.
+ *
+ * Every edit replaces a range of the document by new content. Removed
+ * elements are not copied, they are kept as the subtree detached by
+ * ImplicitTreap::Extract() together with the position of the edit and the
+ * length of the inserted content. Undo extracts the inserted content and puts
+ * the removed subtree back, redo does the same in the opposite direction. So
+ * each step costs a constant number of splits and merges, O(log n), regardless
+ * of the edit length.
+ *
+ * Small edits which continue the previous one, for example typing or
+ * deleting characters one by one, are coalesced into a single step until
+ * the step reaches the coalescing limit or Seal() is called. Total number of
+ * elements kept by the undo steps is limited, the oldest steps are dropped
+ * when the limit is exceeded.
+ *
+ * @tparam T type of document elements.
+ * @tparam Hash optional element hasher of the ImplicitTreap.
+ * @tparam Priority priority policy of the ImplicitTreap.
+ */
+template <typename T, typename Hash = void,
+          typename Priority = RandomPriority>
+class EditHistory {
+ public:
+  using Document = ImplicitTreap<T, Hash, Priority>;
+  /**
+   * @brief Creates history of the given document.
+   *
+   * @param document initial content, which cannot be undone.
+   * @param max_kept_elements maximal total number of removed elements kept by
+   * the undo steps. The latest step is kept even if it exceeds the limit.
+   * @param coalesce_limit maximal number of elements inserted or removed by a
+   * coalesced step, 0 disables coalescing.
+   */
+  EditHistory(Document&& document, size_t max_kept_elements,
+              size_t coalesce_limit)
+      : document_(std::move(document)),
+        max_kept_elements_(max_kept_elements),
+        coalesce_limit_(coalesce_limit) {}
+  EditHistory(const EditHistory&) = delete;
+  EditHistory(EditHistory&&) = delete;
+  EditHistory& operator=(const EditHistory&) = delete;
+  EditHistory& operator=(EditHistory&&) = delete;
+  ~EditHistory() = default;
+  /**
+   * @brief Replaces elements in the range [start_pos, end_pos) by the given
+   * content. Clears redo steps. Complexity O(log n).
+   */
+  void Replace(size_t start_pos, size_t end_pos, Document&& content) {
+    assert(start_pos <= end_pos && end_pos <= document_.Size());
+    size_t inserted = content.Size();
+    if (start_pos == end_pos && inserted == 0) return;
+    Document removed = document_.Extract(start_pos, end_pos);
+    document_.Insert(std::move(content), start_pos);
+    redo_.clear();
+    if (!TryCoalesce(start_pos, end_pos, inserted, removed)) {
+      kept_elements_ += removed.Size();
+      undo_.push_back(Step{start_pos, inserted, std::move(removed)});
+    }
+    DropOldSteps();
+  }
+  /**
+   * @brief Inserts the given content at the given position. Complexity
+   * O(log n).
+   */
+  void Insert(size_t pos, Document&& content) {
+    Replace(pos, pos, std::move(content));
+  }
+  /**
+   * @overload
+   */
+  void Insert(size_t pos, const T& value) {
+    Document content;
+    content.PushBack(value);
+    Replace(pos, pos, std::move(content));
+  }
+  /**
+   * @brief Erases elements in the range [start_pos, end_pos). Complexity
+   * O(log n).
+   */
+  void Erase(size_t start_pos, size_t end_pos) {
+    Replace(start_pos, end_pos, Document{});
+  }
+  /**
+   * @brief Reverts the latest edit. Complexity O(log n).
+   * @return true if there was an edit to revert, false otherwise.
+   */
+  bool Undo() {
+    if (undo_.empty()) return false;
+    Step step = std::move(undo_.back());
+    undo_.pop_back();
+    kept_elements_ -= step.stored.Size();
+    Swap(step);
+    redo_.push_back(std::move(step));
+    coalescing_ = false;
+    return true;
+  }
+  /**
+   * @brief Applies again the latest reverted edit. Complexity O(log n).
+   * @return true if there was an edit to apply, false otherwise.
+   */
+  bool Redo() {
+    if (redo_.empty()) return false;
+    Step step = std::move(redo_.back());
+    redo_.pop_back();
+    Swap(step);
+    kept_elements_ += step.stored.Size();
+    undo_.push_back(std::move(step));
+    coalescing_ = false;
+    DropOldSteps();
+    return true;
+  }
+  /**
+   * @brief Stops coalescing of the next edit with the previous one, for
+   * example when the cursor is moved.
+   */
+  void Seal() { coalescing_ = false; }
+  [[nodiscard]] const Document& GetDocument() const { return document_; }
+  [[nodiscard]] size_t UndoCount() const { return undo_.size(); }
+  [[nodiscard]] size_t RedoCount() const { return redo_.size(); }
+  /**
+   * @brief Gets the number of removed elements kept by the undo steps.
+   */
+  [[nodiscard]] size_t KeptElements() const { return kept_elements_; }
+
+ private:
+  /**
+   * @brief Reversible edit: range [pos, pos + present) of the document
+   * replaced the stored elements. Undo and redo swap them.
+   */
+  struct Step {
+    size_t pos;
+    size_t present;
+    Document stored;
+  };
+
+  /**
+   * @brief Exchanges the present range of the step and its stored elements.
+   */
+  void Swap(Step& step) {
+    Document present = document_.Extract(step.pos, step.pos + step.present);
+    step.present = step.stored.Size();
+    document_.Insert(std::move(step.stored), step.pos);
+    step.stored = std::move(present);
+  }
+  /**
+   * @brief Merges the edit into the latest step if it is a pure insertion or
+   * a pure erasure adjacent to the step of the same kind.
+   * @return true if the edit was merged, false otherwise.
+   */
+  bool TryCoalesce(size_t start_pos, size_t end_pos, size_t inserted,
+                   Document& removed) {
+    bool can_coalesce = coalescing_ && !undo_.empty() &&
+                        (inserted == 0) != (start_pos == end_pos);
+    coalescing_ = coalesce_limit_ > 0;
+    if (!can_coalesce) return false;
+    Step& last = undo_.back();
+    if (inserted > 0) {
+      // Typing continues right after the previous insertion
+      if (!last.stored.Empty() || start_pos != last.pos + last.present ||
+          last.present + inserted > coalesce_limit_) {
+        return false;
+      }
+      last.present += inserted;
+      return true;
+    }
+    if (last.present != 0 || (end_pos != last.pos && start_pos != last.pos) ||
+        last.stored.Size() + removed.Size() > coalesce_limit_) {
+      return false;
+    }
+    kept_elements_ += removed.Size();
+    if (end_pos == last.pos) {
+      // Backward deletion precedes the previously removed elements
+      last.pos = start_pos;
+      removed.Concatenate(std::move(last.stored));
+      last.stored = std::move(removed);
+    } else {
+      // Forward deletion follows them
+      last.stored.Concatenate(std::move(removed));
+    }
+    return true;
+  }
+  /**
+   * @brief Drops the oldest undo steps while the kept elements exceed the
+   * limit.
+   */
+  void DropOldSteps() {
+    while (kept_elements_ > max_kept_elements_ && undo_.size() > 1) {
+      kept_elements_ -= undo_.front().stored.Size();
+      undo_.pop_front();
+    }
+  }
+
+  Document document_;
+  size_t max_kept_elements_;
+  size_t coalesce_limit_;
+  size_t kept_elements_ = 0;
+  /**True if the next edit may be merged into the latest undo step.*/
+  bool coalescing_ = false;
+  std::deque<Step> undo_;
+  std::vector<Step> redo_;
+};
+}  // namespace alpa
+#endif  // ALGORITHM_PACK_EDIT_HISTORY_H
@@ -0,0 +1,219 @@
+﻿#ifndef ALGORITHM_PACK_EULER_TOUR_FOREST_H
+#define ALGORITHM_PACK_EULER_TOUR_FOREST_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "algorithm_pack/random.h"
+#include "algorithm_pack/treap_core.h"
+
+namespace alpa {
+/**
+ * @brief Realization of the Euler-tour tree for dynamic forest connectivity.
+ *
+ * Each tree of the forest is stored as its Euler tour in a treap with an
+ * implicit key, which is split and merged by the same TreapCore as
+ * ImplicitTreap. The tour contains a single occurrence for each vertex and two
+ * occurrences (one per direction) for each edge, so a tour of s vertices has
+ * 3s - 2 occurrences and sizes are found from occurrence numbers. Occurrence
+ * nodes keep parent pointers, therefore the tour an occurrence belongs to and
+ * its position inside the tour are found by walking up to the treap root.
+ * Link, Cut, Connected and size queries have expected O(log n) complexity.
+ * Vertices are numbered from 0 to VertexCount() - 1.
+ */
+class EulerTourForest {
+ public:
+  /**
+   * @brief Creates the forest with the given number of isolated vertices.
+   *
+   * @param vertex_count number of vertices in the forest.
+   */
+  explicit EulerTourForest(size_t vertex_count)
+      : EulerTourForest(vertex_count, SplitMix64{}()) {}
+  /**
+   * @brief Creates the forest with the given number of isolated vertices and
+   * initializes random generator, which provides priorities, with the given
+   * seed.
+   *
+   * @param vertex_count number of vertices in the forest.
+   * @param seed will be set in the random generator.
+   */
+  EulerTourForest(size_t vertex_count, uint64_t seed) : rnd_(seed) {
+    vertices_.reserve(vertex_count);
+    for (size_t i = 0; i < vertex_count; ++i) {
+      vertices_.emplace_back(/*g_priority=*/rnd_());
+    }
+  }
+  EulerTourForest(const EulerTourForest&) = delete;
+  EulerTourForest(EulerTourForest&&) = delete;
+  EulerTourForest& operator=(const EulerTourForest&) = delete;
+  EulerTourForest& operator=(EulerTourForest&&) = delete;
+  /**
+   * @brief Destroys the forest by deleting all edge occurrences.
+   */
+  ~EulerTourForest() {
+    for (auto& [arc, node] : arcs_) {
+      delete node;
+    }
+  }
+  /**@brief Gets the number of vertices in the forest.*/
+  [[nodiscard]] size_t VertexCount() const { return vertices_.size(); }
+  /**@brief Gets the number of edges in the forest.*/
+  [[nodiscard]] size_t EdgeCount() const { return arcs_.size() / 2; }
+  /**
+   * @brief Checks whether the edge between two given vertices is present in
+   * the forest. Complexity O(log m), where m is the number of edges.
+   */
+  [[nodiscard]] bool HasEdge(size_t u, size_t v) const {
+    return arcs_.find({u, v}) != arcs_.end();
+  }
+  /**
+   * @brief Connects two vertices from different trees with an edge.
+   * Complexity O(log n).
+   *
+   * @param u the first vertex of the new edge.
+   * @param v the second vertex of the new edge.
+   * @return true if the edge was added, false if vertices already belong to
+   * the same tree, so the edge would create a cycle.
+   */
+  bool Link(size_t u, size_t v) {
+    assert(u < VertexCount() && v < VertexCount());
+    if (Connected(u, v)) return false;
+    Node* forward = new Node(rnd_());
+    Node* backward = new Node(rnd_());
+    arcs_.emplace(std::make_pair(u, v), forward);
+    arcs_.emplace(std::make_pair(v, u), backward);
+    Node* u_tour = Reroot(&vertices_[u]);
+    Node* v_tour = Reroot(&vertices_[v]);
+    Core::Merge(Core::Merge(u_tour, forward), Core::Merge(v_tour, backward));
+    return true;
+  }
+  /**
+   * @brief Removes the edge between two given vertices, splitting their tree
+   * in two. Complexity O(log n).
+   *
+   * @return true if the edge was removed, false if there was no such edge.
+   */
+  bool Cut(size_t u, size_t v) {
+    auto forward_it = arcs_.find({u, v});
+    if (forward_it == arcs_.end()) return false;
+    auto backward_it = arcs_.find({v, u});
+    assert(backward_it != arcs_.end());
+    Node* first = forward_it->second;
+    Node* second = backward_it->second;
+    size_t first_number = Core::GetElementNumber(first);
+    size_t second_number = Core::GetElementNumber(second);
+    if (first_number > second_number) {
+      std::swap(first, second);
+      std::swap(first_number, second_number);
+    }
+    // Tour looks like: before, first, inside, second, after
+    auto [before, from_first] =
+        Core::Split(first_number, Core::FindRoot(first));
+    auto [with_first, from_second] =
+        Core::Split(second_number - first_number + 1, from_first);
+    // `inside` is the tour of the detached tree and remains on its own
+    Core::Split(/*el_number=*/2, with_first);
+    Node* after = Core::Split(/*el_number=*/2, from_second).second;
+    Core::Merge(before, after);
+    delete first;
+    delete second;
+    arcs_.erase(forward_it);
+    arcs_.erase(backward_it);
+    return true;
+  }
+  /**
+   * @brief Checks whether two vertices belong to the same tree.
+   * Complexity O(log n).
+   */
+  [[nodiscard]] bool Connected(size_t u, size_t v) const {
+    assert(u < VertexCount() && v < VertexCount());
+    return Core::FindRoot(&vertices_[u]) == Core::FindRoot(&vertices_[v]);
+  }
+  /**
+   * @brief Gets the number of vertices in the tree, which contains the given
+   * vertex. Complexity O(log n).
+   */
+  [[nodiscard]] size_t ComponentSize(size_t v) const {
+    assert(v < VertexCount());
+    return CountVertices(Core::FindRoot(&vertices_[v])->tree_size);
+  }
+  /**
+   * @brief Gets the size of the subtree of the vertex `v`, when its tree is
+   * rooted in a way that `parent` is the parent of `v`. Complexity O(log n).
+   *
+   * In other words, method returns the number of vertices which will remain
+   * connected to `v` after the edge (v, parent) is cut.
+   * @warning The edge (v, parent) has to be present in the forest.
+   */
+  [[nodiscard]] size_t SubtreeSize(size_t v, size_t parent) const {
+    auto down_it = arcs_.find({parent, v});
+    auto up_it = arcs_.find({v, parent});
+    assert(down_it != arcs_.end() && up_it != arcs_.end());
+    size_t down_number = Core::GetElementNumber(down_it->second);
+    size_t up_number = Core::GetElementNumber(up_it->second);
+    if (down_number < up_number) {
+      return CountVertices(up_number - down_number - 1);
+    }
+    // Tour is rooted inside the subtree of `v`, hence everything between the
+    // two arcs belongs to the `parent` side
+    return ComponentSize(v) - CountVertices(down_number - up_number - 1);
+  }
+
+ private:
+  /**
+   * @brief Describes single occurrence in the Euler tour, either of a vertex
+   * or of an arc.
+   */
+  struct Node {
+    explicit Node(uint64_t g_priority) : priority(g_priority) {}
+
+    Node* left = nullptr;
+    Node* right = nullptr;
+    Node* parent = nullptr;
+    /**Number of occurrences in this node subtree, including itself.*/
+    size_t tree_size = 1;
+    uint64_t priority = 0;
+  };
+  /**
+   * @brief Adapts the occurrence node to the split and merge core.
+   */
+  struct CoreTraits {
+    static uint64_t GetPriority(const Node* node) { return node->priority; }
+    static void Update(Node* node) {
+      node->tree_size =
+          Core::GetTreeSize(node->left) + Core::GetTreeSize(node->right) + 1;
+    }
+  };
+  using Core = TreapCore<Node, CoreTraits>;
+  /**
+   * @brief Gets the number of vertices in a tour part, which is the whole
+   * tour of a tree with the given number of occurrences.
+   */
+  static size_t CountVertices(size_t occurrences) {
+    return (occurrences + 2) / 3;
+  }
+  /**
+   * @brief Rotates the tour containing the given vertex occurrence, so that
+   * this occurrence becomes the first one. Complexity O(log n).
+   *
+   * @return Node* root of the rotated tour.
+   */
+  static Node* Reroot(Node* vertex) {
+    auto [before, from_vertex] =
+        Core::Split(Core::GetElementNumber(vertex), Core::FindRoot(vertex));
+    return Core::Merge(from_vertex, before);
+  }
+
+  SplitMix64 rnd_;
+  std::vector<Node> vertices_;
+  std::map<std::pair<size_t, size_t>, Node*> arcs_;
+};
+
+}  // namespace alpa
+
+#endif  // ALGORITHM_PACK_EULER_TOUR_FOREST_H
@@ -0,0 +1,662 @@
+﻿#ifndef ALGORITHM_PACK_EXTERNAL_TREAP_H
+#define ALGORITHM_PACK_EXTERNAL_TREAP_H
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "algorithm_pack/random.h"
+
+namespace alpa {
+/**
+ * @brief Disk-backed treap for indexes, which do not fit into memory.
+ *
+ * Nodes are stored in fixed size pages of a local file. New node is placed
+ * into the page of its parent while the page has free slots, otherwise into a
+ * fresh page, where its descendants will be placed as well. Therefore each
+ * page holds a connected part of the tree covering several levels and a
+ * search from the root reads about log(n) / log(slots per page) pages.
+ * Insertions into full pages and erasures spoil the clustering over time,
+ * Compact() rewrites the file restoring it. Recently used pages are kept in
+ * memory by the LRU buffer pool, pages are read and written back by
+ * `pread()`/`pwrite()`. Available only on POSIX systems.
+ *
+ * File errors are reported by `std::system_error`. Changes reach the file when
+ * the page is evicted from the pool or when Flush() is called. Destructor
+ * flushes the pool too, but ignores errors.
+ *
+ * @tparam K type of keys, has to be trivially copyable and to determine
+ * `operator<()`.
+ * @tparam V type of values, has to be trivially copyable.
+ * @tparam kPageSize size of the page in bytes.
+ */
+template <typename K, typename V, size_t kPageSize = 4096>
+class ExternalTreap {
+  static_assert(std::is_trivially_copyable_v<K> &&
+                    std::is_trivially_copyable_v<V>,
+                "Keys and values are stored on disk as raw bytes");
+
+ public:
+  /**
+   * @brief Counters of the buffer pool activity.
+   */
+  struct IoStats {
+    /**Number of pages read from the file.*/
+    uint64_t page_reads = 0;
+    /**Number of pages written to the file.*/
+    uint64_t page_writes = 0;
+    /**Number of page accesses served by the buffer pool.*/
+    uint64_t pool_hits = 0;
+  };
+  /**
+   * @brief Opens the treap stored in the given file or creates a new one if
+   * the file is empty or does not exist.
+   *
+   * @param path path to the file.
+   * @param pool_pages number of pages kept in memory, at least one.
+   * @param seed will be set in the random generator.
+   * @throw std::system_error if the file cannot be opened or read, or it
+   * contains treap with different key, value or page size.
+   */
+  ExternalTreap(const std::string& path, size_t pool_pages, uint64_t seed)
+      : path_(path), pool_capacity_(pool_pages > 0 ? pool_pages : 1),
+        rnd_(seed) {
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) throw std::system_error(errno, std::generic_category(), path);
+    std::array<std::byte, sizeof(Meta)> buffer{};
+    size_t read = 0;
+    try {
+      read = ReadAt(fd_, buffer.data(), buffer.size(), 0);
+    } catch (const std::system_error&) {
+      ::close(fd_);
+      throw;
+    }
+    if (read == 0) {
+      meta_.page_count = 1;
+      return;
+    }
+    std::memcpy(&meta_, buffer.data(), sizeof(Meta));
+    if (read != buffer.size() || meta_.magic != kMagic ||
+        meta_.page_size != kPageSize || meta_.key_size != sizeof(K) ||
+        meta_.value_size != sizeof(V)) {
+      ::close(fd_);
+      throw std::system_error(
+          std::make_error_code(std::errc::invalid_argument),
+          path + " does not contain treap of this type");
+    }
+  }
+  ExternalTreap(const ExternalTreap&) = delete;
+  ExternalTreap(ExternalTreap&&) = delete;
+  ExternalTreap& operator=(const ExternalTreap&) = delete;
+  ExternalTreap& operator=(ExternalTreap&&) = delete;
+  /**
+   * @brief Writes all modified pages to the file and closes it.
+   */
+  ~ExternalTreap() {
+    try {
+      Flush();
+    } catch (const std::system_error&) {
+      // Destructor cannot report the error, Flush() should be called before
+    }
+    ::close(fd_);
+  }
+  /**
+   * @brief Gets value of the given key. Complexity O(log n) node accesses.
+   *
+   * @return std::optional<V> copy of the value or `std::nullopt` if the key is
+   * absent.
+   */
+  std::optional<V> Find(const K& key) {
+    uint64_t node_id = FindNode(key);
+    if (!node_id) return std::nullopt;
+    return ReadNode(node_id).value;
+  }
+  /**
+   * @brief Inserts the given key and value if the key is absent. Complexity
+   * O(log n) node accesses.
+   *
+   * @return true if the key was inserted, false if it already exists.
+   */
+  bool Insert(const K& key, const V& value) {
+    if (FindNode(key)) return false;
+    DiskNode new_node{key, value, rnd_(), {kNullNode, kNullNode}};
+    uint64_t parent_id = kNullNode;
+    uint64_t curr_id = meta_.root;
+    while (curr_id) {
+      DiskNode curr = ReadNode(curr_id);
+      if (curr.priority <= new_node.priority) break;
+      parent_id = curr_id;
+      curr_id = curr.children[curr.key < key];
+    }
+    std::pair<uint64_t, uint64_t> splitted = Split(key, curr_id);
+    new_node.children[kLeft] = splitted.first;
+    new_node.children[kRight] = splitted.second;
+    uint64_t new_id = AllocateNode(parent_id);
+    WriteNode(new_id, new_node);
+    LinkToParent(parent_id, new_id, key);
+    ++meta_.size;
+    return true;
+  }
+  /**
+   * @brief Replaces value of the existing key. Complexity O(log n) node
+   * accesses.
+   *
+   * @return true if the key exists, false otherwise.
+   */
+  bool Update(const K& key, const V& value) {
+    uint64_t node_id = FindNode(key);
+    if (!node_id) return false;
+    DiskNode node = ReadNode(node_id);
+    node.value = value;
+    WriteNode(node_id, node);
+    return true;
+  }
+  /**
+   * @brief Erases the given key. Slot of the erased node is reused by
+   * the following insertions into the same page. Complexity O(log n) node
+   * accesses.
+   *
+   * @return true if the key was erased, false if it is absent.
+   */
+  bool Erase(const K& key) {
+    uint64_t parent_id = kNullNode;
+    uint64_t curr_id = meta_.root;
+    DiskNode curr{};
+    while (curr_id) {
+      curr = ReadNode(curr_id);
+      if (!(curr.key < key) && !(key < curr.key)) break;
+      parent_id = curr_id;
+      curr_id = curr.children[curr.key < key];
+    }
+    if (!curr_id) return false;
+    uint64_t merged = Merge(curr.children[kLeft], curr.children[kRight]);
+    LinkToParent(parent_id, merged, key);
+    FreeNode(curr_id);
+    --meta_.size;
+    return true;
+  }
+  /**
+   * @brief Writes all modified pages and the file header to the file.
+   *
+   * @throw std::system_error if writing fails.
+   */
+  void Flush() {
+    for (Frame& frame : frames_) WriteBack(frame);
+    std::array<std::byte, sizeof(Meta)> buffer{};
+    std::memcpy(buffer.data(), &meta_, sizeof(Meta));
+    WriteAt(fd_, buffer.data(), buffer.size(), 0);
+  }
+  /**
+   * @brief Rewrites the file, so each page contains the top part of some
+   * subtree in breadth-first order and small subtrees are packed together.
+   * Every node is read once and every page is written once. The new file
+   * replaces the old one via rename, the buffer pool is cleared.
+   *
+   * @throw std::system_error if the new file cannot be written, in this case
+   * the old file remains valid.
+   */
+  void Compact() {
+    std::string compact_path = path_ + ".compact";
+    CompactState state;
+    state.fd = ::open(compact_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (state.fd < 0) {
+      throw std::system_error(errno, std::generic_category(), compact_path);
+    }
+    Meta new_meta = meta_;
+    try {
+      new_meta.root = PlaceSubtree(meta_.root, state);
+      FlushSharedPage(state);
+      new_meta.page_count = state.page_count;
+      new_meta.fill_page = 0;
+      std::array<std::byte, sizeof(Meta)> buffer{};
+      std::memcpy(buffer.data(), &new_meta, sizeof(Meta));
+      WriteAt(state.fd, buffer.data(), buffer.size(), 0);
+      if (::fsync(state.fd) != 0 ||
+          ::rename(compact_path.c_str(), path_.c_str()) != 0) {
+        throw std::system_error(errno, std::generic_category(), compact_path);
+      }
+    } catch (...) {
+      // Also on allocation failure while the pages are placed
+      ::close(state.fd);
+      ::unlink(compact_path.c_str());
+      throw;
+    }
+    ::close(fd_);
+    fd_ = state.fd;
+    meta_ = new_meta;
+    frames_.clear();
+    frame_index_.clear();
+  }
+  /**
+   * @brief Gets counters of the buffer pool activity since the opening or
+   * since the last ResetStats() call.
+   */
+  [[nodiscard]] const IoStats& Stats() const { return stats_; }
+  /**
+   * @brief Resets counters of the buffer pool activity.
+   */
+  void ResetStats() { stats_ = IoStats{}; }
+  /**
+   * @brief Gets the number of pages in the file including the header page.
+   */
+  [[nodiscard]] uint64_t PageCount() const { return meta_.page_count; }
+  /**
+   * @brief Checks whether the treap is empty or not.
+   * @return true if the treap is empty, false otherwise.
+   */
+  [[nodiscard]] bool Empty() const { return meta_.size == 0; }
+  /**
+   * @brief Gets the number of elements in the treap.
+   */
+  [[nodiscard]] uint64_t Size() const { return meta_.size; }
+
+ private:
+  static constexpr uint64_t kMagic = 0x50414552544c4150U;
+  static constexpr uint64_t kNullNode = 0;
+  static constexpr size_t kLeft = 0;
+  static constexpr size_t kRight = 1;
+  /**
+   * @brief File header stored at the beginning of the first page.
+   */
+  struct Meta {
+    uint64_t magic = kMagic;
+    uint64_t page_size = kPageSize;
+    uint64_t key_size = sizeof(K);
+    uint64_t value_size = sizeof(V);
+    uint64_t root = kNullNode;
+    uint64_t size = 0;
+    /**Number of pages in the file.*/
+    uint64_t page_count = 0;
+    /**Page for the nodes, which cannot be placed near their parents.*/
+    uint64_t fill_page = 0;
+  };
+  /**
+   * @brief Header of the node page.
+   */
+  struct PageHeader {
+    /**Slots starting from this one were never used.*/
+    uint32_t unused_from = 0;
+    /**Number of the first erased slot plus one, 0 if there are none. Erased
+     * slots are linked via their left child.*/
+    uint32_t free_head = 0;
+  };
+  /**
+   * @brief Node as it is stored in the page. Children are node ids, which
+   * encode page and slot numbers, kNullNode means absent child.
+   */
+  struct DiskNode {
+    K key;
+    V value;
+    uint64_t priority;
+    std::array<uint64_t, 2> children;
+  };
+  static constexpr size_t kSlotsPerPage =
+      (kPageSize - sizeof(PageHeader)) / sizeof(DiskNode);
+  static_assert(kSlotsPerPage >= 2, "Page should contain several nodes");
+  static_assert(sizeof(Meta) <= kPageSize, "Page should contain header");
+  /**
+   * @brief Progress of Compact(): the new file and the page, which packs
+   * small subtrees.
+   */
+  struct CompactState {
+    int fd = -1;
+    uint64_t page_count = 1;
+    /**Number of the page for small subtrees, 0 if it is not started.*/
+    uint64_t shared_page = 0;
+    size_t shared_used = 0;
+    std::vector<std::byte> shared_data = std::vector<std::byte>(kPageSize);
+  };
+  /**
+   * @brief Page cached in the buffer pool.
+   */
+  struct Frame {
+    uint64_t page = 0;
+    bool dirty = false;
+    std::vector<std::byte> data;
+  };
+
+  /**
+   * @brief Finds node with the given key.
+   * @return uint64_t id of the node or kNullNode if key is absent.
+   */
+  uint64_t FindNode(const K& key) {
+    uint64_t curr_id = meta_.root;
+    while (curr_id) {
+      DiskNode curr = ReadNode(curr_id);
+      if (!(curr.key < key) && !(key < curr.key)) break;
+      curr_id = curr.children[curr.key < key];
+    }
+    return curr_id;
+  }
+  /**
+   * @brief Merges two treaps, all keys of the left one are less than keys of
+   * the right one. Only nodes with changed children are written.
+   * @return uint64_t id of the merged treap root.
+   */
+  uint64_t Merge(uint64_t lhs_id, uint64_t rhs_id) {
+    if (!lhs_id) return rhs_id;
+    if (!rhs_id) return lhs_id;
+    DiskNode lhs = ReadNode(lhs_id);
+    DiskNode rhs = ReadNode(rhs_id);
+    if (lhs.priority > rhs.priority) {
+      SetChild(lhs_id, lhs, kRight, Merge(lhs.children[kRight], rhs_id));
+      return lhs_id;
+    }
+    SetChild(rhs_id, rhs, kLeft, Merge(lhs_id, rhs.children[kLeft]));
+    return rhs_id;
+  }
+  /**
+   * @brief Splits the treap into two: with keys less than the given one and
+   * with others.
+   * @return std::pair<uint64_t, uint64_t> ids of the resulting roots.
+   */
+  std::pair<uint64_t, uint64_t> Split(const K& key, uint64_t root_id) {
+    if (!root_id) return {kNullNode, kNullNode};
+    DiskNode root = ReadNode(root_id);
+    if (root.key < key) {
+      std::pair<uint64_t, uint64_t> splitted =
+          Split(key, root.children[kRight]);
+      SetChild(root_id, root, kRight, splitted.first);
+      return {root_id, splitted.second};
+    }
+    std::pair<uint64_t, uint64_t> splitted = Split(key, root.children[kLeft]);
+    SetChild(root_id, root, kLeft, splitted.second);
+    return {splitted.first, root_id};
+  }
+  /**
+   * @brief Writes the subtree into the compacted file.
+   *
+   * Subtree, which fits into a page, is appended to the shared page.
+   * Otherwise the top of the subtree in breadth-first order fills its own
+   * page, which is written after the remaining parts are placed recursively.
+   *
+   * @return uint64_t id of the subtree root in the compacted file.
+   */
+  uint64_t PlaceSubtree(uint64_t root_id, CompactState& state) {
+    if (!root_id) return kNullNode;
+    // One extra node shows that the subtree does not fit into a page
+    std::vector<std::pair<uint64_t, DiskNode>> nodes;
+    nodes.emplace_back(root_id, ReadNode(root_id));
+    for (size_t i = 0; i < nodes.size() && nodes.size() <= kSlotsPerPage;
+         ++i) {
+      std::array<uint64_t, 2> children = nodes[i].second.children;
+      for (uint64_t child_id : children) {
+        if (child_id && nodes.size() <= kSlotsPerPage) {
+          nodes.emplace_back(child_id, ReadNode(child_id));
+        }
+      }
+    }
+    bool shared = nodes.size() <= kSlotsPerPage;
+    if (!shared) nodes.pop_back();
+    std::unordered_map<uint64_t, uint64_t> new_ids;
+    if (!shared) {
+      for (const auto& [node_id, node] : nodes) new_ids[node_id] = kNullNode;
+      for (const auto& [node_id, node] : nodes) {
+        for (uint64_t child_id : node.children) {
+          if (child_id && !new_ids.count(child_id)) {
+            new_ids[child_id] = PlaceSubtree(child_id, state);
+          }
+        }
+      }
+    } else if (state.shared_used + nodes.size() > kSlotsPerPage) {
+      FlushSharedPage(state);
+    }
+    std::vector<std::byte> own_data;
+    uint64_t page = 0;
+    size_t first_slot = 0;
+    std::byte* data = nullptr;
+    if (shared) {
+      if (!state.shared_page) state.shared_page = state.page_count++;
+      page = state.shared_page;
+      first_slot = state.shared_used;
+      state.shared_used += nodes.size();
+      data = state.shared_data.data();
+    } else {
+      page = state.page_count++;
+      own_data.resize(kPageSize);
+      data = own_data.data();
+    }
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      new_ids[nodes[i].first] = page * kSlotsPerPage + first_slot + i + 1;
+    }
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      DiskNode node = nodes[i].second;
+      for (uint64_t& child_id : node.children) {
+        if (child_id) child_id = new_ids[child_id];
+      }
+      std::memcpy(data + SlotOffset(first_slot + i), &node, sizeof(DiskNode));
+    }
+    if (!shared) {
+      PageHeader header{static_cast<uint32_t>(nodes.size()), 0};
+      std::memcpy(data, &header, sizeof(PageHeader));
+      WriteAt(state.fd, data, kPageSize, page * kPageSize);
+      ++stats_.page_writes;
+    }
+    return new_ids[root_id];
+  }
+  /**
+   * @brief Writes the shared page of Compact() if it is started.
+   */
+  void FlushSharedPage(CompactState& state) {
+    if (!state.shared_page) return;
+    PageHeader header{static_cast<uint32_t>(state.shared_used), 0};
+    std::memcpy(state.shared_data.data(), &header, sizeof(PageHeader));
+    WriteAt(state.fd, state.shared_data.data(), kPageSize,
+            state.shared_page * kPageSize);
+    ++stats_.page_writes;
+    std::fill(state.shared_data.begin(), state.shared_data.end(),
+              std::byte{0});
+    state.shared_page = 0;
+    state.shared_used = 0;
+  }
+  /**
+   * @brief Replaces the child of the node. Writes the node only if the child
+   * changes, so unchanged pages do not become dirty.
+   */
+  void SetChild(uint64_t node_id, DiskNode& node, size_t side,
+                uint64_t child_id) {
+    if (node.children[side] == child_id) return;
+    node.children[side] = child_id;
+    WriteNode(node_id, node);
+  }
+  /**
+   * @brief Sets the child into the parent in place of the node with the given
+   * key. If the parent is absent the child becomes the root.
+   */
+  void LinkToParent(uint64_t parent_id, uint64_t child_id, const K& key) {
+    if (!parent_id) {
+      meta_.root = child_id;
+      return;
+    }
+    DiskNode parent = ReadNode(parent_id);
+    SetChild(parent_id, parent, parent.key < key ? kRight : kLeft, child_id);
+  }
+  /**
+   * @brief Allocates slot for the new node, preferably in the page of the
+   * given node.
+   * @param near_id id of the node, near which the new one is placed. Can be
+   * kNullNode.
+   * @return uint64_t id of the allocated node.
+   */
+  uint64_t AllocateNode(uint64_t near_id) {
+    if (near_id) {
+      uint64_t slot = TakeSlot(PageOf(near_id));
+      if (slot) return slot;
+    }
+    if (meta_.fill_page) {
+      uint64_t slot = TakeSlot(meta_.fill_page);
+      if (slot) return slot;
+    }
+    meta_.fill_page = meta_.page_count++;
+    return TakeSlot(meta_.fill_page);
+  }
+  /**
+   * @brief Takes a free slot of the page.
+   * @return uint64_t id of the node in the slot or kNullNode if the page is
+   * full.
+   */
+  uint64_t TakeSlot(uint64_t page) {
+    std::byte* data = GetPage(page, /*for_write=*/false);
+    PageHeader header{};
+    std::memcpy(&header, data, sizeof(PageHeader));
+    uint64_t slot = 0;
+    if (header.free_head) {
+      slot = header.free_head - 1U;
+      DiskNode erased{};
+      std::memcpy(&erased, data + SlotOffset(slot), sizeof(DiskNode));
+      header.free_head = static_cast<uint32_t>(erased.children[kLeft]);
+    } else if (header.unused_from < kSlotsPerPage) {
+      slot = header.unused_from++;
+    } else {
+      return kNullNode;
+    }
+    std::memcpy(GetPage(page, /*for_write=*/true), &header,
+                sizeof(PageHeader));
+    return page * kSlotsPerPage + slot + 1;
+  }
+  /**
+   * @brief Returns slot of the erased node to its page.
+   */
+  void FreeNode(uint64_t node_id) {
+    std::byte* data = GetPage(PageOf(node_id), /*for_write=*/true);
+    PageHeader header{};
+    std::memcpy(&header, data, sizeof(PageHeader));
+    DiskNode erased{};
+    erased.children[kLeft] = header.free_head;
+    uint64_t slot = SlotOf(node_id);
+    header.free_head = static_cast<uint32_t>(slot + 1);
+    std::memcpy(data + SlotOffset(slot), &erased, sizeof(DiskNode));
+    std::memcpy(data, &header, sizeof(PageHeader));
+  }
+  static uint64_t PageOf(uint64_t node_id) {
+    return (node_id - 1) / kSlotsPerPage;
+  }
+  static uint64_t SlotOf(uint64_t node_id) {
+    return (node_id - 1) % kSlotsPerPage;
+  }
+  static size_t SlotOffset(uint64_t slot) {
+    return sizeof(PageHeader) + slot * sizeof(DiskNode);
+  }
+  DiskNode ReadNode(uint64_t node_id) {
+    DiskNode node{};
+    std::memcpy(&node,
+                GetPage(PageOf(node_id), /*for_write=*/false) +
+                    SlotOffset(SlotOf(node_id)),
+                sizeof(DiskNode));
+    return node;
+  }
+  void WriteNode(uint64_t node_id, const DiskNode& node) {
+    std::memcpy(GetPage(PageOf(node_id), /*for_write=*/true) +
+                    SlotOffset(SlotOf(node_id)),
+                &node, sizeof(DiskNode));
+  }
+  /**
+   * @brief Gets content of the page from the buffer pool, reading it from the
+   * file if needed. The least recently used page is evicted if the pool is
+   * full.
+   *
+   * @param for_write if true, the page will be written back on eviction.
+   * @return std::byte* page content, which is valid until the next call.
+   */
+  std::byte* GetPage(uint64_t page, bool for_write) {
+    auto found = frame_index_.find(page);
+    if (found != frame_index_.end()) {
+      ++stats_.pool_hits;
+      frames_.splice(frames_.begin(), frames_, found->second);
+    } else {
+      Frame frame;
+      if (frames_.size() >= pool_capacity_) {
+        WriteBack(frames_.back());
+        frame = std::move(frames_.back());
+        frame_index_.erase(frame.page);
+        frames_.pop_back();
+      } else {
+        frame.data.resize(kPageSize);
+      }
+      frame.page = page;
+      frame.dirty = false;
+      size_t read = ReadAt(fd_, frame.data.data(), kPageSize, page * kPageSize);
+      // Pages beyond the end of file are new ones
+      std::fill(frame.data.begin() + static_cast<std::ptrdiff_t>(read),
+                frame.data.end(), std::byte{0});
+      if (read > 0) ++stats_.page_reads;
+      frames_.push_front(std::move(frame));
+      frame_index_[page] = frames_.begin();
+    }
+    Frame& frame = frames_.front();
+    frame.dirty = frame.dirty || for_write;
+    return frame.data.data();
+  }
+  /**
+   * @brief Writes the page to the file if it was modified.
+   */
+  void WriteBack(Frame& frame) {
+    if (!frame.dirty) return;
+    WriteAt(fd_, frame.data.data(), kPageSize, frame.page * kPageSize);
+    frame.dirty = false;
+    ++stats_.page_writes;
+  }
+  /**
+   * @brief Reads up to the given number of bytes at the file offset.
+   * @return size_t number of read bytes, which is less than requested only at
+   * the end of file.
+   */
+  static size_t ReadAt(int fd, std::byte* buffer, size_t count,
+                       uint64_t offset) {
+    size_t done = 0;
+    while (done < count) {
+      ssize_t res = ::pread(fd, buffer + done, count - done,
+                            static_cast<off_t>(offset + done));
+      if (res == 0) break;
+      if (res < 0) {
+        if (errno == EINTR) continue;
+        throw std::system_error(errno, std::generic_category(), "pread");
+      }
+      done += static_cast<size_t>(res);
+    }
+    return done;
+  }
+  /**
+   * @brief Writes the given number of bytes at the file offset.
+   */
+  static void WriteAt(int fd, const std::byte* buffer, size_t count,
+                      uint64_t offset) {
+    size_t done = 0;
+    while (done < count) {
+      ssize_t res = ::pwrite(fd, buffer + done, count - done,
+                             static_cast<off_t>(offset + done));
+      if (res < 0) {
+        if (errno == EINTR) continue;
+        throw std::system_error(errno, std::generic_category(), "pwrite");
+      }
+      done += static_cast<size_t>(res);
+    }
+  }
+
+  std::string path_;
+  int fd_ = -1;
+  Meta meta_;
+  size_t pool_capacity_;
+  /**Pages of the buffer pool, the most recently used one is the first.*/
+  std::list<Frame> frames_;
+  std::unordered_map<uint64_t, typename std::list<Frame>::iterator>
+      frame_index_;
+  IoStats stats_;
+  SplitMix64 rnd_;
+};
+}  // namespace alpa
+#endif  // ALGORITHM_PACK_EXTERNAL_TREAP_H
@@ -2,23 +2,66 @@
 #define ALGORITHM_PACK_IMPLICIT_TREAP_H
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <exception>
+#include <functional>
 #include <iterator>
-#include <random>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <tuple>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
+#include "algorithm_pack/node_arena.h"
+#include "algorithm_pack/random.h"
+#include "algorithm_pack/treap_core.h"
+#include "algorithm_pack/views.h"
+
 namespace alpa {
+/**
+ * @brief Priority policy of ImplicitTreap: priority is calculated on demand by
+ * mixing bits of the node address, so nodes do not store it and node creation
+ * does not touch the random generator. Shapes depend on node addresses, so
+ * they generally differ between runs, for example under address space layout
+ * randomization. Use RandomPriority with a fixed seed for reproducible shapes.
+ */
+struct AddressPriority {};
+/**
+ * @brief Gets base of the polynomial hashes of ImplicitTreap. It is drawn at
+ * random once per process, so colliding sequences cannot be prepared in
+ * advance, and it is shared by all treaps, so hashes of ranges in different
+ * containers are comparable.
+ */
+inline uint64_t PolynomialHashBase() {
+  // Base is in the range [2, 2^61 - 2]
+  static const uint64_t kBase =
+      SplitMix64{}() % ((uint64_t{1} << 61U) - 3) + 2;
+  return kBase;
+}
+
 /**
  * @brief Realization of a treap with an implicit key.
  *
  * Basically the structure is an node based array with improved asymptotic
  * complexity of some operations. In current realization, insertion, deletion
  * and rotation have O(log n) complexity, where n is container size.
+ *
+ * @tparam T type of stored elements.
+ * @tparam Hash optional element hasher. If it is given, each node additionally
+ * maintains polynomial hash of its subtree, which allows to compare ranges of
+ * the container in O(log n). Hasher has to be default constructible and
+ * stateless, for example `std::hash<T>`. Note that hashes are not updated when
+ * elements are modified in place via iterators, handles or operator[].
+ * @tparam Priority priority policy, RandomPriority or AddressPriority.
  */
-template <typename T>
+template <typename T, typename Hash = void,
+          typename Priority = RandomPriority>
 class ImplicitTreap {
   struct Node;
 
@@ -32,10 +75,12 @@ class ImplicitTreap {
     friend class ImplicitTreap;
 
     using iterator_category = std::random_access_iterator_tag;
-    using difference_type = int;
+    using difference_type = std::ptrdiff_t;
     using value_type = T;
     using pointer = const T*;
     using reference = const T&;
+    /**Marks iterator as segmented, see VisitRange().*/
+    using segmented_iterator_tag = std::true_type;
 
     friend bool operator==(const ConstIterator& lhs, const ConstIterator& rhs) {
       assert(lhs.host_ == rhs.host_);
@@ -86,8 +131,8 @@ class ImplicitTreap {
      * @brief Returns the number of elements between two iterators
      *
      * @param rhs the second iterator
-     * @return int number of elements between two iterators, can be negative if
-     * the rhs iterator precedes this iterator.
+     * @return difference_type number of elements between two iterators, can be
+     * negative if the rhs iterator precedes this iterator.
      */
     friend difference_type operator-(const ConstIterator& lhs,
                                      const ConstIterator& rhs) {
@@ -183,6 +228,29 @@ class ImplicitTreap {
      * @return pointer pointer to the value at which iterator currently points.
      */
     pointer operator->() const { return &curr_node_->value; }
+    /**
+     * @brief Calls `visitor` for each element in the range [first, last) in
+     * order until it returns false. Complexity O(log n + k), where k is the
+     * number of visited elements.
+     *
+     * Unlike iterator increments, which walk parent pointers for every element,
+     * traversal visits whole subtrees as segments with a tight recursive loop.
+     *
+     * @param first beginning of the visited range.
+     * @param last end of the visited range.
+     * @param visitor callable which accepts `reference` and returns false in
+     * order to stop the traversal.
+     * @return ConstIterator pointing to the element on which visitor returned
+     * false, or `last` if all elements were visited.
+     */
+    template <typename Visitor>
+    static ConstIterator VisitRange(ConstIterator first, ConstIterator last,
+                                    Visitor&& visitor) {
+      const Node* stop = ImplicitTreap::VisitNodes(
+          first.curr_node_, static_cast<size_t>(Distance(last, first)),
+          visitor);
+      return stop ? ConstIterator{stop, first.host_} : last;
+    }
 
    private:
     /**
@@ -196,12 +264,12 @@ class ImplicitTreap {
     static difference_type Distance(const ConstIterator& lhs,
                                     const ConstIterator& rhs) {
       assert(lhs.host_ == rhs.host_);
-      auto lhs_number =
-          static_cast<int>(lhs.curr_node_ ? GetElementNumber(lhs.curr_node_)
-                                          : lhs.host_->Size() + 1);
-      auto rhs_number =
-          static_cast<int>(rhs.curr_node_ ? GetElementNumber(rhs.curr_node_)
-                                          : rhs.host_->Size() + 1);
+      auto lhs_number = static_cast<difference_type>(
+          lhs.curr_node_ ? Core::GetElementNumber(lhs.curr_node_)
+                         : lhs.host_->Size() + 1);
+      auto rhs_number = static_cast<difference_type>(
+          rhs.curr_node_ ? Core::GetElementNumber(rhs.curr_node_)
+                         : rhs.host_->Size() + 1);
       return lhs_number - rhs_number;
     }
     /**
@@ -213,7 +281,8 @@ class ImplicitTreap {
      * has to be in the range of the container, this is in the [Begin, End).
      * @return ConstIterator the shifted iterator.
      */
-    static ConstIterator Advance(const ConstIterator& lhs, int shift) {
+    static ConstIterator Advance(const ConstIterator& lhs,
+                                 difference_type shift) {
       assert(lhs.host_);
       if (!lhs.curr_node_) {
         // We are trying to shift from end() iterator
@@ -247,10 +316,12 @@ class ImplicitTreap {
     friend class ImplicitTreap;
 
     using iterator_category = std::random_access_iterator_tag;
-    using difference_type = int;
+    using difference_type = std::ptrdiff_t;
     using value_type = T;
     using pointer = T*;
     using reference = T&;
+    /**Marks iterator as segmented, see VisitRange().*/
+    using segmented_iterator_tag = std::true_type;
 
     friend bool operator==(const Iterator& lhs, const Iterator& rhs) {
       assert(lhs.host_ == rhs.host_);
@@ -283,8 +354,8 @@ class ImplicitTreap {
      * @brief Returns the number of elements between two iterators
      *
      * @param rhs the second iterator
-     * @return int number of elements between two iterators, can be negative if
-     * the rhs iterator precedes this iterator.
+     * @return difference_type number of elements between two iterators, can be
+     * negative if the rhs iterator precedes this iterator.
      */
     friend difference_type operator-(const Iterator& lhs, const Iterator& rhs) {
       return Iterator::Distance(lhs, rhs);
@@ -395,13 +466,32 @@ class ImplicitTreap {
      *
      * @return reference reference to the value stored in the given position.
      */
-    reference operator*() { return curr_node_->value; }
+    reference operator*() const { return curr_node_->value; }
     /**
      * @brief Provides access to the value pointed by iterator.
      *
      * @return pointer pointer to the value at which iterator currently points.
      */
     pointer operator->() const { return &curr_node_->value; }
+    /**
+     * @brief Calls `visitor` for each element in the range [first, last) in
+     * order until it returns false. Complexity O(log n + k), where k is the
+     * number of visited elements.
+     *
+     * See ConstIterator::VisitRange() for the details. Visitor can modify
+     * elements.
+     *
+     * @return Iterator pointing to the element on which visitor returned
+     * false, or `last` if all elements were visited.
+     */
+    template <typename Visitor>
+    static Iterator VisitRange(Iterator first, Iterator last,
+                               Visitor&& visitor) {
+      Node* stop = ImplicitTreap::VisitNodes(
+          first.curr_node_, static_cast<size_t>(Distance(last, first)),
+          visitor);
+      return stop ? Iterator{stop, first.host_} : last;
+    }
 
    private:
     /**
@@ -414,12 +504,12 @@ class ImplicitTreap {
      */
     static difference_type Distance(const Iterator& lhs, const Iterator& rhs) {
       assert(lhs.host_ == rhs.host_);
-      auto lhs_number =
-          static_cast<int>(lhs.curr_node_ ? GetElementNumber(lhs.curr_node_)
-                                          : lhs.host_->Size() + 1);
-      auto rhs_number =
-          static_cast<int>(rhs.curr_node_ ? GetElementNumber(rhs.curr_node_)
-                                          : rhs.host_->Size() + 1);
+      auto lhs_number = static_cast<difference_type>(
+          lhs.curr_node_ ? Core::GetElementNumber(lhs.curr_node_)
+                         : lhs.host_->Size() + 1);
+      auto rhs_number = static_cast<difference_type>(
+          rhs.curr_node_ ? Core::GetElementNumber(rhs.curr_node_)
+                         : rhs.host_->Size() + 1);
       return lhs_number - rhs_number;
     }
 
@@ -432,7 +522,7 @@ class ImplicitTreap {
      * has to be in the range of the container, this is in the [Begin, End).
      * @return Iterator the shifted iterator.
      */
-    static Iterator Advance(const Iterator& lhs, int shift) {
+    static Iterator Advance(const Iterator& lhs, difference_type shift) {
       assert(lhs.host_);
       if (!lhs.curr_node_) {
         // We are trying to shift from end() iterator
@@ -459,6 +549,46 @@ class ImplicitTreap {
     Node* curr_node_ = nullptr;
     ImplicitTreap* host_ = nullptr;
   };
+  /**
+   * @brief Stable reference to the element stored in the treap.
+   *
+   * Nodes are relocated only by Compact(), therefore handle remains valid
+   * until the element it refers to is erased or the treap is compacted,
+   * regardless of insertions, deletions and rotations of other elements. If
+   * the element is moved to another treap via Extract() or Concatenate(),
+   * handle should be used with that treap.
+   */
+  class Handle {
+   public:
+    friend class ImplicitTreap;
+
+    friend bool operator==(const Handle& lhs, const Handle& rhs) {
+      return lhs.node_ == rhs.node_;
+    }
+    friend bool operator!=(const Handle& lhs, const Handle& rhs) {
+      return lhs.node_ != rhs.node_;
+    }
+    /**
+     * @brief Creates empty handle, which does not refer to any element.
+     */
+    Handle() = default;
+    /**@brief Returns true if the handle refers to an element.*/
+    explicit operator bool() const { return node_ != nullptr; }
+    /**
+     * @brief Gets the element referred by the handle. Should be called only on
+     * non empty handles.
+     */
+    T& operator*() const { return node_->value; }
+    /**
+     * @brief Provides access to the element referred by the handle.
+     */
+    T* operator->() const { return &node_->value; }
+
+   private:
+    explicit Handle(Node* node) : node_(node) {}
+
+    Node* node_ = nullptr;
+  };
   /**
    * @brief Creates an empty treap.
    */
@@ -476,7 +606,10 @@ class ImplicitTreap {
    * the state of the `other` is not valid.
    */
   ImplicitTreap(ImplicitTreap&& other) noexcept
-      : root_(other.root_), rnd_(other.rnd_), size_(other.size_) {
+      : root_(other.root_),
+        rnd_(other.rnd_),
+        size_(other.size_),
+        arenas_(std::move(other.arenas_)) {
     other.root_ = nullptr;
   }
   /**
@@ -539,11 +672,12 @@ class ImplicitTreap {
     if (input.empty()) return;
     size_ = input.size();
     auto it = input.begin();
-    root_ = new Node(*it++, /*g_priority=*/rnd_());
+    root_ = new Node(*it++, /*g_priority=*/NewPriority());
     Node* last_included = root_;
     while (it != input.end()) {
-      Node* new_node = new Node(*it++, /*g_priority=*/rnd_());
-      while (last_included && last_included->priority < new_node->priority) {
+      Node* new_node = new Node(*it++, /*g_priority=*/NewPriority());
+      while (last_included &&
+             GetPriority(last_included) < GetPriority(new_node)) {
         last_included = last_included->parent;
       }
       if (!last_included) {
@@ -553,7 +687,7 @@ class ImplicitTreap {
         FixTreeSize(new_node);
         root_ = new_node;
       } else {
-        // Here last_include->priority >= new_node->priority
+        // Here last_include priority >= new_node priority
         if (last_included->right) {
           new_node->left = last_included->right;
           new_node->left->parent = new_node;
@@ -569,6 +703,79 @@ class ImplicitTreap {
       last_included = new_node;
     }
   }
+  /**
+   * @brief Constructs a new Implicit Treap object, which will contain all
+   * elements from the given vector, by building its parts in parallel.
+   * Complexity O(n / k + k log n) per thread for k parts.
+   *
+   * Input is cut into contiguous parts, each worker thread creates nodes of
+   * its parts and builds a tree of them in linear time and the trees are
+   * merged by a balanced merge tree. Priorities of RandomPriority policy are
+   * taken from disjoint parts of the generator sequence, so no state is shared
+   * between threads and the result, including the shape, is the same as the
+   * one of the sequential constructor with the same seed. If a worker thread
+   * cannot be started, the parts are built by the threads started so far and
+   * the calling one. If an element copy throws, all created nodes are
+   * destroyed and the first exception is rethrown.
+   *
+   * @param input element collection which will be copied to the treap. Can be
+   * empty.
+   * @param seed will set in radom generator which generates priorities.
+   * @param thread_count maximal number of worker threads, 0 means the number
+   * of hardware threads.
+   */
+  ImplicitTreap(const std::vector<T>& input, uint64_t seed,
+                size_t thread_count)
+      : rnd_(seed) {
+    if (input.empty()) return;
+    if (thread_count == 0) {
+      thread_count = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    }
+    const size_t part_count = std::min(thread_count, input.size());
+    std::vector<Node*> roots(part_count, nullptr);
+    std::atomic<size_t> next_part{0};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto worker = [&]() {
+      for (size_t i = next_part++; i < part_count; i = next_part++) {
+        const size_t begin = input.size() * i / part_count;
+        const size_t end = input.size() * (i + 1) / part_count;
+        SplitMix64 rnd = rnd_;
+        rnd.Discard(begin);
+        std::vector<Node*> nodes;
+        try {
+          nodes.reserve(end - begin);
+          for (size_t j = begin; j < end; ++j) {
+            uint64_t priority = 0;
+            if constexpr (kStoredPriority) priority = rnd();
+            nodes.push_back(new Node(input[j], priority));
+          }
+        } catch (...) {
+          for (Node* node : nodes) delete node;
+          std::lock_guard<std::mutex> lock(error_mutex);
+          if (!error) error = std::current_exception();
+          continue;
+        }
+        roots[i] = Core::BuildTree(nodes);
+      }
+    };
+    std::vector<std::thread> threads;
+    try {
+      for (size_t i = 1; i < part_count; ++i) threads.emplace_back(worker);
+    } catch (...) {
+      // Thread could not be started, the parts are left to the started
+      // threads and the current one
+    }
+    worker();
+    for (auto& thread : threads) thread.join();
+    if (error) {
+      for (Node* root : roots) DeleteTree(root);
+      std::rethrow_exception(error);
+    }
+    if constexpr (kStoredPriority) rnd_.Discard(input.size());
+    root_ = MergeBalanced(roots);
+    size_ = input.size();
+  }
   /**
    * @brief Destroy the Implicit Treap object by destroying each value it
    * stored.
@@ -587,12 +794,13 @@ class ImplicitTreap {
     std::swap(root_, other.root_);
     std::swap(rnd_, other.rnd_);
     std::swap(size_, other.size_);
+    std::swap(arenas_, other.arenas_);
   }
   /**
    * @brief Sets seed of the random generator associated with current tree.
    * Random generator is used for creating priorities.
    */
-  void SetSeed(uint64_t seed) { rnd_.seed(seed); }
+  void SetSeed(uint64_t seed) { rnd_.Seed(seed); }
   /**@brief Returns true if the container is empty*/
   [[nodiscard]] bool Empty() const { return !root_; }
   /**@brief Gets the number of elements in the container.*/
@@ -609,21 +817,133 @@ class ImplicitTreap {
    */
   T& Insert(const T& value, size_t pos) {
     ++size_;
-    Node* new_node = new Node(value, /*g_priority=*/rnd_());
-    auto [left, right] = Split(/*el_number=*/std::min(size_, pos) + 1, root_);
-    root_ = Merge(Merge(left, new_node), right);
+    Node* new_node = new Node(value, /*g_priority=*/NewPriority());
+    auto [left, right] =
+        Core::Split(/*el_number=*/std::min(size_, pos) + 1, root_);
+    root_ = Core::Merge(Core::Merge(left, new_node), right);
     return new_node->value;
   }
+  /**
+   * @brief Inserts the given value right after the element referred by the
+   * handle. Complexity O(log n). Does not invalidate iterators.
+   *
+   * @param handle handle of the element after which the new one is inserted.
+   * If handle is empty, the value is inserted in the beginning of the treap.
+   * @param value value which needs to be placed into the treap.
+   * @return Handle handle of the inserted element.
+   */
+  Handle InsertAfter(const Handle& handle, const T& value) {
+    size_t pos = handle ? Core::GetElementNumber(handle.node_) : 0;
+    ++size_;
+    Node* new_node = new Node(value, /*g_priority=*/NewPriority());
+    auto [left, right] = Core::Split(/*el_number=*/pos + 1, root_);
+    root_ = Core::Merge(Core::Merge(left, new_node), right);
+    return Handle{new_node};
+  }
+  /**
+   * @brief Inserts the given value in the end of the treap. Complexity
+   * O(log n). Does not invalidate iterators.
+   *
+   * @return Handle handle of the inserted element.
+   */
+  Handle PushBack(const T& value) {
+    ++size_;
+    Node* new_node = new Node(value, /*g_priority=*/NewPriority());
+    root_ = Core::Merge(root_, new_node);
+    return Handle{new_node};
+  }
+  /**
+   * @brief Gets handle of the element stored in the given position.
+   * Complexity O(log n).
+   *
+   * @param pos position of the element. Should be in range [0, Size()).
+   */
+  [[nodiscard]] Handle HandleAt(size_t pos) {
+    assert(pos < size_);
+    return Handle{GetElement(root_, pos + 1)};
+  }
+  /**
+   * @brief Gets the current position of the element referred by the handle.
+   * Complexity O(log n).
+   *
+   * @param handle non empty handle of the element stored in this treap.
+   */
+  [[nodiscard]] size_t IndexOf(const Handle& handle) const {
+    assert(handle);
+    return Core::GetElementNumber(handle.node_) - 1;
+  }
+  /**
+   * @brief Moves all elements of the given treap into the given position.
+   * Complexity O(log n). Does not invalidate iterators.
+   *
+   * @param other given treap, which will be empty after the insertion.
+   * @param pos position of the first inserted element. If the given position
+   * is larger than the container size, elements will be appended.
+   */
+  void Insert(ImplicitTreap&& other, size_t pos) {
+    AdoptArenas(other);
+    auto [left, right] =
+        Core::Split(/*el_number=*/std::min(size_, pos) + 1, root_);
+    root_ = Core::Merge(
+        Core::Merge(left, std::exchange(other.root_, nullptr)), right);
+    size_ += std::exchange(other.size_, 0);
+  }
+  /**
+   * @brief Moves elements in the range [src_start, src_end) of the source
+   * treap to the given position of this one. No elements are copied or
+   * allocated, nodes are moved by at most three splits and three merges, so
+   * complexity is O(log n + log m). Does not invalidate iterators. Handles of
+   * the moved elements stay valid and refer to this treap.
+   *
+   * If the source was compacted, this treap takes shared ownership of all
+   * its arenas, which may allocate the arena list. Arenas are released only
+   * when no treap refers to them, so after splices from compacted treaps
+   * Compact() of this treap may be needed to release their memory.
+   *
+   * @param dst_pos position of the first moved element. If the source is this
+   * treap, the position is counted before the move and should not be strictly
+   * inside the moved range.
+   * @param src source treap, can be this treap.
+   * @param src_start index of the first moved element in the source.
+   * @param src_end index past the last moved element in the source.
+   */
+  void Splice(size_t dst_pos, ImplicitTreap& src, size_t src_start,
+              size_t src_end) {
+    assert(src_start <= src_end && src_end <= src.size_);
+    assert(dst_pos <= size_);
+    if (src_start == src_end) return;
+    if (&src == this) {
+      assert(dst_pos <= src_start || dst_pos >= src_end);
+      // Moved range and the elements it passes swap their places
+      if (dst_pos < src_start) {
+        Rotate(dst_pos, src_start, src_end);
+      } else if (dst_pos > src_end) {
+        Rotate(src_start, src_end, dst_pos);
+      }
+      return;
+    }
+    AdoptArenas(src);
+    auto [src_left, src_rest] =
+        Core::Split(/*el_number=*/src_start + 1, src.root_);
+    auto [moved, src_right] =
+        Core::Split(/*el_number=*/src_end - src_start + 1, src_rest);
+    src.root_ = Core::Merge(src_left, src_right);
+    src.size_ -= src_end - src_start;
+    auto [left, right] = Core::Split(/*el_number=*/dst_pos + 1, root_);
+    root_ = Core::Merge(Core::Merge(left, moved), right);
+    size_ += src_end - src_start;
+  }
   /**
    * @brief Concatenates the given treap to the end of the current one.
    * Complexity O(log n). Does not invalidate iterators.
    *
    * @param other given treap which will be concatenated. Ownership of all
    * elements from the given treap will be moved to this treap.
-   * @return ImplicitTreap<T>& reference to the concatenated treap
+   * @return ImplicitTreap& reference to the concatenated treap
    */
-  ImplicitTreap<T>& Concatenate(ImplicitTreap&& other) {
-    root_ = Merge(root_, std::exchange(other.root_, nullptr));
+  ImplicitTreap& Concatenate(ImplicitTreap&& other) {
+    AdoptArenas(other);
+    root_ = Core::Merge(root_, std::exchange(other.root_, nullptr));
     size_ += std::exchange(other.size_, 0);
     return *this;
   }
@@ -658,10 +978,23 @@ class ImplicitTreap {
    */
   void Erase(size_t pos) {
     assert(root_);
-    std::pair<Node*, Node*> first_split = Split(pos + 1, root_);
-    std::pair<Node*, Node*> second_split = Split(2, first_split.second);
-    delete second_split.first;
-    root_ = Merge(first_split.first, second_split.second);
+    std::pair<Node*, Node*> first_split = Core::Split(pos + 1, root_);
+    std::pair<Node*, Node*> second_split = Core::Split(2, first_split.second);
+    DestroyNode(second_split.first);
+    root_ = Core::Merge(first_split.first, second_split.second);
+    --size_;
+  }
+  /**
+   * @brief Deletes the element referred by the given handle. Complexity
+   * O(log n), no positional search is performed. Invalidates the handle and
+   * iterators which pointed to the deleted object.
+   *
+   * @param handle non empty handle of the element stored in this treap.
+   */
+  void Erase(const Handle& handle) {
+    assert(handle);
+    root_ = Core::Unlink(handle.node_);
+    DestroyNode(handle.node_);
     --size_;
   }
   /**
@@ -681,21 +1014,169 @@ class ImplicitTreap {
     assert(end_pos >= start_pos);
     assert(end_pos <= size_);
     ImplicitTreap result(/*seed=*/rnd_());
+    // Extracted nodes may live in arenas of this treap
+    result.AdoptArenas(*this);
     if (start_pos == 0 && end_pos == size_) {
       result.root_ = std::exchange(root_, nullptr);
       result.size_ = std::exchange(size_, 0);
     } else if (start_pos < end_pos) {
-      std::pair<Node*, Node*> start_split = Split(start_pos + 1, root_);
+      std::pair<Node*, Node*> start_split = Core::Split(start_pos + 1, root_);
       size_t extracted_num = end_pos - start_pos;
       std::pair<Node*, Node*> end_split =
-          Split(extracted_num + 1, start_split.second);
+          Core::Split(extracted_num + 1, start_split.second);
       result.root_ = end_split.first;
       result.size_ = extracted_num;
-      root_ = Merge(start_split.first, end_split.second);
+      root_ = Core::Merge(start_split.first, end_split.second);
       size_ -= extracted_num;
     }
     return result;
   }
+  /**
+   * @brief Splits the treap at the given positions into independent treaps.
+   * The treap becomes empty. Complexity O(k log n) for k positions. Handles
+   * stay valid and refer to the elements in the pieces.
+   *
+   * @param positions ascending positions, not larger than the treap size.
+   * @return std::vector<ImplicitTreap> k + 1 pieces, the piece i contains
+   * elements in the range [positions[i - 1], positions[i]), where the first
+   * piece starts at 0 and the last one ends at the treap size.
+   */
+  std::vector<ImplicitTreap> SplitAt(const std::vector<size_t>& positions) {
+    assert(std::is_sorted(positions.begin(), positions.end()));
+    assert(positions.empty() || positions.back() <= size_);
+    std::vector<Node*> roots = CutAt(std::exchange(root_, nullptr), positions);
+    std::vector<ImplicitTreap> pieces;
+    pieces.reserve(roots.size());
+    for (size_t i = 0; i < roots.size(); ++i) {
+      pieces.emplace_back(/*seed=*/rnd_());
+      pieces.back().AdoptArenas(*this);
+      pieces.back().root_ = roots[i];
+      pieces.back().size_ = (i < positions.size() ? positions[i] : size_) -
+                            (i > 0 ? positions[i - 1] : 0);
+    }
+    size_ = 0;
+    return pieces;
+  }
+  /**
+   * @brief Splits the treap into the given number of pieces, whose sizes
+   * differ at most by one. The treap becomes empty. Complexity O(k log n) for
+   * k pieces.
+   *
+   * @param piece_count number of pieces, positive.
+   * @return std::vector<ImplicitTreap> pieces in the order of elements. The
+   * first pieces are the larger ones.
+   */
+  std::vector<ImplicitTreap> PartitionEvenly(size_t piece_count) {
+    assert(piece_count > 0);
+    std::vector<size_t> positions(piece_count - 1);
+    for (size_t i = 1; i < piece_count; ++i) {
+      positions[i - 1] =
+          size_ / piece_count * i + std::min(i, size_ % piece_count);
+    }
+    return SplitAt(positions);
+  }
+  /**
+   * @brief Moves all elements of the given treaps to the end of this one, for
+   * example to gather the pieces of PartitionEvenly(). Trees are merged by a
+   * balanced merge tree, so complexity is O(k log n) for k treaps. Does not
+   * invalidate iterators.
+   *
+   * @param others treaps which will be empty after the call.
+   * @return ImplicitTreap& reference to the concatenated treap.
+   */
+  ImplicitTreap& ConcatenateAll(std::vector<ImplicitTreap>&& others) {
+    std::vector<Node*> roots{std::exchange(root_, nullptr)};
+    for (auto& other : others) {
+      AdoptArenas(other);
+      roots.push_back(std::exchange(other.root_, nullptr));
+      size_ += std::exchange(other.size_, 0);
+    }
+    root_ = MergeBalanced(roots);
+    return *this;
+  }
+  /**
+   * @brief Reorders blocks of the range in one pass.
+   *
+   * Range [boundaries.front(), boundaries.back()) consists of k blocks, the
+   * block j is [boundaries[j], boundaries[j + 1]). After the call the block i
+   * of the range is the former block permutation[i]. Treap is split once at
+   * all boundaries and the blocks are merged in the new order by a balanced
+   * merge tree, so complexity is O(k log n) instead of k rotations. Does not
+   * invalidate iterators.
+   *
+   * @param boundaries ascending positions, not larger than the treap size.
+   * @param permutation permutation of the numbers 0, ..., k - 1 where k is
+   * the number of blocks.
+   */
+  void ReorderBlocks(const std::vector<size_t>& boundaries,
+                     const std::vector<size_t>& permutation) {
+    assert(std::is_sorted(boundaries.begin(), boundaries.end()));
+    assert(boundaries.empty() || boundaries.back() <= size_);
+    assert(permutation.size() + 1 == std::max<size_t>(boundaries.size(), 1));
+    if (permutation.size() < 2) return;
+    // Pieces are the prefix, the blocks and the suffix
+    std::vector<Node*> pieces = CutAt(root_, boundaries);
+    std::vector<Node*> reordered{pieces.front()};
+    for (size_t block : permutation) {
+      assert(block < permutation.size());
+      reordered.push_back(pieces[block + 1]);
+    }
+    reordered.push_back(pieces.back());
+    root_ = MergeBalanced(reordered);
+  }
+  /**
+   * @brief Applies the given function to disjoint ranges of the treap in
+   * parallel.
+   *
+   * Treap is split at the given positions by SplitAt(), each piece is passed
+   * to the function on one of the worker threads and the pieces are merged
+   * back by a balanced merge tree. Pieces are independent treaps, so the
+   * function may modify them freely, but it should not touch other pieces.
+   * Complexity O(k log n) besides the function calls. If any call throws, the
+   * treap is still merged back and the first exception is rethrown. If a
+   * worker thread cannot be started, the pieces are processed by the threads
+   * started so far and the calling one.
+   *
+   * @param positions ascending positions, not larger than the treap size.
+   * @param func callable with signature `void(ImplicitTreap& piece, size_t
+   * index)`, where index is the number of the piece as in SplitAt().
+   * @param thread_count maximal number of worker threads, 0 means the number
+   * of hardware threads.
+   */
+  template <typename Func>
+  void ParallelApply(const std::vector<size_t>& positions, Func func,
+                     size_t thread_count = 0) {
+    std::vector<ImplicitTreap> pieces = SplitAt(positions);
+    if (thread_count == 0) {
+      thread_count = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    }
+    std::atomic<size_t> next_piece{0};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto worker = [&]() {
+      for (size_t i = next_piece++; i < pieces.size(); i = next_piece++) {
+        try {
+          func(pieces[i], i);
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(error_mutex);
+          if (!error) error = std::current_exception();
+        }
+      }
+    };
+    std::vector<std::thread> threads;
+    try {
+      for (size_t i = 1; i < std::min(thread_count, pieces.size()); ++i) {
+        threads.emplace_back(worker);
+      }
+    } catch (...) {
+      // Thread could not be started, the pieces are left to the started
+      // threads and the current one
+    }
+    worker();
+    for (auto& thread : threads) thread.join();
+    ConcatenateAll(std::move(pieces));
+    if (error) std::rethrow_exception(error);
+  }
   /**
    * @brief Performs left rotation of the subset of the vector.
    *
@@ -717,17 +1198,147 @@ class ImplicitTreap {
            (new_begin < range_end ||
             (new_begin == range_begin && new_begin == range_end)));
     if (range_begin == range_end || Empty()) return;
-    std::pair<Node*, Node*> splitted_begin = Split(range_begin + 1, root_);
+    std::pair<Node*, Node*> splitted_begin =
+        Core::Split(range_begin + 1, root_);
     new_begin -= range_begin;
     range_end -= range_begin;
     std::pair<Node*, Node*> splitted_end =
-        Split(range_end + 1, splitted_begin.second);
+        Core::Split(range_end + 1, splitted_begin.second);
     // Rotate the middle part in the requested way
     std::pair<Node*, Node*> rotation_split =
-        Split(new_begin + 1, splitted_end.first);
-    splitted_end.first = Merge(rotation_split.second, rotation_split.first);
-    root_ = Merge(splitted_begin.first,
-                  Merge(splitted_end.first, splitted_end.second));
+        Core::Split(new_begin + 1, splitted_end.first);
+    splitted_end.first =
+        Core::Merge(rotation_split.second, rotation_split.first);
+    root_ = Core::Merge(splitted_begin.first,
+                        Core::Merge(splitted_end.first, splitted_end.second));
+  }
+  /**
+   * @brief Sorts elements in the interval [start_pos, end_pos) according to
+   * the given comparator. Complexity O(log n + k log k), where k is the
+   * range length.
+   *
+   * Unlike `std::sort` over treap iterators, elements are moved to a scratch
+   * buffer, sorted there and moved back to the same nodes, so no iterator
+   * arithmetic is involved and no nodes are reallocated. Iterators remain
+   * valid and keep pointing to the same positions. The order of equal
+   * elements is not preserved.
+   *
+   * Provides the basic exception guarantee: if the comparator or a move of
+   * an element throws, the treap stays valid and keeps its size, but
+   * elements of the range are unspecified.
+   *
+   * @param start_pos index of the first element in the sorted range.
+   * @param end_pos index past the last element in the sorted range. The range
+   * should be valid, this is start_pos <= end_pos <= Size().
+   * @param comp comparator, which defines strict weak ordering of elements.
+   */
+  template <typename Compare = std::less<>>
+  void SortRange(size_t start_pos, size_t end_pos, Compare comp = Compare{}) {
+    SortRangeWith(start_pos, end_pos, [&comp](auto first, auto last) {
+      std::sort(first, last, comp);
+    });
+  }
+  /**
+   * @brief Sorts elements in the interval [start_pos, end_pos) preserving the
+   * order of equal elements. Complexity O(log n + k log k), where k is the
+   * range length.
+   *
+   * See SortRange() for the details.
+   */
+  template <typename Compare = std::less<>>
+  void StableSortRange(size_t start_pos, size_t end_pos,
+                       Compare comp = Compare{}) {
+    SortRangeWith(start_pos, end_pos, [&comp](auto first, auto last) {
+      std::stable_sort(first, last, comp);
+    });
+  }
+  /**
+   * @brief Calculates polynomial hash of the elements in the interval
+   * [start_pos, end_pos). Complexity O(log n).
+   *
+   * Available only for treaps created with the element hasher. Equal sequences
+   * always have equal hashes, regardless of the container which stores them.
+   * The hash base is drawn at random once per process, so two different
+   * sequences of length n have equal hashes with probability at most
+   * n / (2^61 - 1), provided the hasher maps their differing elements to
+   * different values modulo 2^61 - 2. Elements with colliding hasher values
+   * are indistinguishable.
+   *
+   * @param start_pos index of the first element in the range.
+   * @param end_pos index past the last element in the range. The range should
+   * be valid, this is start_pos <= end_pos <= Size().
+   * @return uint64_t hash of the range. Hash of the empty range is 0.
+   */
+  [[nodiscard]] uint64_t RangeHash(size_t start_pos, size_t end_pos) const {
+    static_assert(kHashed, "RangeHash requires treap with element hasher");
+    assert(start_pos <= end_pos && end_pos <= size_);
+    uint64_t whole = PrefixHash(root_, end_pos);
+    uint64_t shifted_prefix = MulHash(PrefixHash(root_, start_pos),
+                                      PowerHash(end_pos - start_pos));
+    return whole >= shifted_prefix ? whole - shifted_prefix
+                                   : whole + kHashModulo - shifted_prefix;
+  }
+  /**
+   * @brief Checks whether `count` elements starting from `pos` in this treap
+   * are equal to `count` elements starting from `other_pos` in `other`.
+   * Complexity O(log n).
+   *
+   * Comparison is performed via range hashes, therefore the result is only
+   * probabilistic: different ranges can be reported as equal with the
+   * probability described in RangeHash(). Both ranges have to be inside
+   * their containers.
+   */
+  [[nodiscard]] bool RangeEqual(size_t pos, const ImplicitTreap& other,
+                                size_t other_pos, size_t count) const {
+    return RangeHash(pos, pos + count) ==
+           other.RangeHash(other_pos, other_pos + count);
+  }
+  /**
+   * @overload
+   *
+   * Compares two ranges of this treap.
+   */
+  [[nodiscard]] bool RangeEqual(size_t lhs_pos, size_t rhs_pos,
+                                size_t count) const {
+    return RangeEqual(lhs_pos, *this, rhs_pos, count);
+  }
+  /**
+   * @brief Calculates the length of the longest common prefix of suffixes,
+   * which start at `pos` in this treap and at `other_pos` in `other`.
+   * Complexity O(log^2 n).
+   *
+   * Performs binary search over the prefix length comparing range hashes.
+   *
+   * @param pos index in this treap, should be in range [0, Size()].
+   * @param other treap, which suffix is compared.
+   * @param other_pos index in the `other` treap, should be in range [0,
+   * other.Size()].
+   * @return size_t number of equal elements at the start of both suffixes.
+   */
+  [[nodiscard]] size_t LongestCommonPrefix(size_t pos,
+                                           const ImplicitTreap& other,
+                                           size_t other_pos) const {
+    assert(pos <= size_ && other_pos <= other.size_);
+    size_t equal = 0;
+    size_t not_equal = std::min(size_ - pos, other.size_ - other_pos) + 1;
+    while (not_equal - equal > 1) {
+      size_t mid = equal + (not_equal - equal) / 2;
+      if (RangeEqual(pos, other, other_pos, mid)) {
+        equal = mid;
+      } else {
+        not_equal = mid;
+      }
+    }
+    return equal;
+  }
+  /**
+   * @overload
+   *
+   * Compares two suffixes of this treap.
+   */
+  [[nodiscard]] size_t LongestCommonPrefix(size_t lhs_pos,
+                                           size_t rhs_pos) const {
+    return LongestCommonPrefix(lhs_pos, *this, rhs_pos);
   }
   /**
    * @brief Removes all elements from the treap, leaving it empty.
@@ -736,6 +1347,61 @@ class ImplicitTreap {
     DeleteTree(root_);
     root_ = nullptr;
     size_ = 0;
+    arenas_.reset();
+  }
+  /**
+   * @brief Gets memory usage of the arenas created by Compact(), which may
+   * be shared with other treaps. Nodes inserted after the compaction are
+   * allocated on the heap and are not counted.
+   */
+  [[nodiscard]] ArenaStats MemoryStats() const {
+    ArenaStats stats;
+    if (!arenas_) return stats;
+    std::vector<const MemoryBlock*> blocks;
+    for (const auto& arena : *arenas_) blocks.push_back(&arena->block);
+    MemoryBlock::CollectStats(blocks, stats);
+    return stats;
+  }
+  /**
+   * @brief Relocates all nodes into a single contiguous arena in the order of
+   * elements, so iteration over the treap accesses memory sequentially.
+   * Complexity O(n).
+   *
+   * Element values are moved into new nodes, whose move constructor should
+   * not throw. Tree is rebuilt from the relocated nodes, with RandomPriority
+   * policy its shape is preserved. Memory of the previous arenas is released
+   * once no treap refers to it, memory of nodes erased from the arena is
+   * reclaimed by the next compaction. Invalidates all iterators and handles.
+   *
+   * @param memory source of memory for the arena. NodeMemory::kHugePages
+   * reduces TLB misses of accesses to large treaps.
+   */
+  void Compact(NodeMemory memory = NodeMemory::kHeap) {
+    if (!root_) return;
+    auto arena = std::make_shared<Arena>(size_, memory);
+    std::vector<Node*> nodes;
+    nodes.reserve(size_);
+    // In-order traversal, which destroys each old node once its right child
+    // is known
+    std::vector<Node*> stack;
+    for (Node* curr = root_; curr || !stack.empty();) {
+      if (curr) {
+        stack.push_back(curr);
+        curr = curr->left;
+        continue;
+      }
+      Node* old_node = stack.back();
+      stack.pop_back();
+      curr = old_node->right;
+      uint64_t priority = 0;
+      if constexpr (kStoredPriority) priority = old_node->priority;
+      nodes.push_back(::new (static_cast<void*>(arena->nodes + nodes.size()))
+                          Node(std::move(old_node->value), priority));
+      DestroyNode(old_node);
+    }
+    arenas_ = std::make_unique<ArenaList>();
+    arenas_->push_back(std::move(arena));
+    root_ = Core::BuildTree(nodes);
   }
   /**
    * @brief Gets begin iterator of the container. Complexity O(log n).
@@ -775,136 +1441,364 @@ class ImplicitTreap {
   [[nodiscard]] ConstIterator CEnd() const {
     return ConstIterator{nullptr, this};
   }
+  /**
+   * @brief Gets lazy view of the elements in the range [start_pos, end_pos).
+   * Elements are not copied, the view is invalidated by any modification of
+   * the treap. Complexity O(log n), traversal costs amortized O(1) per
+   * element.
+   */
+  [[nodiscard]] IteratorRange<Iterator> Range(size_t start_pos,
+                                              size_t end_pos) {
+    assert(start_pos <= end_pos && end_pos <= size_);
+    return {Iterator{NodeAt(start_pos), this},
+            Iterator{NodeAt(end_pos), this}};
+  }
+  /**
+   * @overload
+   */
+  [[nodiscard]] IteratorRange<ConstIterator> Range(size_t start_pos,
+                                                   size_t end_pos) const {
+    assert(start_pos <= end_pos && end_pos <= size_);
+    return {ConstIterator{NodeAt(start_pos), this},
+            ConstIterator{NodeAt(end_pos), this}};
+  }
 
  private:
+  static constexpr bool kHashed = !std::is_void_v<Hash>;
+  /** Hashes are calculated modulo Mersenne prime 2^61 - 1. */
+  static constexpr uint64_t kHashModulo = (uint64_t{1} << 61U) - 1;
+  /**
+   * @brief Hash data of the node subtree, which is stored only in treaps with
+   * element hasher.
+   */
+  struct HashData {
+    /**Polynomial hash of the subtree elements in their order.*/
+    uint64_t hash = 0;
+    /**Hash base in power of the subtree size.*/
+    uint64_t power = 1;
+  };
+  struct NoHashData {};
+  static constexpr bool kStoredPriority =
+      std::is_same_v<Priority, RandomPriority>;
+  static_assert(kStoredPriority || std::is_same_v<Priority, AddressPriority>,
+                "Unknown priority policy");
+  /**
+   * @brief Priority of the node, which is stored only for RandomPriority
+   * policy.
+   */
+  struct PriorityData {
+    uint64_t priority = 0;
+  };
+  struct NoPriorityData {};
   /**
    * @brief Describes single element stored in the treap.
    */
-  struct Node {
-    Node(T val, uint64_t g_priority)
-        : priority(g_priority), value(std::move(val)) {}
+  struct Node
+      : std::conditional_t<kHashed, HashData, NoHashData>,
+        std::conditional_t<kStoredPriority, PriorityData, NoPriorityData> {
+    /**
+     * @param g_priority node priority, ignored for AddressPriority policy.
+     */
+    Node(T val, uint64_t g_priority) : value(std::move(val)) {
+      if constexpr (kStoredPriority) this->priority = g_priority;
+      if constexpr (kHashed) {
+        this->hash = ElementHash(value);
+        this->power = PolynomialHashBase();
+      }
+    }
     Node* left = nullptr;
     Node* right = nullptr;
     Node* parent = nullptr;
     /**Number of elements in this node subtree, including itself.*/
     size_t tree_size = 1;
-    uint64_t priority = 0;
     T value;
   };
   /**
-   * @brief Calculates the tree size of the subtree which corresponds to the
-   * given node.
-   *
-   * @param node - root of the tree which is processed. Can be nullptr.
-   * @return size_t number of elements in the given tree.
+   * @brief Creates priority for the new node. Does not touch the random
+   * generator for AddressPriority policy.
    */
-  static size_t GetTreeSize(const Node* node) {
-    return node ? node->tree_size : 0;
+  uint64_t NewPriority() {
+    if constexpr (kStoredPriority) {
+      return rnd_();
+    } else {
+      return 0;
+    }
   }
   /**
-   * @brief Sets size of the given node according to its children
+   * @brief Contiguous block of nodes created by Compact(). Nodes are
+   * constructed and destroyed in place, the block is released when no treap
+   * refers to it.
+   */
+  struct Arena {
+    Arena(size_t g_capacity, NodeMemory memory)
+        : block(g_capacity * sizeof(Node), alignof(Node), memory),
+          nodes(static_cast<Node*>(block.Data())),
+          capacity(g_capacity) {}
+    /**@brief Checks whether the node is placed in this arena.*/
+    [[nodiscard]] bool Contains(const Node* node) const {
+      return std::less_equal<>{}(nodes, node) &&
+             std::less<>{}(node, nodes + capacity);
+    }
+
+    MemoryBlock block;
+    Node* nodes;
+    size_t capacity;
+  };
+  using ArenaList = std::vector<std::shared_ptr<Arena>>;
+  /**
+   * @brief Gets priority of the node.
+   */
+  static uint64_t GetPriority(const Node* node) {
+    if constexpr (kStoredPriority) {
+      return node->priority;
+    } else {
+      return MixBits(reinterpret_cast<uintptr_t>(node));
+    }
+  }
+  /**
+   * @brief Adapts the node to the split and merge core.
+   */
+  struct CoreTraits {
+    static uint64_t GetPriority(const Node* node) {
+      return ImplicitTreap::GetPriority(node);
+    }
+    static void Update(Node* node) { FixTreeSize(node); }
+  };
+  using Core = TreapCore<Node, CoreTraits>;
+  /**
+   * @brief Sets size of the given node according to its children. For treaps
+   * with element hasher also recalculates the subtree hash.
    * @param node - node needed to be fixed. Cannot be nullptr.
    */
   static void FixTreeSize(Node* node) {
-    node->tree_size = GetTreeSize(node->left) + GetTreeSize(node->right) + 1;
+    node->tree_size =
+        Core::GetTreeSize(node->left) + Core::GetTreeSize(node->right) + 1;
+    if constexpr (kHashed) {
+      uint64_t left_hash = node->left ? node->left->hash : 0;
+      uint64_t left_power = node->left ? node->left->power : 1;
+      uint64_t right_hash = node->right ? node->right->hash : 0;
+      uint64_t right_power = node->right ? node->right->power : 1;
+      uint64_t base = PolynomialHashBase();
+      uint64_t hash =
+          AddHash(MulHash(left_hash, base), ElementHash(node->value));
+      node->hash = AddHash(MulHash(hash, right_power), right_hash);
+      node->power = MulHash(MulHash(left_power, base), right_power);
+    }
+  }
+  /**
+   * @brief Calculates hash of the single element. Result is never 0, so
+   * sequences of different length never collide trivially.
+   */
+  static uint64_t ElementHash(const T& value) {
+    uint64_t raw = Hash{}(value);
+    return raw % (kHashModulo - 1) + 1;
+  }
+  /**
+   * @brief Adds two hashes modulo kHashModulo. Both arguments should be smaller
+   * than kHashModulo.
+   */
+  static uint64_t AddHash(uint64_t lhs, uint64_t rhs) {
+    uint64_t sum = lhs + rhs;
+    return sum >= kHashModulo ? sum - kHashModulo : sum;
+  }
+  /**
+   * @brief Multiplies two hashes modulo kHashModulo without 128 bit
+   * arithmetic. Both arguments should be smaller than kHashModulo.
+   */
+  static uint64_t MulHash(uint64_t lhs, uint64_t rhs) {
+    constexpr uint64_t kMask30 = (uint64_t{1} << 30U) - 1;
+    constexpr uint64_t kMask31 = (uint64_t{1} << 31U) - 1;
+    uint64_t lhs_high = lhs >> 31U;
+    uint64_t lhs_low = lhs & kMask31;
+    uint64_t rhs_high = rhs >> 31U;
+    uint64_t rhs_low = rhs & kMask31;
+    uint64_t mid = lhs_low * rhs_high + lhs_high * rhs_low;
+    // 2^62 == 2 and 2^61 == 1 modulo kHashModulo
+    uint64_t result = lhs_high * rhs_high * 2 + (mid >> 30U) +
+                      ((mid & kMask30) << 31U) + lhs_low * rhs_low;
+    result = (result >> 61U) + (result & kHashModulo);
+    return result >= kHashModulo ? result - kHashModulo : result;
+  }
+  /**
+   * @brief Calculates the hash base in the given power. Complexity
+   * O(log power).
+   */
+  static uint64_t PowerHash(size_t power) {
+    uint64_t result = 1;
+    uint64_t base = PolynomialHashBase();
+    while (power > 0) {
+      if ((power & 1U) != 0) result = MulHash(result, base);
+      base = MulHash(base, base);
+      power >>= 1U;
+    }
+    return result;
   }
   /**
-   * @brief Sets parent field of the given node childrens
+   * @brief Calculates hash of the first `count` elements of the given treap.
+   * Complexity O(log n).
    *
-   * @param node - node which is needed to be fixed. Cannot be nullptr.
+   * @param node root of the treap. Can be nullptr only if `count` is 0.
+   * @param count number of elements in the prefix. Should not be larger than
+   * the treap size.
    */
-  static void FixParent(Node* node) {
-    if (node->left) node->left->parent = node;
-    if (node->right) node->right->parent = node;
+  static uint64_t PrefixHash(const Node* node, size_t count) {
+    uint64_t result = 0;
+    uint64_t base = PolynomialHashBase();
+    while (count > 0) {
+      assert(node);
+      size_t left_size = Core::GetTreeSize(node->left);
+      if (count <= left_size) {
+        node = node->left;
+        continue;
+      }
+      // The whole left subtree and the node itself belong to the prefix
+      if (node->left) {
+        result = AddHash(MulHash(result, node->left->power), node->left->hash);
+      }
+      result = AddHash(MulHash(result, base), ElementHash(node->value));
+      count -= left_size + 1;
+      node = node->right;
+    }
+    return result;
   }
   /**
-   * @brief Merges two trees passed via their roots.
+   * @brief Cuts the tree at the given ascending positions. Complexity
+   * O(k log n) for k positions.
    *
-   * Merge will be performed in the manner, that all elements which was in the
-   * left tree will precede all elements in the right tree in case of container
-   * traversal.  No elements are copied. Method only rearranges pointers.
-   * Complexity O(log n)
+   * @return std::vector<Node*> roots of k + 1 trees, the tree i contains
+   * elements in the range [positions[i - 1], positions[i]).
+   */
+  static std::vector<Node*> CutAt(Node* root,
+                                  const std::vector<size_t>& positions) {
+    std::vector<Node*> roots(positions.size() + 1);
+    // Trees are cut from the end, so positions stay valid in the remaining
+    // part
+    for (size_t i = positions.size(); i > 0; --i) {
+      std::tie(root, roots[i]) =
+          Core::Split(/*el_number=*/positions[i - 1] + 1, root);
+    }
+    roots[0] = root;
+    return roots;
+  }
+  /**
+   * @brief Merges the given trees in their order by a balanced merge tree, so
+   * each node takes part in O(log k) merges of similarly sized trees.
    *
-   * @param lhs - root of the left treap
-   * @param rhs - root of the right treap
-   * @return Node* root of the merged treap. Can return nullptr, if both input
-   * treaps are empty.
-   */
-  static Node* Merge(Node* lhs, Node* rhs) {
-    if (!lhs) return rhs;
-    if (!rhs) return lhs;
-    Node* root = nullptr;
-    if (lhs->priority > rhs->priority) {
-      // lhs root should be on top
-      root = lhs;
-      root->left = lhs->left;
-      root->right = Merge(lhs->right, rhs);
-    } else {
-      // rhs root should be on top
-      root = rhs;
-      root->right = rhs->right;
-      root->left = Merge(lhs, rhs->left);
+   * @param roots roots of the trees, can contain nullptr. Content is destroyed.
+   * @return Node* root of the merged tree.
+   */
+  static Node* MergeBalanced(std::vector<Node*>& roots) {
+    if (roots.empty()) return nullptr;
+    for (size_t step = 1; step < roots.size(); step *= 2) {
+      for (size_t i = 0; i + step < roots.size(); i += 2 * step) {
+        roots[i] = Core::Merge(roots[i], roots[i + step]);
+      }
     }
-    FixParent(root);
+    return roots.front();
+  }
+  /**
+   * @brief Recursively recalculates size related fields of all nodes in the
+   * given treap in the bottom up manner. Complexity O(n).
+   *
+   * @param root - root of the given treap. Can be nullptr.
+   */
+  static void FixWholeTree(Node* root) {
+    if (!root) return;
+    FixWholeTree(root->left);
+    FixWholeTree(root->right);
     FixTreeSize(root);
-    return root;
   }
   /**
-   * @brief Splits current tree in two according to the given element number.
-   *
-   * All elements, which number is smaller than given one will be in the
-   * first tree and all other elements - in the second.  Complexity O(log n).
-   *
-   * @param el_number - element number according to which treap is being
-   * splitted. Note that element number, unlike element index, starts from 1.
-   * @param node - root of the treap, which is being splitted.
-   * @return Roots of two treaps in which the original one was splitted. This
-   * is, parent of each root node is nullptr. The resulting pair can contain
-   * nullptr.
-   */
-  static std::pair<Node*, Node*> Split(size_t el_number, Node* node) {
-    std::pair<Node*, Node*> result{nullptr, nullptr};
-    if (!node) return result;
-    size_t elements_until_this = GetTreeSize(node->left) + 1;
-    if (elements_until_this < el_number) {
-      // node and its left child should be stored in the first field
-      result.first = node;
-      result.first->left = node->left;
-      auto [smaller, other] =
-          Split(el_number - elements_until_this, node->right);
-      result.first->right = smaller;
-      result.second = other;
-    } else {
-      // node and its right child should be stored in the right field
-      result.second = node;
-      result.second->right = node->right;
-      auto [smaller, other] = Split(el_number, node->left);
-      result.second->left = other;
-      result.first = smaller;
-    }
-    if (result.first) {
-      FixParent(result.first);
-      FixTreeSize(result.first);
-      result.first->parent = nullptr;
-    }
-    if (result.second) {
-      FixParent(result.second);
-      FixTreeSize(result.second);
-      result.second->parent = nullptr;
-    }
+   * @brief Sorts the interval [start_pos, end_pos) by moving its elements to
+   * the scratch buffer, sorting the buffer with the given sorter and moving
+   * elements back to the same nodes in the new order.
+   *
+   * @param sorter callable, which accepts begin and end iterators of the
+   * buffer and sorts it.
+   */
+  template <typename Sorter>
+  void SortRangeWith(size_t start_pos, size_t end_pos, Sorter sorter) {
+    assert(start_pos <= end_pos && end_pos <= size_);
+    if (end_pos - start_pos < 2) return;
+    std::vector<T> buffer;
+    buffer.reserve(end_pos - start_pos);
+    auto [before, from_start] = Core::Split(start_pos + 1, root_);
+    auto [range, after] = Core::Split(end_pos - start_pos + 1, from_start);
+    /**
+     * @brief Merges the parts back on any exit, so the treap stays valid even
+     * if a move of an element or the sorter throws.
+     */
+    struct PartsMerger {
+      ~PartsMerger() {
+        // Subtree hashes depend on the element order
+        if constexpr (kHashed) FixWholeTree(range);
+        treap.root_ = Core::Merge(Core::Merge(before, range), after);
+      }
 
-    return result;
+      ImplicitTreap& treap;
+      Node* before;
+      Node* range;
+      Node* after;
+    } merger{*this, before, range, after};
+    // Nodes before moved_end have their values in the buffer
+    Node* moved_end = FindFirstNode(range);
+    std::exception_ptr error;
+    try {
+      for (; moved_end; moved_end = GetNextNode(moved_end)) {
+        buffer.push_back(std::move(moved_end->value));
+      }
+      sorter(buffer.begin(), buffer.end());
+    } catch (...) {
+      // Values left in the buffer by the sorter are still moved back
+      error = std::current_exception();
+    }
+    auto buffer_it = buffer.begin();
+    for (Node* node = FindFirstNode(range); node != moved_end;
+         node = GetNextNode(node)) {
+      node->value = std::move(*buffer_it++);
+    }
+    if (error) std::rethrow_exception(error);
   }
   /**
    * @brief Recursively destroys all elements in the treap.
    *
    * @param root - root of the given treap
    */
-  static void DeleteTree(Node* root) noexcept {
+  void DeleteTree(Node* root) noexcept {
     if (!root) return;
     DeleteTree(root->left);
     DeleteTree(root->right);
-    delete root;
+    DestroyNode(root);
+  }
+  /**
+   * @brief Destroys the node. Heap allocated node is deleted, memory of the
+   * node from the arena is kept until the arena is released.
+   */
+  void DestroyNode(Node* node) noexcept {
+    if (arenas_) {
+      for (const auto& arena : *arenas_) {
+        if (arena->Contains(node)) {
+          node->~Node();
+          return;
+        }
+      }
+    }
+    delete node;
+  }
+  /**
+   * @brief Takes shared ownership of the arenas of the other treap, whose
+   * nodes are moved into this one. Arenas are kept until this treap is
+   * cleared or compacted, even if the moved nodes are erased.
+   */
+  void AdoptArenas(const ImplicitTreap& other) {
+    if (!other.arenas_) return;
+    if (!arenas_) arenas_ = std::make_unique<ArenaList>();
+    for (const auto& arena : *other.arenas_) {
+      if (std::find(arenas_->begin(), arenas_->end(), arena) ==
+          arenas_->end()) {
+        arenas_->push_back(arena);
+      }
+    }
   }
   /**
    * @brief Gets the node which is the next after the given one in the treap
@@ -961,6 +1855,58 @@ class ImplicitTreap {
     }
     return left;
   }
+  /**
+   * @brief Visits `count` elements in order starting from the given node.
+   *
+   * The first node and its right subtree are visited, after that traversal
+   * climbs to the next ancestor and visits it together with its right
+   * subtree, and so on. Each subtree is visited as a whole segment without
+   * walking parent pointers. Complexity O(log n + count).
+   *
+   * @param first node to start from. Can be nullptr only if count is 0.
+   * @param count number of elements to visit. All of them should exist.
+   * @param visitor callable which accepts element and returns false in order
+   * to stop traversal.
+   * @return node on which visitor returned false or nullptr if all `count`
+   * elements were visited.
+   */
+  template <typename NodePtr, typename Visitor>
+  static NodePtr VisitNodes(NodePtr first, size_t count, Visitor& visitor) {
+    NodePtr node = first;
+    while (count > 0) {
+      assert(node);
+      if (!visitor(node->value)) return node;
+      if (--count == 0) break;
+      NodePtr stop = VisitSubtree<NodePtr>(node->right, count, visitor);
+      if (stop || count == 0) return stop;
+      // Climb to the closest ancestor, which follows the visited subtree
+      NodePtr child = node;
+      node = node->parent;
+      while (node->right == child) {
+        child = node;
+        node = node->parent;
+      }
+    }
+    return nullptr;
+  }
+  /**
+   * @brief Visits in order the first `count` elements of the given subtree.
+   * Visited elements are subtracted from `count`.
+   *
+   * @return node on which visitor returned false or nullptr otherwise.
+   */
+  template <typename NodePtr, typename Visitor>
+  static NodePtr VisitSubtree(NodePtr node, size_t& count, Visitor& visitor) {
+    while (node && count > 0) {
+      NodePtr stop = VisitSubtree<NodePtr>(node->left, count, visitor);
+      if (stop) return stop;
+      if (count == 0) break;
+      if (!visitor(node->value)) return node;
+      --count;
+      node = node->right;
+    }
+    return nullptr;
+  }
   /**
    * @brief Returns the first element in the given treap.
    *
@@ -1001,14 +1947,35 @@ class ImplicitTreap {
   static Node* GetElement(Node* root, size_t el_number) {
     assert(el_number > 0);
     assert(root);
-    size_t curr_el_number = GetTreeSize(root->left) + 1;
-    if (el_number < curr_el_number) {
-      return GetElement(root->left, el_number);
-    }
-    if (el_number > curr_el_number) {
-      return GetElement(root->right, el_number - curr_el_number);
+    while (true) {
+      Prefetch(root->left);
+      Prefetch(root->right);
+      size_t curr_el_number = Core::GetTreeSize(root->left) + 1;
+      // Exit is taken once per descent, so it is well predicted. The
+      // direction is selected without branches.
+      if (el_number == curr_el_number) return root;
+      bool to_right = el_number > curr_el_number;
+      el_number -= to_right ? curr_el_number : 0;
+      root = to_right ? root->right : root->left;
+      assert(root);
     }
-    return root;
+  }
+  /**
+   * @brief Gets node at the given position or nullptr for the past the end
+   * position. Complexity O(log n).
+   */
+  [[nodiscard]] Node* NodeAt(size_t pos) const {
+    return pos < size_ ? GetElement(root_, pos + 1) : nullptr;
+  }
+  /**
+   * @brief Hints the processor to load the node into the cache. Does nothing
+   * for compilers without the prefetch builtin.
+   * @param node node to be loaded. Can be nullptr.
+   */
+  static void Prefetch([[maybe_unused]] const Node* node) {
+#if defined(__GNUC__)
+    __builtin_prefetch(node);
+#endif
   }
   /**
    * @brief Shifts current node to another valid node in the tree.
@@ -1020,8 +1987,9 @@ class ImplicitTreap {
    * @param shift number of elements on which we need to shift. Can be negative.
    * @return Node* shifted node or nullptr in case of incorrect input.
    */
-  static Node* ShiftNode(const Node* curr_node, const Node* root, int shift) {
-    size_t curr_number = GetElementNumber(curr_node);
+  static Node* ShiftNode(const Node* curr_node, const Node* root,
+                         std::ptrdiff_t shift) {
+    size_t curr_number = Core::GetElementNumber(curr_node);
     if (shift < 0 && curr_number > static_cast<size_t>(-shift)) {
       // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
       return GetElement(const_cast<Node*>(root),
@@ -1035,32 +2003,13 @@ class ImplicitTreap {
     }
     return nullptr;
   }
-  /**
-   * @brief Calculates the element number which corresponds to the given node.
-   * Complexity O(log n).
-   *
-   *
-   * @param node element node of the interest. Cannot be nullptr.
-   * @return size_t element number which corresponds to the given node. Note
-   * that unlike the index element number numeration start from 1.
-   */
-  static size_t GetElementNumber(const Node* node) {
-    assert(node);
-    size_t curr_num = GetTreeSize(node->left) + 1;
-    const Node* parent = node->parent;
-    while (parent) {
-      if (parent->right == node) {
-        curr_num += GetTreeSize(parent->left) + 1;
-      }
-      node = parent;
-      parent = parent->parent;
-    }
-    return curr_num;
-  }
 
   Node* root_ = nullptr;
-  std::mt19937_64 rnd_{std::random_device{}()};
+  SplitMix64 rnd_;
   size_t size_ = 0;
+  /**Arenas, which may contain nodes of this treap. Allocated only after
+   * compaction, so treaps which are never compacted stay small.*/
+  std::unique_ptr<ArenaList> arenas_;
 };
 
 }  // namespace alpa
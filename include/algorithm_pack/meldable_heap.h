@@ -0,0 +1,330 @@
+﻿#ifndef ALGORITHM_PACK_MELDABLE_HEAP_H
+#define ALGORITHM_PACK_MELDABLE_HEAP_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "algorithm_pack/random.h"
+
+namespace alpa {
+/**
+ * @brief Realization of the randomized meldable heap.
+ *
+ * Heap is a binary tree ordered by the comparator. Two heaps with arbitrary
+ * overlapping keys are melded by walking down a random path of the heap with
+ * the smaller root, which has expected length O(log n) for any tree shape.
+ * All other operations are expressed via meld, hence push, pop, meld, decrease
+ * key and erase have expected O(log n) complexity. Nodes keep parent pointers,
+ * which allows to address the stored elements by stable handles.
+ *
+ * @tparam T type of stored elements.
+ * @tparam Compare comparator, the heap provides access to the smallest element
+ * according to it. Has to be default constructible.
+ */
+template <typename T, typename Compare = std::less<T>>
+class MeldableHeap {
+  struct Node;
+
+ public:
+  /**
+   * @brief Stable reference to the element stored in the heap.
+   *
+   * Nodes are never relocated, therefore handle remains valid until the
+   * element it refers to is popped or erased. If the heap is melded into
+   * another one, handle should be used with that heap.
+   */
+  class Handle {
+   public:
+    friend class MeldableHeap;
+
+    friend bool operator==(const Handle& lhs, const Handle& rhs) {
+      return lhs.node_ == rhs.node_;
+    }
+    friend bool operator!=(const Handle& lhs, const Handle& rhs) {
+      return lhs.node_ != rhs.node_;
+    }
+    /**
+     * @brief Creates empty handle, which does not refer to any element.
+     */
+    Handle() = default;
+    /**@brief Returns true if the handle refers to an element.*/
+    explicit operator bool() const { return node_ != nullptr; }
+    /**
+     * @brief Gets the element referred by the handle. Should be called only on
+     * non empty handles. Element cannot be modified in place, use
+     * DecreaseKey() instead.
+     */
+    const T& operator*() const { return node_->value; }
+    /**
+     * @brief Provides access to the element referred by the handle.
+     */
+    const T* operator->() const { return &node_->value; }
+
+   private:
+    explicit Handle(Node* node) : node_(node) {}
+
+    Node* node_ = nullptr;
+  };
+  /**
+   * @brief Creates an empty heap.
+   */
+  MeldableHeap() = default;
+  /**
+   * @brief Creates an empty heap with the given seed set in the random
+   * generator.
+   */
+  explicit MeldableHeap(uint64_t seed) : rnd_(seed) {}
+  /**
+   * @brief Creates heap from the given range of elements. Complexity O(n).
+   *
+   * Elements are heapified in place and linked as a complete binary tree, so
+   * no meld is performed during the construction.
+   *
+   * @param first iterator to the first element of the range.
+   * @param last iterator past the last element of the range.
+   * @param seed will be set in the random generator.
+   */
+  template <typename InputIt>
+  MeldableHeap(InputIt first, InputIt last, uint64_t seed) : rnd_(seed) {
+    std::vector<T> values(first, last);
+    std::make_heap(values.begin(), values.end(),
+                   [this](const T& lhs, const T& rhs) {
+                     return comp_(rhs, lhs);
+                   });
+    std::vector<Node*> nodes;
+    nodes.reserve(values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+      nodes.push_back(new Node(std::move(values[i])));
+      if (i == 0) continue;
+      Node* parent = nodes[(i - 1) / 2];
+      nodes.back()->parent = parent;
+      if (i % 2 == 1) {
+        parent->left = nodes.back();
+      } else {
+        parent->right = nodes.back();
+      }
+    }
+    root_ = nodes.empty() ? nullptr : nodes.front();
+    size_ = nodes.size();
+  }
+  /**
+   * @brief Construct a new heap by moving data from other. Complexity O(1).
+   * Handles of the `other` remain valid and refer to this heap.
+   */
+  MeldableHeap(MeldableHeap&& other) noexcept
+      : root_(std::exchange(other.root_, nullptr)),
+        rnd_(other.rnd_),
+        size_(std::exchange(other.size_, 0)) {}
+  /**
+   * @brief Replaces current heap data by the data from other. Old data is
+   * destroyed. Complexity O(n), where n is the old size of this heap.
+   */
+  MeldableHeap& operator=(MeldableHeap&& other) noexcept {
+    MeldableHeap tmp(std::move(other));
+    Swap(tmp);
+    return *this;
+  }
+  MeldableHeap(const MeldableHeap&) = delete;
+  MeldableHeap& operator=(const MeldableHeap&) = delete;
+  /**
+   * @brief Destroys the heap by deleting each node. Complexity O(n).
+   */
+  ~MeldableHeap() { Clear(); }
+  /**
+   * @brief Swaps content of two heaps. Complexity O(1).
+   */
+  void Swap(MeldableHeap& other) noexcept {
+    std::swap(root_, other.root_);
+    std::swap(rnd_, other.rnd_);
+    std::swap(size_, other.size_);
+  }
+  /**
+   * @brief Adds the given value to the heap. Complexity O(log n).
+   *
+   * @return Handle handle of the inserted element.
+   */
+  Handle Push(const T& value) {
+    Node* new_node = new Node(value);
+    SetRoot(Meld(root_, new_node));
+    ++size_;
+    return Handle{new_node};
+  }
+  /**
+   * @brief Gets the smallest element according to the comparator.
+   * Complexity O(1). Heap should not be empty.
+   */
+  [[nodiscard]] const T& Top() const {
+    assert(root_);
+    return root_->value;
+  }
+  /**
+   * @brief Gets handle of the smallest element. Complexity O(1). Heap should
+   * not be empty.
+   */
+  [[nodiscard]] Handle TopHandle() const {
+    assert(root_);
+    return Handle{root_};
+  }
+  /**
+   * @brief Removes the smallest element from the heap. Complexity O(log n).
+   * Heap should not be empty. Invalidates only handle of the removed element.
+   */
+  void Pop() {
+    assert(root_);
+    Node* old_root = root_;
+    SetRoot(Meld(old_root->left, old_root->right));
+    delete old_root;
+    --size_;
+  }
+  /**
+   * @brief Moves all elements of the given heap into the current one. Keys of
+   * two heaps may overlap arbitrarily. Complexity O(log n).
+   *
+   * @param other heap which will be melded, it becomes empty. Its handles
+   * remain valid and refer to this heap.
+   * @return MeldableHeap& reference to the melded heap.
+   */
+  MeldableHeap& Meld(MeldableHeap&& other) {
+    SetRoot(Meld(root_, std::exchange(other.root_, nullptr)));
+    size_ += std::exchange(other.size_, 0);
+    return *this;
+  }
+  /**
+   * @brief Replaces the element referred by the handle with the given value,
+   * which should not be greater than the current one. Complexity O(log n).
+   *
+   * @param handle non empty handle of the element stored in this heap.
+   * @param value new value of the element.
+   */
+  void DecreaseKey(const Handle& handle, const T& value) {
+    assert(handle);
+    Node* node = handle.node_;
+    assert(!comp_(node->value, value));
+    node->value = value;
+    if (!node->parent || !comp_(value, node->parent->value)) return;
+    Detach(node);
+    SetRoot(Meld(root_, node));
+  }
+  /**
+   * @brief Removes the element referred by the handle. Complexity O(log n).
+   * Invalidates only the given handle.
+   *
+   * @param handle non empty handle of the element stored in this heap.
+   */
+  void Erase(const Handle& handle) {
+    assert(handle);
+    Detach(handle.node_);
+    delete handle.node_;
+    --size_;
+  }
+  /**
+   * @brief Removes all elements from the heap. Complexity O(n).
+   */
+  void Clear() {
+    std::vector<Node*> stack;
+    if (root_) stack.push_back(root_);
+    while (!stack.empty()) {
+      Node* node = stack.back();
+      stack.pop_back();
+      if (node->left) stack.push_back(node->left);
+      if (node->right) stack.push_back(node->right);
+      delete node;
+    }
+    root_ = nullptr;
+    size_ = 0;
+  }
+  /**
+   * @brief Checks whether the heap is empty or not.
+   * @return true if the heap is empty, false otherwise.
+   */
+  [[nodiscard]] bool Empty() const { return root_ == nullptr; }
+  /**
+   * @brief Gets the number of elements in the heap.
+   */
+  [[nodiscard]] size_t Size() const { return size_; }
+
+ private:
+  /**
+   * @brief Describes single node in the heap.
+   */
+  struct Node {
+    explicit Node(const T& g_value) : value(g_value) {}
+    explicit Node(T&& g_value) : value(std::move(g_value)) {}
+
+    T value;
+    Node* left = nullptr;
+    Node* right = nullptr;
+    Node* parent = nullptr;
+  };
+  /**
+   * @brief Melds two heaps passed as their roots.
+   *
+   * Root of the second heap is pushed down along a random path of the first
+   * heap until it finds the place where heap order is kept, then the rest of
+   * the path becomes the heap which is pushed down. Method does not perform
+   * any copying, it simply rearranges pointers. Complexity O(log n).
+   *
+   * @return root of the melded heap. Can return nullptr if both input
+   * parameters are nullptr. Parent pointer of the root is not updated.
+   */
+  Node* Meld(Node* lhs, Node* rhs) {
+    if (!lhs) return rhs;
+    if (!rhs) return lhs;
+    if (comp_(rhs->value, lhs->value)) std::swap(lhs, rhs);
+    Node* parent = lhs;
+    while (rhs) {
+      Node*& slot = (rnd_() & 1U) != 0 ? parent->left : parent->right;
+      Node* child = slot;
+      if (!child || comp_(rhs->value, child->value)) {
+        // rhs takes the place of the child, the child is pushed down into it
+        slot = rhs;
+        rhs->parent = parent;
+        parent = rhs;
+        rhs = child;
+      } else {
+        parent = child;
+      }
+    }
+    return lhs;
+  }
+  /**
+   * @brief Sets the given node as the root of the heap.
+   * @param node new root. Can be nullptr.
+   */
+  void SetRoot(Node* node) {
+    root_ = node;
+    if (root_) root_->parent = nullptr;
+  }
+  /**
+   * @brief Unlinks the node from the heap, replacing it with the meld of its
+   * children. After the call the node has no parent and no children.
+   * Complexity O(log n).
+   */
+  void Detach(Node* node) {
+    Node* parent = node->parent;
+    Node* replacement = Meld(node->left, node->right);
+    if (replacement) replacement->parent = parent;
+    if (!parent) {
+      root_ = replacement;
+    } else if (parent->left == node) {
+      parent->left = replacement;
+    } else {
+      parent->right = replacement;
+    }
+    node->left = nullptr;
+    node->right = nullptr;
+    node->parent = nullptr;
+  }
+
+  Node* root_ = nullptr;
+  SplitMix64 rnd_;
+  size_t size_ = 0;
+  Compare comp_{};
+};
+}  // namespace alpa
+#endif  // ALGORITHM_PACK_MELDABLE_HEAP_H
@@ -0,0 +1,273 @@
+﻿#ifndef ALGORITHM_PACK_NODE_ARENA_H
+#define ALGORITHM_PACK_NODE_ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace alpa {
+/**
+ * @brief Source of memory for container nodes.
+ */
+enum class NodeMemory {
+  /**Memory is taken from the general purpose allocator.*/
+  kHeap,
+  /**Memory is mapped in 2 MiB aligned slabs, which are advised to be backed
+   * by transparent huge pages. If the system does not support them, normal
+   * pages are used.*/
+  kHugePages
+};
+/**
+ * @brief Memory usage of node arenas.
+ */
+struct ArenaStats {
+  /**Number of bytes reserved by the arena.*/
+  size_t reserved_bytes = 0;
+  /**Number of the reserved bytes backed by huge pages. It is an estimate
+   * taken from `/proc/self/smaps`, always 0 on other systems.*/
+  size_t huge_page_bytes = 0;
+  /**
+   * @brief Gets share of the reserved memory backed by huge pages.
+   */
+  [[nodiscard]] double HugePageCoverage() const {
+    return reserved_bytes == 0 ? 0.0
+                               : static_cast<double>(huge_page_bytes) /
+                                     static_cast<double>(reserved_bytes);
+  }
+};
+
+/**
+ * @brief Contiguous block of memory for nodes.
+ *
+ * Huge page block is mapped with `mmap()`, aligned to the huge page size and
+ * advised by `MADV_HUGEPAGE`, so the kernel can back it by transparent huge
+ * pages and each TLB entry covers 2 MiB of nodes. Heap block is taken from
+ * `operator new`.
+ */
+class MemoryBlock {
+ public:
+  static constexpr size_t kHugePageSize = size_t{2} << 20U;
+  /**
+   * @brief Reserves block of at least the given size.
+   *
+   * @param bytes required size of the block.
+   * @param alignment required alignment, not larger than the huge page size.
+   * @param memory source of the memory.
+   * @throw std::bad_alloc if the memory cannot be reserved.
+   */
+  MemoryBlock(size_t bytes, size_t alignment,
+              [[maybe_unused]] NodeMemory memory)
+      : alignment_(alignment) {
+#if defined(__linux__)
+    if (memory == NodeMemory::kHugePages) {
+      size_ = (bytes + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+      // Mapping is extended by a huge page and trimmed to become aligned
+      size_t mapped_size = size_ + kHugePageSize;
+      void* mapped = ::mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (mapped == MAP_FAILED) throw std::bad_alloc();
+      auto begin = reinterpret_cast<uintptr_t>(mapped);
+      uintptr_t aligned =
+          (begin + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+      if (aligned > begin) {
+        ::munmap(mapped, aligned - begin);
+      }
+      size_t tail = mapped_size - (aligned - begin) - size_;
+      if (tail > 0) {
+        ::munmap(reinterpret_cast<void*>(aligned + size_), tail);
+      }
+      data_ = reinterpret_cast<void*>(aligned);
+      // Failure only means that the memory is backed by normal pages
+      ::madvise(data_, size_, MADV_HUGEPAGE);
+      mapped_ = true;
+      return;
+    }
+#endif
+    size_ = std::max<size_t>(bytes, 1);
+    data_ = ::operator new(size_, std::align_val_t{alignment_});
+  }
+  MemoryBlock(const MemoryBlock&) = delete;
+  MemoryBlock& operator=(const MemoryBlock&) = delete;
+  MemoryBlock(MemoryBlock&& other) noexcept
+      : data_(std::exchange(other.data_, nullptr)),
+        size_(std::exchange(other.size_, 0)),
+        alignment_(other.alignment_),
+        mapped_(other.mapped_) {}
+  MemoryBlock& operator=(MemoryBlock&& other) noexcept {
+    MemoryBlock tmp(std::move(other));
+    std::swap(data_, tmp.data_);
+    std::swap(size_, tmp.size_);
+    std::swap(alignment_, tmp.alignment_);
+    std::swap(mapped_, tmp.mapped_);
+    return *this;
+  }
+  /**
+   * @brief Releases the block. Objects placed in it should be destroyed.
+   */
+  ~MemoryBlock() {
+    if (!data_) return;
+#if defined(__linux__)
+    if (mapped_) {
+      ::munmap(data_, size_);
+      return;
+    }
+#endif
+    ::operator delete(data_, std::align_val_t{alignment_});
+  }
+  /**@brief Gets the beginning of the block.*/
+  [[nodiscard]] void* Data() const { return data_; }
+  /**@brief Gets the size of the block in bytes.*/
+  [[nodiscard]] size_t Size() const { return size_; }
+  /**@brief Checks whether the block is mapped in huge page slabs.*/
+  [[nodiscard]] bool IsMapped() const { return mapped_; }
+  /**
+   * @brief Adds memory usage of the blocks to the statistics.
+   *
+   * Huge page usage is read from `/proc/self/smaps` once for all blocks.
+   * Kernel may merge adjacent mappings, so for such mappings usage is
+   * limited by the size of their intersection with the blocks.
+   */
+  static void CollectStats(const std::vector<const MemoryBlock*>& blocks,
+                           ArenaStats& stats) {
+    std::vector<std::pair<uintptr_t, uintptr_t>> ranges;
+    for (const MemoryBlock* block : blocks) {
+      stats.reserved_bytes += block->size_;
+      if (!block->mapped_) continue;
+      auto begin = reinterpret_cast<uintptr_t>(block->data_);
+      ranges.emplace_back(begin, begin + block->size_);
+    }
+    if (ranges.empty()) return;
+    std::ifstream smaps("/proc/self/smaps");
+    std::string line;
+    uintptr_t overlap = 0;
+    while (std::getline(smaps, line)) {
+      uintptr_t begin = 0;
+      uintptr_t end = 0;
+      char dash = 0;
+      std::istringstream header(line);
+      if (header >> std::hex >> begin >> dash >> end && dash == '-') {
+        // Mapping header starts with its address range
+        overlap = 0;
+        for (const auto& [lo, hi] : ranges) {
+          if (lo < end && begin < hi) {
+            overlap += std::min(hi, end) - std::max(lo, begin);
+          }
+        }
+        continue;
+      }
+      constexpr std::string_view kField = "AnonHugePages:";
+      if (overlap == 0 || line.compare(0, kField.size(), kField) != 0) {
+        continue;
+      }
+      size_t kilobytes = 0;
+      std::istringstream(line.substr(kField.size())) >> kilobytes;
+      stats.huge_page_bytes += std::min<size_t>(kilobytes * 1024, overlap);
+    }
+  }
+
+ private:
+  void* data_ = nullptr;
+  size_t size_ = 0;
+  size_t alignment_;
+  bool mapped_ = false;
+};
+
+/**
+ * @brief Pool of equally sized nodes allocated from memory blocks.
+ *
+ * Blocks grow geometrically from one huge page, freed nodes are kept in an
+ * intrusive free list and reused. All blocks are released with the pool, so
+ * nodes should not outlive it.
+ *
+ * @tparam T type of nodes.
+ */
+template <typename T>
+class NodeArena {
+ public:
+  /**
+   * @brief Creates an empty pool.
+   * @param memory source of the memory for blocks.
+   */
+  explicit NodeArena(NodeMemory memory) : memory_(memory) {}
+  NodeArena(const NodeArena&) = delete;
+  NodeArena(NodeArena&&) = delete;
+  NodeArena& operator=(const NodeArena&) = delete;
+  NodeArena& operator=(NodeArena&&) = delete;
+  ~NodeArena() = default;
+  /**
+   * @brief Constructs a new node from the given arguments. Amortized
+   * complexity O(1).
+   */
+  template <typename... Args>
+  T* New(Args&&... args) {
+    void* place = nullptr;
+    if (free_list_) {
+      place = std::exchange(free_list_, free_list_->next);
+    } else {
+      if (used_ == capacity_) AddBlock();
+      place = static_cast<Slot*>(blocks_.back().Data()) + used_++;
+    }
+    return ::new (place) T(std::forward<Args>(args)...);
+  }
+  /**
+   * @brief Destroys the node allocated by this pool and keeps its memory for
+   * reuse.
+   */
+  void Delete(T* node) noexcept {
+    node->~T();
+    auto* slot = ::new (static_cast<void*>(node)) Slot;
+    slot->next = free_list_;
+    free_list_ = slot;
+  }
+  /**
+   * @brief Gets memory usage of the pool.
+   */
+  [[nodiscard]] ArenaStats Stats() const {
+    ArenaStats stats;
+    std::vector<const MemoryBlock*> blocks;
+    for (const auto& block : blocks_) blocks.push_back(&block);
+    MemoryBlock::CollectStats(blocks, stats);
+    return stats;
+  }
+
+ private:
+  /**
+   * @brief Memory of a single node, which stores link to the next free slot
+   * while the node is not constructed.
+   */
+  union Slot {
+    Slot* next;
+    alignas(T) std::byte storage[sizeof(T)];
+  };
+
+  /**
+   * @brief Adds a block twice as large as the previous one.
+   */
+  void AddBlock() {
+    size_t bytes = blocks_.empty() ? MemoryBlock::kHugePageSize
+                                   : blocks_.back().Size() * 2;
+    blocks_.emplace_back(bytes, alignof(Slot), memory_);
+    capacity_ = blocks_.back().Size() / sizeof(Slot);
+    used_ = 0;
+  }
+
+  NodeMemory memory_;
+  std::vector<MemoryBlock> blocks_;
+  /**Number of slots in the last block and the number of them taken.*/
+  size_t capacity_ = 0;
+  size_t used_ = 0;
+  Slot* free_list_ = nullptr;
+};
+}  // namespace alpa
+#endif  // ALGORITHM_PACK_NODE_ARENA_H
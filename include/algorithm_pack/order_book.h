@@ -0,0 +1,323 @@
+﻿#ifndef ALGORITHM_PACK_ORDER_BOOK_H
+#define ALGORITHM_PACK_ORDER_BOOK_H
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+#include "algorithm_pack/implicit_treap.h"
+#include "algorithm_pack/random.h"
+#include "algorithm_pack/treap.h"
+
+namespace alpa {
+/**
+ * @brief Side of the order in the book.
+ */
+enum class Side { kBuy, kSell };
+
+/**
+ * @brief Limit order book with price-time priority.
+ *
+ * Price levels of each side are stored in a Treap keyed by price, pointers to
+ * the best levels are cached, so best bid and ask are available in O(1). Each
+ * level keeps its orders in an ImplicitTreap in arrival order and every order
+ * is addressed by a stable handle of that treap, hence cancellation and queue
+ * position queries cost O(log k), where k is the number of orders on the
+ * level, and do not scan the queue. Operations mirror ITCH-like feed messages:
+ * add, reduce (execution or partial cancel), delete and replace.
+ *
+ * @tparam Price type of prices. Has to be copyable and define `operator<()`.
+ */
+template <typename Price>
+class OrderBook {
+ public:
+  using OrderId = uint64_t;
+  using Quantity = uint64_t;
+  /**
+   * @brief Describes single resting order.
+   */
+  struct Order {
+    OrderId id = 0;
+    Quantity quantity = 0;
+  };
+
+  /**
+   * @brief Creates an empty book with default seed.
+   */
+  OrderBook() : OrderBook(SplitMix64{}()) {}
+  /**
+   * @brief Creates an empty book. The given seed initializes random generator,
+   * which provides priorities for all underlying treaps.
+   */
+  explicit OrderBook(uint64_t seed)
+      : rnd_(seed), bids_(/*seed=*/rnd_()), asks_(/*seed=*/rnd_()) {}
+  OrderBook(const OrderBook&) = delete;
+  OrderBook(OrderBook&&) = delete;
+  OrderBook& operator=(const OrderBook&) = delete;
+  OrderBook& operator=(OrderBook&&) = delete;
+  ~OrderBook() = default;
+  /**
+   * @brief Adds new order to the end of the queue of its price level.
+   * Complexity O(log n).
+   *
+   * @param id unique identifier of the order.
+   * @param side side of the order.
+   * @param price limit price of the order.
+   * @param quantity quantity of the order, should be positive.
+   * @return true if the order was added, false if the order with the same id
+   * is already in the book or the quantity is zero.
+   */
+  bool Add(OrderId id, Side side, const Price& price, Quantity quantity) {
+    if (quantity == 0 || orders_.count(id) != 0) return false;
+    Levels& levels = GetLevels(side);
+    Level* level = levels.Find(price);
+    if (!level) {
+      level = levels.Insert(price, Level{LevelQueue(/*seed=*/rnd_()), 0});
+      RefreshBest(side);
+    }
+    OrderHandle handle = level->queue.PushBack(Order{id, quantity});
+    level->volume += quantity;
+    orders_.emplace(id, OrderRef{side, price, level, handle});
+    return true;
+  }
+  /**
+   * @brief Reduces the quantity of the order, which corresponds to execution
+   * or partial cancellation messages. The order keeps its queue position.
+   * Complexity O(1) or O(log n) if the order is removed.
+   *
+   * @param id identifier of the order.
+   * @param quantity quantity to subtract. If it is not less than the remaining
+   * quantity of the order, the order is removed from the book.
+   * @return true if the order was found, false otherwise.
+   */
+  bool Reduce(OrderId id, Quantity quantity) {
+    auto it = orders_.find(id);
+    if (it == orders_.end()) return false;
+    OrderRef& ref = it->second;
+    if (quantity >= ref.handle->quantity) {
+      RemoveOrder(it);
+    } else {
+      ref.handle->quantity -= quantity;
+      ref.level->volume -= quantity;
+    }
+    return true;
+  }
+  /**
+   * @brief Removes the order from the book. Complexity O(log n).
+   *
+   * @return true if the order was found, false otherwise.
+   */
+  bool Delete(OrderId id) {
+    auto it = orders_.find(id);
+    if (it == orders_.end()) return false;
+    RemoveOrder(it);
+    return true;
+  }
+  /**
+   * @brief Replaces the order by the new one with the same side. The new order
+   * loses time priority and goes to the end of its level queue.
+   * Complexity O(log n).
+   *
+   * @param id identifier of the order to be replaced.
+   * @param new_id identifier of the new order. Can be equal to `id`.
+   * @return true if the order was replaced, false if `id` was not found,
+   * `new_id` is already used by another order or the quantity is zero. In that
+   * case the book is not changed.
+   */
+  bool Replace(OrderId id, OrderId new_id, const Price& price,
+               Quantity quantity) {
+    auto it = orders_.find(id);
+    if (it == orders_.end() || quantity == 0) return false;
+    if (new_id != id && orders_.count(new_id) != 0) return false;
+    Side side = it->second.side;
+    RemoveOrder(it);
+    return Add(new_id, side, price, quantity);
+  }
+  /**
+   * @brief Matches incoming aggressive order against the opposite side of the
+   * book in price-time priority. Unfilled quantity is not added to the book.
+   * Complexity O((m + l) log n), where m is the number of fully filled orders
+   * and l is the number of cleared levels.
+   *
+   * @param side side of the incoming order.
+   * @param limit limit price of the incoming order. Levels worse than the limit
+   * are not touched.
+   * @param quantity quantity of the incoming order.
+   * @param on_fill callable with signature `void(OrderId resting_id, const
+   * Price& price, Quantity quantity)`, which is invoked for each fill in the
+   * matching order. It must not modify the book.
+   * @return Quantity total filled quantity.
+   */
+  template <typename OnFill>
+  Quantity Match(Side side, const Price& limit, Quantity quantity,
+                 OnFill on_fill) {
+    Side resting_side = side == Side::kBuy ? Side::kSell : Side::kBuy;
+    Quantity filled = 0;
+    while (quantity > 0) {
+      LevelEntry* best = best_[SideIndex(resting_side)];
+      if (!best || IsBetter(resting_side, limit, best->first)) break;
+      Level& level = best->second;
+      Price price = best->first;
+      OrderHandle front = level.queue.HandleAt(0);
+      Quantity fill = std::min(quantity, front->quantity);
+      on_fill(front->id, price, fill);
+      quantity -= fill;
+      filled += fill;
+      if (fill == front->quantity) {
+        RemoveOrder(orders_.find(front->id));
+      } else {
+        front->quantity -= fill;
+        level.volume -= fill;
+      }
+    }
+    return filled;
+  }
+  /**
+   * @overload
+   */
+  Quantity Match(Side side, const Price& limit, Quantity quantity) {
+    return Match(side, limit, quantity,
+                 [](OrderId, const Price&, Quantity) {});
+  }
+  /**
+   * @brief Gets the highest buy price. Complexity O(1).
+   * @return std::optional<Price> empty if there are no buy orders.
+   */
+  [[nodiscard]] std::optional<Price> BestBid() const {
+    return BestPrice(Side::kBuy);
+  }
+  /**
+   * @brief Gets the lowest sell price. Complexity O(1).
+   * @return std::optional<Price> empty if there are no sell orders.
+   */
+  [[nodiscard]] std::optional<Price> BestAsk() const {
+    return BestPrice(Side::kSell);
+  }
+  /**
+   * @brief Gets the total quantity of orders on the given price level.
+   * Complexity O(log n).
+   */
+  [[nodiscard]] Quantity Volume(Side side, const Price& price) const {
+    const Level* level = GetLevels(side).Find(price);
+    return level ? level->volume : 0;
+  }
+  /**
+   * @brief Gets the number of orders on the given price level.
+   * Complexity O(log n).
+   */
+  [[nodiscard]] size_t OrderCount(Side side, const Price& price) const {
+    const Level* level = GetLevels(side).Find(price);
+    return level ? level->queue.Size() : 0;
+  }
+  /**
+   * @brief Gets the number of price levels on the given side.
+   */
+  [[nodiscard]] size_t LevelCount(Side side) const {
+    return GetLevels(side).Size();
+  }
+  /**
+   * @brief Gets the number of orders ahead of the given one on its price
+   * level. Complexity O(log k), where k is the number of orders on the level.
+   *
+   * @return std::optional<size_t> position of the order in its level queue,
+   * starting from 0, or empty if the order is not in the book.
+   */
+  [[nodiscard]] std::optional<size_t> QueuePosition(OrderId id) const {
+    auto it = orders_.find(id);
+    if (it == orders_.end()) return std::nullopt;
+    return it->second.level->queue.IndexOf(it->second.handle);
+  }
+  /**
+   * @brief Searches the resting order by its identifier. Complexity O(1).
+   *
+   * @return const Order* non owning pointer to the order or nullptr if the
+   * order is not in the book.
+   */
+  [[nodiscard]] const Order* FindOrder(OrderId id) const {
+    auto it = orders_.find(id);
+    return it == orders_.end() ? nullptr : &*it->second.handle;
+  }
+  /**@brief Gets the number of orders in the book.*/
+  [[nodiscard]] size_t Size() const { return orders_.size(); }
+  /**@brief Checks whether the book contains no orders.*/
+  [[nodiscard]] bool Empty() const { return orders_.empty(); }
+
+ private:
+  using LevelQueue = ImplicitTreap<Order>;
+  using OrderHandle = typename LevelQueue::Handle;
+  /**
+   * @brief Describes single price level: orders in arrival order and their
+   * total quantity.
+   */
+  struct Level {
+    LevelQueue queue;
+    Quantity volume = 0;
+  };
+  using Levels = Treap<Price, Level>;
+  using LevelEntry = std::pair<const Price, Level>;
+  /**
+   * @brief Location of the resting order. Level pointer is stable, because
+   * treap nodes are never relocated.
+   */
+  struct OrderRef {
+    Side side = Side::kBuy;
+    Price price;
+    Level* level = nullptr;
+    OrderHandle handle;
+  };
+  using Orders = std::unordered_map<OrderId, OrderRef>;
+
+  static size_t SideIndex(Side side) { return side == Side::kBuy ? 0 : 1; }
+  /**
+   * @brief Checks whether the price `lhs` is strictly better than `rhs` for
+   * orders of the given side.
+   */
+  static bool IsBetter(Side side, const Price& lhs, const Price& rhs) {
+    return side == Side::kBuy ? rhs < lhs : lhs < rhs;
+  }
+  Levels& GetLevels(Side side) { return side == Side::kBuy ? bids_ : asks_; }
+  const Levels& GetLevels(Side side) const {
+    return side == Side::kBuy ? bids_ : asks_;
+  }
+  [[nodiscard]] std::optional<Price> BestPrice(Side side) const {
+    const LevelEntry* best = best_[SideIndex(side)];
+    if (!best) return std::nullopt;
+    return best->first;
+  }
+  /**
+   * @brief Updates cached best level of the given side. Has to be called each
+   * time the set of levels of that side is changed. Complexity O(log n).
+   */
+  void RefreshBest(Side side) {
+    best_[SideIndex(side)] = side == Side::kBuy ? bids_.Max() : asks_.Min();
+  }
+  /**
+   * @brief Removes the order from its level and from the index. Empty level is
+   * removed as well. Complexity O(log n).
+   */
+  void RemoveOrder(typename Orders::iterator it) {
+    assert(it != orders_.end());
+    OrderRef& ref = it->second;
+    Level* level = ref.level;
+    level->volume -= ref.handle->quantity;
+    level->queue.Erase(ref.handle);
+    if (level->queue.Empty()) {
+      GetLevels(ref.side).Erase(ref.price);
+      RefreshBest(ref.side);
+    }
+    orders_.erase(it);
+  }
+
+  SplitMix64 rnd_;
+  Levels bids_;
+  Levels asks_;
+  std::array<LevelEntry*, 2> best_{nullptr, nullptr};
+  Orders orders_;
+};
+}  // namespace alpa
+#endif  // ALGORITHM_PACK_ORDER_BOOK_H
@@ -0,0 +1,90 @@
+﻿#ifndef ALGORITHM_PACK_RANDOM_H
+#define ALGORITHM_PACK_RANDOM_H
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <random>
+
+namespace alpa {
+/**
+ * @brief Mixes bits of the given value by the SplitMix64 finalizer, so close
+ * inputs give unrelated outputs. The mapping is a bijection.
+ */
+inline uint64_t MixBits(uint64_t value) {
+  value = (value ^ (value >> 30U)) * 0xbf58476d1ce4e5b9U;
+  value = (value ^ (value >> 27U)) * 0x94d049bb133111ebU;
+  return value ^ (value >> 31U);
+}
+/**
+ * @brief Priority policy of Treap and ImplicitTreap: priorities are drawn from
+ * the random generator of the container and stored in nodes.
+ */
+struct RandomPriority {};
+/**
+ * @brief SplitMix64 pseudo random generator.
+ *
+ * Generator keeps a single 64-bit state and produces each number by a few
+ * arithmetic operations, which is enough for treap priorities and random
+ * walks. In comparison with `std::mt19937_64` it takes 8 bytes instead of
+ * about 2.5 KB and its seeding is free, which matters for containers, that
+ * are created in large numbers and stay small. Satisfies requirements of the
+ * uniform random bit generator, so it can be used with standard
+ * distributions. Not suitable for cryptography.
+ */
+class SplitMix64 {
+ public:
+  using result_type = uint64_t;
+  /**
+   * @brief Creates generator with the distinct seed. Only the first call in
+   * the program touches `std::random_device`, all other seeds are derived
+   * from it by the atomic counter.
+   */
+  SplitMix64() : state_(NextDefaultSeed()) {}
+  /**
+   * @brief Creates generator with the given seed.
+   */
+  explicit SplitMix64(uint64_t seed) : state_(seed) {}
+  /**
+   * @brief Sets the given seed, so the generator repeats its sequence.
+   */
+  void Seed(uint64_t seed) { state_ = seed; }
+  /**
+   * @brief Generates next pseudo random number.
+   */
+  result_type operator()() {
+    state_ += kGamma;
+    return MixBits(state_);
+  }
+  /**
+   * @brief Advances the generator as if it was called `count` times.
+   * Complexity O(1), so several threads can take disjoint parts of one
+   * sequence.
+   */
+  void Discard(uint64_t count) { state_ += kGamma * count; }
+  static constexpr result_type min() {
+    return std::numeric_limits<result_type>::min();
+  }
+  static constexpr result_type max() {
+    return std::numeric_limits<result_type>::max();
+  }
+
+ private:
+  static constexpr uint64_t kGamma = 0x9e3779b97f4a7c15U;
+
+  /**
+   * @brief Gets seed for the default constructed generator.
+   */
+  static uint64_t NextDefaultSeed() {
+    static std::atomic<uint64_t> counter{
+        (uint64_t{std::random_device{}()} << 32U) ^ std::random_device{}()};
+    // Seeds differ by a large multiple of the generator step, so their
+    // sequences do not overlap soon
+    return counter.fetch_add(kGamma * 0x5851f42d4c957f2dU,
+                             std::memory_order_relaxed);
+  }
+
+  uint64_t state_;
+};
+}  // namespace alpa
+#endif  // ALGORITHM_PACK_RANDOM_H
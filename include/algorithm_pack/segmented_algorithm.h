@@ -0,0 +1,151 @@
+﻿#ifndef ALGORITHM_PACK_SEGMENTED_ALGORITHM_H
+#define ALGORITHM_PACK_SEGMENTED_ALGORITHM_H
+
+#include <algorithm>
+#include <numeric>
+#include <type_traits>
+#include <utility>
+
+namespace alpa {
+/**
+ * @brief Checks whether the iterator is segmented.
+ *
+ * Segmented iterator declares `segmented_iterator_tag` type and provides static
+ * method `VisitRange(first, last, visitor)`, which calls `visitor` for each
+ * element of the range until it returns false and returns iterator to the
+ * element on which traversal was stopped (or `last`). Algorithms below use it
+ * in order to amortize traversal overhead over the whole segment instead of
+ * paying it for each increment.
+ */
+template <typename It, typename = void>
+struct IsSegmentedIterator : std::false_type {};
+/**
+ * @overload
+ */
+template <typename It>
+struct IsSegmentedIterator<It, std::void_t<typename It::segmented_iterator_tag>>
+    : std::true_type {};
+
+template <typename It>
+inline constexpr bool kIsSegmentedIterator = IsSegmentedIterator<It>::value;
+
+/**
+ * @brief Applies the given function to each element in the range [first,
+ * last). Equivalent of `std::for_each`, which uses segmented traversal when it
+ * is available.
+ *
+ * @return Func the given function after it was applied to all elements.
+ */
+template <typename InputIt, typename Func>
+Func ForEach(InputIt first, InputIt last, Func func) {
+  if constexpr (kIsSegmentedIterator<InputIt>) {
+    InputIt::VisitRange(first, last, [&func](auto& value) {
+      func(value);
+      return true;
+    });
+    return func;
+  } else {
+    return std::for_each(first, last, std::move(func));
+  }
+}
+/**
+ * @brief Searches for the first element in the range [first, last) for which
+ * the predicate returns true. Equivalent of `std::find_if`, which uses
+ * segmented traversal when it is available.
+ *
+ * @return InputIt iterator to the found element or `last` if there is no such
+ * element.
+ */
+template <typename InputIt, typename UnaryPredicate>
+InputIt FindIf(InputIt first, InputIt last, UnaryPredicate pred) {
+  if constexpr (kIsSegmentedIterator<InputIt>) {
+    return InputIt::VisitRange(
+        first, last, [&pred](const auto& value) { return !pred(value); });
+  } else {
+    return std::find_if(first, last, pred);
+  }
+}
+/**
+ * @brief Searches for the first element in the range [first, last) which is
+ * equal to the given one. Equivalent of `std::find`, which uses segmented
+ * traversal when it is available.
+ *
+ * @return InputIt iterator to the found element or `last` if there is no such
+ * element.
+ */
+template <typename InputIt, typename T>
+InputIt Find(InputIt first, InputIt last, const T& value) {
+  return FindIf(first, last,
+                [&value](const auto& element) { return element == value; });
+}
+/**
+ * @brief Folds the range [first, last) with the given binary operation.
+ * Equivalent of `std::accumulate`, which uses segmented traversal when it is
+ * available.
+ *
+ * @return T result of the folding.
+ */
+template <typename InputIt, typename T, typename BinaryOperation>
+T Accumulate(InputIt first, InputIt last, T init, BinaryOperation op) {
+  if constexpr (kIsSegmentedIterator<InputIt>) {
+    InputIt::VisitRange(first, last, [&init, &op](const auto& value) {
+      init = op(std::move(init), value);
+      return true;
+    });
+    return init;
+  } else {
+    return std::accumulate(first, last, std::move(init), op);
+  }
+}
+/**
+ * @overload
+ *
+ * Elements are summed with `operator+`.
+ */
+template <typename InputIt, typename T>
+T Accumulate(InputIt first, InputIt last, T init) {
+  return Accumulate(
+      first, last, std::move(init),
+      [](T lhs, const auto& rhs) { return std::move(lhs) + rhs; });
+}
+/**
+ * @brief Assigns the given value to each element in the range [first, last).
+ * Equivalent of `std::fill`, which uses segmented traversal when it is
+ * available.
+ */
+template <typename ForwardIt, typename T>
+void Fill(ForwardIt first, ForwardIt last, const T& value) {
+  if constexpr (kIsSegmentedIterator<ForwardIt>) {
+    ForwardIt::VisitRange(first, last, [&value](auto& element) {
+      element = value;
+      return true;
+    });
+  } else {
+    std::fill(first, last, value);
+  }
+}
+/**
+ * @brief Copies elements from the range [first, last) to the range beginning
+ * at `d_first`. Equivalent of `std::copy`, which uses segmented traversal of
+ * the source range when it is available.
+ *
+ * @return OutputIt iterator past the last copied element in the destination
+ * range.
+ */
+template <typename InputIt, typename OutputIt>
+OutputIt Copy(InputIt first, InputIt last, OutputIt d_first) {
+  if constexpr (kIsSegmentedIterator<InputIt>) {
+    InputIt::VisitRange(first, last, [&d_first](const auto& value) {
+      *d_first = value;
+      ++d_first;
+      return true;
+    });
+    return d_first;
+  } else {
+    return std::copy(first, last, d_first);
+  }
+}
+
+}  // namespace alpa
+
+#endif  // ALGORITHM_PACK_SEGMENTED_ALGORITHM_H
@@ -0,0 +1,222 @@
+﻿#ifndef ALGORITHM_PACK_SLIDING_WINDOW_QUANTILES_H
+#define ALGORITHM_PACK_SLIDING_WINDOW_QUANTILES_H
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include "algorithm_pack/random.h"
+#include "algorithm_pack/treap_core.h"
+
+namespace alpa {
+/**
+ * @brief Order statistics of the last N samples of a stream.
+ *
+ * Samples of the window are kept in a treap ordered by value and augmented
+ * with subtree sizes, which is split and merged by TreapCore. Each sample has
+ * its own node, so equal samples are allowed. Therefore pushing a sample,
+ * evicting the oldest one and selecting a sample of the given rank all cost
+ * O(log n) and there is no need to re-walk the tree for each query. Nodes are
+ * stored in a ring buffer in the order of arrival, so the oldest sample is
+ * unlinked from the tree via its parent without a search and its node is
+ * reused for the new sample.
+ *
+ * Memory for the nodes is reserved once for the whole window, so the steady
+ * state does not allocate.
+ *
+ * @tparam T type of samples, has to determine `operator<()` and be copy
+ * assignable.
+ */
+template <typename T>
+class SlidingWindowQuantiles {
+ public:
+  /**
+   * @brief Creates an empty window.
+   *
+   * @param window_size maximal number of samples in the window, positive.
+   * @param seed will be set in the random generator for priorities.
+   */
+  SlidingWindowQuantiles(size_t window_size, uint64_t seed)
+      : window_size_(window_size), rnd_(seed) {
+    assert(window_size_ > 0);
+    // Window never holds more samples than its size, so nodes are not
+    // relocated
+    nodes_.reserve(window_size_);
+  }
+  SlidingWindowQuantiles(const SlidingWindowQuantiles&) = delete;
+  SlidingWindowQuantiles(SlidingWindowQuantiles&&) = delete;
+  SlidingWindowQuantiles& operator=(const SlidingWindowQuantiles&) = delete;
+  SlidingWindowQuantiles& operator=(SlidingWindowQuantiles&&) = delete;
+  ~SlidingWindowQuantiles() = default;
+  /**
+   * @brief Adds the sample to the window. If the window is full its oldest
+   * sample is evicted. Complexity O(log n).
+   */
+  void Push(const T& value) {
+    if (nodes_.size() < window_size_) {
+      Insert(&nodes_.emplace_back(value, rnd_()));
+      return;
+    }
+    Node* node = &nodes_[oldest_];
+    root_ = Core::Unlink(node);
+    node->value = value;
+    node->left = nullptr;
+    node->right = nullptr;
+    node->parent = nullptr;
+    node->tree_size = 1;
+    Insert(node);
+    oldest_ = (oldest_ + 1) % window_size_;
+  }
+  /**
+   * @brief Adds the samples to the window in the given order, as if Push()
+   * was called for each of them.
+   *
+   * If the batch is not shorter than the window, the old samples are dropped
+   * and the window is rebuilt from the sorted tail of the batch in
+   * O(n log n) instead of 2n updates.
+   */
+  template <typename ForwardIt>
+  void Advance(ForwardIt first, ForwardIt last) {
+    auto count = static_cast<size_t>(std::distance(first, last));
+    if (count < window_size_) {
+      for (; first != last; ++first) Push(*first);
+      return;
+    }
+    Clear();
+    std::advance(first, count - window_size_);
+    std::vector<Node*> sorted;
+    sorted.reserve(window_size_);
+    for (; first != last; ++first) {
+      sorted.push_back(&nodes_.emplace_back(*first, rnd_()));
+    }
+    std::sort(sorted.begin(), sorted.end(),
+              [](const Node* lhs, const Node* rhs) {
+                return lhs->value < rhs->value;
+              });
+    root_ = Core::BuildTree(sorted);
+  }
+  /**
+   * @brief Gets the sample of the given rank in the window, that is the
+   * sample which would be at the given index after sorting. Complexity
+   * O(log n).
+   *
+   * @param rank index in the sorted window, less than Size().
+   */
+  [[nodiscard]] const T& Select(size_t rank) const {
+    assert(rank < Size());
+    const Node* node = root_;
+    while (true) {
+      size_t left_size = Core::GetTreeSize(node->left);
+      if (rank < left_size) {
+        node = node->left;
+      } else if (rank == left_size) {
+        return node->value;
+      } else {
+        rank -= left_size + 1;
+        node = node->right;
+      }
+    }
+  }
+  /**
+   * @brief Gets the q-quantile of the window: the sample of rank
+   * floor(q * (n - 1)). For example 0.5 gives the median, which is the lower
+   * one for even n, and 0.99 gives p99. Complexity O(log n).
+   *
+   * @param q quantile in the range [0, 1]. Window should not be empty.
+   */
+  [[nodiscard]] const T& Quantile(double q) const {
+    assert(0.0 <= q && q <= 1.0);
+    assert(!Empty());
+    auto rank = static_cast<size_t>(
+        std::floor(q * static_cast<double>(Size() - 1)));
+    return Select(std::min(rank, Size() - 1));
+  }
+  /**
+   * @brief Counts samples in the window, which are less than the given value.
+   * Complexity O(log n).
+   */
+  [[nodiscard]] size_t CountLess(const T& value) const {
+    size_t result = 0;
+    for (const Node* node = root_; node;) {
+      if (node->value < value) {
+        result += Core::GetTreeSize(node->left) + 1;
+        node = node->right;
+      } else {
+        node = node->left;
+      }
+    }
+    return result;
+  }
+  /**
+   * @brief Removes all samples from the window.
+   */
+  void Clear() {
+    nodes_.clear();
+    root_ = nullptr;
+    oldest_ = 0;
+  }
+  [[nodiscard]] bool Empty() const { return nodes_.empty(); }
+  /**
+   * @brief Gets the number of samples in the window.
+   */
+  [[nodiscard]] size_t Size() const { return nodes_.size(); }
+  /**
+   * @brief Gets the maximal number of samples in the window.
+   */
+  [[nodiscard]] size_t WindowSize() const { return window_size_; }
+
+ private:
+  /**
+   * @brief Single sample of the window.
+   */
+  struct Node {
+    Node(const T& g_value, uint64_t g_priority)
+        : priority(g_priority), value(g_value) {}
+
+    Node* left = nullptr;
+    Node* right = nullptr;
+    Node* parent = nullptr;
+    /**Number of samples in this node subtree, including itself.*/
+    size_t tree_size = 1;
+    uint64_t priority;
+    T value;
+  };
+  /**
+   * @brief Adapts the sample node to the split and merge core.
+   */
+  struct CoreTraits {
+    static uint64_t GetPriority(const Node* node) { return node->priority; }
+    static void Update(Node* node) {
+      node->tree_size =
+          Core::GetTreeSize(node->left) + Core::GetTreeSize(node->right) + 1;
+    }
+  };
+  using Core = TreapCore<Node, CoreTraits>;
+
+  /**
+   * @brief Links the detached node into the tree after the equal samples.
+   * Complexity O(log n).
+   */
+  void Insert(Node* node) {
+    auto [not_greater, greater] =
+        Core::SplitBy(root_, [node](const Node* curr) {
+          return !(node->value < curr->value);
+        });
+    root_ = Core::Merge(Core::Merge(not_greater, node), greater);
+  }
+
+  size_t window_size_;
+  /**Ring buffer of the sample nodes in the order of arrival, its capacity is
+   * never exceeded.*/
+  std::vector<Node> nodes_;
+  /**Position of the oldest sample in the full ring buffer.*/
+  size_t oldest_ = 0;
+  Node* root_ = nullptr;
+  SplitMix64 rnd_;
+};
+}  // namespace alpa
+#endif  // ALGORITHM_PACK_SLIDING_WINDOW_QUANTILES_H
@@ -0,0 +1,236 @@
+﻿#ifndef ALGORITHM_PACK_SMALL_TREAP_H
+#define ALGORITHM_PACK_SMALL_TREAP_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "algorithm_pack/treap.h"
+
+namespace alpa {
+/**
+ * @brief Associative container, which keeps up to N elements in an inline
+ * sorted array and switches to Treap when it grows further.
+ *
+ * Suits programs which keep many maps and most of them hold a handful of
+ * elements. For them the inline array costs no allocations and no per-node
+ * overhead, and a linear scan of a few keys, which the compiler can
+ * vectorize for arithmetic keys, is faster than a pointer chase. When an
+ * element is inserted into the full array, all elements are copied into a
+ * Treap, which is used from then on. When erasure leaves at most N / 2
+ * elements in the treap, they are moved back to the array, so a map
+ * fluctuating around N does not switch on every operation. The move back is
+ * done only if keys are nothrow copy constructible and values are nothrow
+ * move constructible.
+ *
+ * Unlike Treap, the container gives no pointer stability: pointers returned
+ * by Insert() and Find() are invalidated by any modification. Both modes have
+ * the same interface, so the representation is not observable otherwise.
+ *
+ * @tparam K key type with `operator<()`.
+ * @tparam V value type.
+ * @tparam N number of elements stored inline, at least 1.
+ */
+template <typename K, typename V, size_t N = 16>
+class SmallTreap {
+ public:
+  static_assert(N > 0, "Inline capacity should be positive");
+  /**
+   * @brief Treap, which stores elements after the inline array overflows.
+   */
+  using Tree = Treap<K, V>;
+  /**
+   * @brief Creates an empty container in the inline mode.
+   */
+  SmallTreap() = default;
+  SmallTreap(const SmallTreap&) = delete;
+  SmallTreap(SmallTreap&&) = delete;
+  SmallTreap& operator=(const SmallTreap&) = delete;
+  SmallTreap& operator=(SmallTreap&&) = delete;
+  /**
+   * @brief Destroys all elements.
+   */
+  ~SmallTreap() { Clear(); }
+  /**
+   * @brief Inserts given (key, value) into the container. If the key is
+   * already present, its value is unchanged. Complexity O(N) in the inline
+   * mode and O(log n) in the tree mode. Switching to the tree mode costs
+   * O(N).
+   *
+   * @return V* pointer to the value with the given key, which is valid until
+   * the next modification. Cannot return nullptr.
+   */
+  V* Insert(const K& key, const V& value) {
+    if (tree_) return tree_->Insert(key, value);
+    size_t pos = LowerBound(key);
+    Item* items = Items();
+    if (pos < size_ && !(key < items[pos].first)) return &items[pos].second;
+    if (size_ == N) return Promote(key, value);
+    Item item(key, value);
+    if (pos == size_) {
+      ::new (static_cast<void*>(items + size_)) Item(std::move(item));
+    } else {
+      ::new (static_cast<void*>(items + size_))
+          Item(std::move(items[size_ - 1]));
+      std::move_backward(items + pos, items + size_ - 1, items + size_);
+      items[pos] = std::move(item);
+    }
+    ++size_;
+    return &items[pos].second;
+  }
+  /**
+   * @brief Removes the element with the given key. Complexity O(N) in the
+   * inline mode and O(log n) in the tree mode.
+   *
+   * @return true if the element was found and removed, false otherwise.
+   */
+  bool Erase(const K& key) {
+    if (tree_) {
+      if (!tree_->Erase(key)) return false;
+      if (tree_->Size() <= N / 2) Demote();
+      return true;
+    }
+    size_t pos = LowerBound(key);
+    Item* items = Items();
+    if (pos == size_ || key < items[pos].first) return false;
+    std::move(items + pos + 1, items + size_, items + pos);
+    items[--size_].~Item();
+    return true;
+  }
+  /**
+   * @brief Searches the given key. Complexity O(N) in the inline mode and
+   * O(log n) in the tree mode.
+   *
+   * @return V* pointer to the value with the given key, which is valid until
+   * the next modification, or nullptr if the key is not found.
+   */
+  V* Find(const K& key) {
+    if (tree_) return tree_->Find(key);
+    size_t pos = LowerBound(key);
+    Item* items = Items();
+    if (pos == size_ || key < items[pos].first) return nullptr;
+    return &items[pos].second;
+  }
+  /**
+   * @overload
+   */
+  const V* Find(const K& key) const {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+    return const_cast<SmallTreap*>(this)->Find(key);
+  }
+  /**
+   * @brief Calls the visitor for each element in ascending key order.
+   *
+   * @param visitor callable with signature `void(const K& key, V& value)`. It
+   * should not modify the container.
+   */
+  template <typename Visitor>
+  void ForEach(Visitor visitor) {
+    if (tree_) {
+      VisitTree(*tree_, visitor);
+      return;
+    }
+    Item* items = Items();
+    for (size_t i = 0; i < size_; ++i) {
+      visitor(std::as_const(items[i].first), items[i].second);
+    }
+  }
+  /**
+   * @brief Removes all elements and returns to the inline mode.
+   */
+  void Clear() noexcept {
+    tree_.reset();
+    Item* items = Items();
+    for (size_t i = 0; i < size_; ++i) items[i].~Item();
+    size_ = 0;
+  }
+  /**
+   * @brief Checks whether the container is empty or not.
+   */
+  [[nodiscard]] bool Empty() const { return Size() == 0; }
+  /**
+   * @brief Gets the number of elements in the container.
+   */
+  [[nodiscard]] size_t Size() const { return tree_ ? tree_->Size() : size_; }
+  /**
+   * @brief Checks whether elements are stored in the inline array.
+   */
+  [[nodiscard]] bool IsInline() const { return !tree_; }
+
+ private:
+  /**
+   * @brief Element of the inline array. Key is not constant, so elements can
+   * be shifted by assignment.
+   */
+  using Item = std::pair<K, V>;
+
+  Item* Items() {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    return std::launder(reinterpret_cast<Item*>(storage_.data()));
+  }
+  /**
+   * @brief Gets the number of inline keys less than the given one. Scan has
+   * no data dependent branches and does not stop early, which is cheaper than
+   * a binary search for a few keys.
+   */
+  size_t LowerBound(const K& key) {
+    const Item* items = Items();
+    size_t pos = 0;
+    for (size_t i = 0; i < size_; ++i) {
+      pos += static_cast<size_t>(items[i].first < key);
+    }
+    return pos;
+  }
+  /**
+   * @brief Copies the full inline array and the new element into a treap and
+   * switches to the tree mode. If a copy throws, the container is unchanged.
+   */
+  V* Promote(const K& key, const V& value) {
+    auto tree = std::make_unique<Tree>();
+    Item* items = Items();
+    tree->InsertSorted(items, items + size_);
+    V* result = tree->Insert(key, value);
+    Clear();
+    tree_ = std::move(tree);
+    return result;
+  }
+  /**
+   * @brief Moves elements of the treap back to the inline array and switches
+   * to the inline mode, if it cannot throw.
+   */
+  void Demote() noexcept {
+    if constexpr (std::is_nothrow_copy_constructible_v<K> &&
+                  std::is_nothrow_move_constructible_v<V>) {
+      std::unique_ptr<Tree> tree = std::move(tree_);
+      Item* items = Items();
+      VisitTree(*tree, [&](const K& key, V& value) {
+        ::new (static_cast<void*>(items + size_)) Item(key, std::move(value));
+        ++size_;
+      });
+    }
+  }
+  /**
+   * @brief Calls the visitor for each element of the treap in ascending key
+   * order.
+   */
+  template <typename Visitor>
+  static void VisitTree(Tree& tree, Visitor visitor) {
+    if (tree.Empty()) return;
+    auto& max = *tree.Max();
+    for (auto& [key, value] : tree.Range(tree.Min()->first, max.first)) {
+      visitor(key, value);
+    }
+    visitor(max.first, max.second);
+  }
+
+  /**Number of inline elements, which is zero in the tree mode.*/
+  size_t size_ = 0;
+  std::unique_ptr<Tree> tree_;
+  alignas(Item) std::array<std::byte, N * sizeof(Item)> storage_;
+};
+}  // namespace alpa
+#endif  // ALGORITHM_PACK_SMALL_TREAP_H
@@ -1,13 +1,69 @@
 ﻿#ifndef ALGORITHM_PACK_TREAP_H
 #define ALGORITHM_PACK_TREAP_H
 
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
-#include <random>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <type_traits>
 #include <utility>
+#include <vector>
+
+#include "algorithm_pack/node_arena.h"
+#include "algorithm_pack/random.h"
+#include "algorithm_pack/views.h"
 
 namespace alpa {
+/**
+ * @brief Hasher, which dispatches to `std::hash` of the argument type. Can be
+ * used as the hasher of the Treap, because it hashes both keys and values.
+ */
+struct StdHash {
+  template <typename X>
+  size_t operator()(const X& value) const {
+    return std::hash<X>{}(value);
+  }
+};
+/**
+ * @brief Priority policy of Treap: priority is calculated on demand by mixing
+ * bits of the key hash, so nodes do not store it and treaps with equal key
+ * sets have identical shapes. Unlike the hasher of the treap, it does not
+ * enable Merkle digests and hashes only keys.
+ *
+ * @tparam H hasher of keys, default constructible and stateless, for example
+ * `std::hash<K>`.
+ */
+template <typename H>
+struct KeyHashPriority {
+  using Hasher = H;
+};
+/**
+ * @brief Checks whether the type is KeyHashPriority.
+ */
+template <typename P>
+struct IsKeyHashPriority : std::false_type {};
+/**
+ * @overload
+ */
+template <typename H>
+struct IsKeyHashPriority<KeyHashPriority<H>> : std::true_type {};
+/**
+ * @brief Describes difference between two treaps found by Treap::Diff().
+ */
+enum class DiffKind {
+  /**The key is present only in the first (local) treap.*/
+  kOnlyInFirst,
+  /**The key is present only in the second (remote) treap.*/
+  kOnlyInSecond,
+  /**The key is present in both treaps, but with different values.*/
+  kValueDiffers
+};
+
 /**
  * @brief Realization of the treap (tree + heap) structure as template.
  *
@@ -17,10 +73,108 @@ namespace alpa {
  * priorities. If the priority of all keys are random the tree will be balanced.
  * The tree stores only unique user given keys. For the key type one has to
  * determine `operator<()`
+ *
+ * @tparam Hash optional hasher of keys and values, for example StdHash. If it
+ * is given, priorities are derived from key hashes instead of the random
+ * generator, so treaps with equal key sets have identical shapes, and each node
+ * maintains Merkle digest of its subtree. This allows to find differences
+ * between two treaps without visiting their equal parts. Note that digests are
+ * not updated when values are modified in place via returned pointers.
+ * @tparam Priority priority policy, RandomPriority or KeyHashPriority. Treap
+ * with hasher requires KeyHashPriority, which is the default for it.
  */
-template <typename K, typename V>
+template <typename K, typename V, typename Hash = void,
+          typename Priority = std::conditional_t<
+              std::is_void_v<Hash>, RandomPriority, KeyHashPriority<Hash>>>
 class Treap {
+  struct Node;
+
  public:
+  /**
+   * @brief Key range with exclusive bounds. Absent bound means no limit.
+   */
+  struct RangeQuery {
+    std::optional<K> lo;
+    std::optional<K> hi;
+  };
+  /**
+   * @brief Summary of the treap restricted to a key range, which is exchanged
+   * between replicas by DiffWithRemote().
+   */
+  struct RangeSummary {
+    /**Root key of the restricted treap, absent if the range is empty.*/
+    std::optional<K> key;
+    uint64_t priority = 0;
+    /**Hash of the root key and its value.*/
+    uint64_t element_hash = 0;
+    /**True if the restricted treap is a whole subtree, so the digest covers
+     * exactly the range.*/
+    bool exact = false;
+    uint64_t digest = 0;
+  };
+  /**
+   * @brief Forward iterator over elements of a key range in ascending key
+   * order.
+   *
+   * Iterator stores only the current node and the root, the next node is
+   * found by a descent from the root. Therefore traversal does not allocate
+   * memory and each step costs O(log n). Iterator is invalidated by any
+   * modification of the treap.
+   *
+   * @tparam Item type of the elements, `const` qualified for constant
+   * iterator.
+   */
+  template <typename Item>
+  class RangeIterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = std::remove_const_t<Item>;
+    using pointer = Item*;
+    using reference = Item&;
+
+    RangeIterator() = default;
+    friend bool operator==(const RangeIterator& lhs, const RangeIterator& rhs) {
+      return lhs.node_ == rhs.node_;
+    }
+    friend bool operator!=(const RangeIterator& lhs, const RangeIterator& rhs) {
+      return lhs.node_ != rhs.node_;
+    }
+    reference operator*() const { return node_->item; }
+    pointer operator->() const { return &node_->item; }
+    /**
+     * @brief Moves to the element with the next key. Complexity O(log n).
+     */
+    RangeIterator& operator++() {
+      assert(node_);
+      const K& key = node_->item.first;
+      NodePtr next = nullptr;
+      for (NodePtr curr_ptr = root_; curr_ptr;) {
+        bool to_right = !(key < curr_ptr->item.first);
+        next = to_right ? next : curr_ptr;
+        curr_ptr = curr_ptr->children[to_right];
+      }
+      node_ = next;
+      return *this;
+    }
+    RangeIterator operator++(int) {
+      RangeIterator old = *this;
+      ++*this;
+      return old;
+    }
+
+   private:
+    friend class Treap;
+    using NodePtr = std::conditional_t<std::is_const_v<Item>, const Node*,
+                                       Node*>;
+
+    RangeIterator(NodePtr root, NodePtr node) : root_(root), node_(node) {}
+
+    NodePtr root_ = nullptr;
+    NodePtr node_ = nullptr;
+  };
+  using Iterator = RangeIterator<std::pair<const K, V>>;
+  using ConstIterator = RangeIterator<const std::pair<const K, V>>;
   /**
    * @brief Constructs an empty tree with default seed.
    *
@@ -33,6 +187,16 @@ class Treap {
    * The seed is used in random generator for providing priorities.
    */
   explicit Treap(uint64_t seed) : rnd_(seed) {}
+  /**
+   * @brief Creates an empty treap, whose nodes are allocated from the pool of
+   * memory blocks of the given kind. For example NodeMemory::kHugePages
+   * reduces TLB misses of lookups in large treaps.
+   *
+   * @param seed will be set in the random generator.
+   * @param memory source of memory for the node pool.
+   */
+  Treap(uint64_t seed, NodeMemory memory)
+      : rnd_(seed), arena_(std::make_unique<NodeArena<Node>>(memory)) {}
   Treap(const Treap&) = delete;
   Treap(Treap&&) = delete;
   Treap& operator=(const Treap&) = delete;
@@ -46,7 +210,7 @@ class Treap {
    *
    * Random generator is used for creating priorities.
    */
-  void SetSeed(uint64_t seed) { rnd_.seed(seed); }
+  void SetSeed(uint64_t seed) { rnd_.Seed(seed); }
   /**
    * @brief Inserts given (key, value) into the tree.
    *
@@ -64,25 +228,29 @@ class Treap {
   V* Insert(const K& key, const V& value) {
     V* old_value = Find(key);
     if (old_value) return old_value;
-    uint64_t priority = rnd_();
+    Node* new_node = NewNode(key, value, NewPriority(key));
+    // Digests of the nodes above the new one are fixed after the insertion
+    std::vector<Node*> path;
     Node* parent = nullptr;
     Node* curr_ptr = root_;
     while (curr_ptr) {
-      if (curr_ptr->priority <= priority) break;
+      if (!IsAbove(curr_ptr, new_node)) break;
       parent = curr_ptr;
-      curr_ptr = key < curr_ptr->item.first ? curr_ptr->left : curr_ptr->right;
+      if constexpr (kHashed) path.push_back(parent);
+      curr_ptr = curr_ptr->children[curr_ptr->item.first < key];
     }
-    Node* new_node = new Node(key, value, priority);
     if (curr_ptr) {
       std::pair<Node*, Node*> splitted = Split(key, curr_ptr);
-      new_node->left = splitted.first;
-      new_node->right = splitted.second;
+      new_node->children[kLeft] = splitted.first;
+      new_node->children[kRight] = splitted.second;
     }
+    FixDigest(new_node);
     if (!parent) {
       root_ = new_node;
     } else {
       AddChildToParent(parent, new_node, /*to_left=*/key < parent->item.first);
     }
+    FixDigests(path);
     ++size_;
     return &new_node->item.second;
   }
@@ -98,32 +266,99 @@ class Treap {
    * deleted, false otherwise.
    */
   bool Erase(const K& key) {
+    std::vector<Node*> path;
     Node* parent = nullptr;
     Node* curr_ptr = root_;
     while (curr_ptr) {
       if (curr_ptr->item.first < key) {
         parent = curr_ptr;
-        curr_ptr = curr_ptr->right;
+        curr_ptr = curr_ptr->children[kRight];
       } else if (key < curr_ptr->item.first) {
         parent = curr_ptr;
-        curr_ptr = curr_ptr->left;
+        curr_ptr = curr_ptr->children[kLeft];
       } else {
         break;
       }
+      if constexpr (kHashed) path.push_back(parent);
     }
     if (!curr_ptr) return false;
-    Node* replacement = Merge(curr_ptr->left, curr_ptr->right);
+    Node* replacement =
+        Merge(curr_ptr->children[kLeft], curr_ptr->children[kRight]);
     if (!parent) {
       root_ = replacement;
     } else {
       AddChildToParent(parent, replacement,
                        /*to_left=*/key < parent->item.first);
     }
-    delete curr_ptr;
+    FixDigests(path);
+    DeleteNode(curr_ptr);
     --size_;
     if (size_ == 0) root_ = nullptr;
     return true;
   }
+  /**
+   * @brief Inserts a batch of elements sorted by key. Keys which are already
+   * in the treap keep their values, as in Insert().
+   *
+   * Batch is built into a treap in O(m) and united with the existing one in
+   * a single pass, which is O(m log(n / m + 1)) instead of O(m log n) for m
+   * separate insertions.
+   *
+   * @param first iterator to the first element of the batch. Elements are
+   * pairs of key and value with strictly ascending keys.
+   * @param last iterator past the last element of the batch.
+   */
+  template <typename InputIt>
+  void InsertSorted(InputIt first, InputIt last) {
+    size_t inserted = 0;
+    Node* batch = BuildSorted(first, last, inserted);
+    size_t duplicates = 0;
+    root_ = Unite(root_, batch, duplicates);
+    size_ += inserted - duplicates;
+  }
+  /**
+   * @brief Removes a batch of keys sorted in ascending order. Absent keys are
+   * ignored. Only subtrees whose key ranges contain keys of the batch are
+   * visited, so complexity is O(m log(n / m + 1)).
+   *
+   * @param first iterator to the first key of the batch.
+   * @param last iterator past the last key of the batch.
+   * @return size_t number of removed keys.
+   */
+  template <typename ForwardIt>
+  size_t EraseSorted(ForwardIt first, ForwardIt last) {
+    size_t erased = 0;
+    root_ = EraseKeys(root_, first, last, erased);
+    size_ -= erased;
+    return erased;
+  }
+  /**
+   * @brief Removes all elements with keys in the range [lo, hi). The range is
+   * cut out by two splits and the remaining parts are merged, so complexity
+   * is O(log n + k) for k removed elements.
+   *
+   * @param visitor callable with signature `void(const K& key, V& value)`,
+   * which is called for each removed element in ascending key order before
+   * the element is destroyed.
+   * @return size_t number of removed elements.
+   */
+  template <typename Visitor>
+  size_t EraseRange(const K& lo, const K& hi, Visitor visitor) {
+    if (!(lo < hi)) return 0;
+    auto [less, rest] = Split(lo, root_);
+    auto [range, greater] = Split(hi, rest);
+    root_ = Merge(less, greater);
+    size_t erased = 0;
+    VisitAndDeleteTree(range, visitor, erased);
+    size_ -= erased;
+    return erased;
+  }
+  /**
+   * @overload
+   */
+  size_t EraseRange(const K& lo, const K& hi) {
+    return EraseRange(lo, hi, [](const K&, V&) {});
+  }
   /**
    * @brief Searches the given key in the treap.
    *
@@ -133,17 +368,76 @@ class Treap {
    * If the key is not found nullptr will be returned.
    */
   V* Find(const K& key) {
+    // Descent does not stop on the equal key, instead it remembers the last
+    // node which is not less than the key. That node is the only candidate,
+    // so each level costs one comparison and no data dependent branches.
+    Node* candidate = nullptr;
     Node* curr_ptr = root_;
     while (curr_ptr) {
-      if (key < curr_ptr->item.first) {
-        curr_ptr = curr_ptr->left;
-      } else if (curr_ptr->item.first < key) {
-        curr_ptr = curr_ptr->right;
-      } else {
-        return &curr_ptr->item.second;
-      }
+      Prefetch(curr_ptr->children[kLeft]);
+      Prefetch(curr_ptr->children[kRight]);
+      bool to_right = curr_ptr->item.first < key;
+      candidate = to_right ? candidate : curr_ptr;
+      curr_ptr = curr_ptr->children[to_right];
+    }
+    if (!candidate || key < candidate->item.first) return nullptr;
+    return &candidate->item.second;
+  }
+  /**
+   * @overload
+   */
+  const V* Find(const K& key) const {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+    return const_cast<Treap*>(this)->Find(key);
+  }
+  /**
+   * @brief Gets the element with the smallest key. Complexity O(log n).
+   *
+   * @return std::pair<const K, V>* non owning pointer to the stored key and
+   * value. If the treap is empty nullptr will be returned.
+   */
+  std::pair<const K, V>* Min() {
+    Node* curr_ptr = root_;
+    if (!curr_ptr) return nullptr;
+    while (curr_ptr->children[kLeft]) {
+      curr_ptr = curr_ptr->children[kLeft];
+    }
+    return &curr_ptr->item;
+  }
+  /**
+   * @brief Gets the element with the largest key. Complexity O(log n).
+   *
+   * @return std::pair<const K, V>* non owning pointer to the stored key and
+   * value. If the treap is empty nullptr will be returned.
+   */
+  std::pair<const K, V>* Max() {
+    Node* curr_ptr = root_;
+    if (!curr_ptr) return nullptr;
+    while (curr_ptr->children[kRight]) {
+      curr_ptr = curr_ptr->children[kRight];
     }
-    return nullptr;
+    return &curr_ptr->item;
+  }
+  /**
+   * @brief Gets lazy view of the elements with keys in the range [lo, hi) in
+   * ascending key order. Elements are not copied, the view is invalidated by
+   * any modification of the treap. Complexity O(log n). The iterator keeps no
+   * stack and descends from the root on each step, so traversal of k elements
+   * costs O(k log n).
+   */
+  [[nodiscard]] IteratorRange<Iterator> Range(const K& lo, const K& hi) {
+    Node* last = LowerBound(root_, hi);
+    Node* first = lo < hi ? LowerBound(root_, lo) : last;
+    return {Iterator{root_, first}, Iterator{root_, last}};
+  }
+  /**
+   * @overload
+   */
+  [[nodiscard]] IteratorRange<ConstIterator> Range(const K& lo,
+                                                   const K& hi) const {
+    const Node* last = LowerBound<const Node*>(root_, hi);
+    const Node* first = lo < hi ? LowerBound<const Node*>(root_, lo) : last;
+    return {ConstIterator{root_, first}, ConstIterator{root_, last}};
   }
   /**
    * @brief Checks whether the treap is empty or not.
@@ -154,27 +448,346 @@ class Treap {
    * @brief Gets the number of elements in the treap.
    */
   [[nodiscard]] size_t Size() const { return size_; }
+  /**
+   * @brief Gets memory usage of the node pool. Treap without the pool reports
+   * nothing.
+   */
+  [[nodiscard]] ArenaStats MemoryStats() const {
+    return arena_ ? arena_->Stats() : ArenaStats{};
+  }
+  /**
+   * @brief Gets Merkle digest of the whole treap. Treaps with equal content
+   * have equal digests. Available only for treaps with hasher.
+   *
+   * @return uint64_t digest of the treap, 0 for the empty treap.
+   */
+  [[nodiscard]] uint64_t Digest() const {
+    static_assert(kHashed, "Digest requires treap with hasher");
+    return GetDigest(root_);
+  }
+  /**
+   * @brief Finds all differences between two treaps. Only subtrees with
+   * different digests are visited, so for d differences complexity is
+   * O(d log n). Available only for treaps with hasher.
+   *
+   * @param visitor callable with signature `void(const K& key, DiffKind
+   * kind)`, which is called for each different key in ascending key order.
+   */
+  template <typename Visitor>
+  static void Diff(const Treap& first, const Treap& second, Visitor visitor) {
+    static_assert(kHashed, "Diff requires treap with hasher");
+    DiffViews(View{first.root_}, View{second.root_}, visitor);
+  }
+  /**
+   * @brief Summarizes the treap restricted to the given key range. Complexity
+   * O(log n). Used to answer requests of the remote replica, which runs
+   * DiffWithRemote().
+   */
+  [[nodiscard]] RangeSummary Summarize(const RangeQuery& query) const {
+    static_assert(kHashed, "Summarize requires treap with hasher");
+    // Descent skips nodes out of the range, bounds of the found subtree are
+    // the keys where the descent turned
+    const K* subtree_lo = nullptr;
+    const K* subtree_hi = nullptr;
+    const Node* node = root_;
+    while (node) {
+      const K& key = node->item.first;
+      if (query.lo && !(*query.lo < key)) {
+        subtree_lo = &key;
+        node = node->children[kRight];
+      } else if (query.hi && !(key < *query.hi)) {
+        subtree_hi = &key;
+        node = node->children[kLeft];
+      } else {
+        break;
+      }
+    }
+    RangeSummary summary;
+    if (!node) return summary;
+    summary.key = node->item.first;
+    summary.priority = GetPriority(node);
+    summary.element_hash = node->element_hash;
+    summary.exact = (!query.lo || (subtree_lo && !(*subtree_lo < *query.lo))) &&
+                    (!query.hi || (subtree_hi && !(*query.hi < *subtree_hi)));
+    summary.digest = node->digest;
+    return summary;
+  }
+  /**
+   * @overload
+   *
+   * Answers a batch of requests at once.
+   */
+  [[nodiscard]] std::vector<RangeSummary> Summarize(
+      const std::vector<RangeQuery>& queries) const {
+    std::vector<RangeSummary> result;
+    result.reserve(queries.size());
+    for (const auto& query : queries) result.push_back(Summarize(query));
+    return result;
+  }
+  /**
+   * @brief Finds all differences between this treap and the remote replica,
+   * which is available only via range summaries. Available only for treaps
+   * with hasher, both replicas have to use the same hasher.
+   *
+   * Ranges are explored level by level: each round sends a batch of queries
+   * to the remote replica and receives their summaries, so the number of
+   * rounds is proportional to the treap height and the number of exchanged
+   * summaries is O(d log n) for d differences.
+   *
+   * @param remote callable with signature `std::vector<RangeSummary>(const
+   * std::vector<RangeQuery>&)`, which returns summaries of the remote replica
+   * for the given queries in the same order, for example by sending them to
+   * the remote process, which answers with Summarize().
+   * @param visitor callable with signature `void(const K& key, DiffKind
+   * kind)`, where the first treap is the local one. Keys are reported in
+   * unspecified order.
+   */
+  template <typename Remote, typename Visitor>
+  void DiffWithRemote(Remote remote, Visitor visitor) const {
+    static_assert(kHashed, "DiffWithRemote requires treap with hasher");
+    std::vector<RangeQuery> queries(1);
+    while (!queries.empty()) {
+      std::vector<RangeSummary> remote_summaries = remote(queries);
+      assert(remote_summaries.size() == queries.size());
+      std::vector<RangeQuery> next_queries;
+      for (size_t i = 0; i < queries.size(); ++i) {
+        const RangeQuery& query = queries[i];
+        RangeSummary local = Summarize(query);
+        const RangeSummary& other = remote_summaries[i];
+        if (!local.key && !other.key) continue;
+        if (local.exact && other.exact && local.digest == other.digest) {
+          continue;
+        }
+        const K* key = nullptr;
+        if (local.key && other.key && !(*local.key < *other.key) &&
+            !(*other.key < *local.key)) {
+          key = &*local.key;
+          if (local.element_hash != other.element_hash) {
+            visitor(*key, DiffKind::kValueDiffers);
+          }
+        } else if (local.key &&
+                   (!other.key || IsAbove(local.priority, *local.key,
+                                          other.priority, *other.key))) {
+          // The local root has the highest priority in the range, hence it
+          // would be the remote root too if the remote had it
+          key = &*local.key;
+          visitor(*key, DiffKind::kOnlyInFirst);
+        } else {
+          key = &*other.key;
+          visitor(*key, DiffKind::kOnlyInSecond);
+        }
+        next_queries.push_back(RangeQuery{query.lo, *key});
+        next_queries.push_back(RangeQuery{*key, query.hi});
+      }
+      queries = std::move(next_queries);
+    }
+  }
 
  private:
+  static constexpr bool kHashed = !std::is_void_v<Hash>;
+  static constexpr bool kStoredPriority =
+      std::is_same_v<Priority, RandomPriority>;
+  static_assert(kStoredPriority || IsKeyHashPriority<Priority>::value,
+                "Unknown priority policy");
+  static_assert(!kHashed || !kStoredPriority,
+                "Treap with hasher requires KeyHashPriority");
+  /**
+   * @brief Merkle data of the node subtree, which is stored only in treaps
+   * with hasher.
+   */
+  struct DigestData {
+    /**Hash of the node key and value.*/
+    uint64_t element_hash = 0;
+    /**Digest of the subtree, which depends on its shape and all elements.*/
+    uint64_t digest = 0;
+  };
+  struct NoDigestData {};
+  /**
+   * @brief Random priority of the node, which is stored only for
+   * RandomPriority policy.
+   */
+  struct PriorityData {
+    uint64_t priority = 0;
+  };
+  struct NoPriorityData {};
   /**
    * @brief Describes single node in the treap.
    */
-  struct Node {
+  struct Node
+      : std::conditional_t<kHashed, DigestData, NoDigestData>,
+        std::conditional_t<kStoredPriority, PriorityData, NoPriorityData> {
     /**
      * @brief Construct a new Node object with given parameters
      *
      * @param g_key node key
      * @param g_val node value
-     * @param g_priority node priority
+     * @param g_priority node priority, ignored for KeyHashPriority policy
      */
     Node(const K& g_key, const V& g_val, uint64_t g_priority)
-        : item(g_key, g_val), priority(g_priority) {}
+        : item(g_key, g_val) {
+      UpdateElementHash(this);
+      if constexpr (kHashed) this->digest = this->element_hash;
+      if constexpr (kStoredPriority) this->priority = g_priority;
+    }
 
     std::pair<const K, V> item;
-    uint64_t priority = 0;
-    Node* left = nullptr;
-    Node* right = nullptr;
+    /**Left and right children, indexed by kLeft and kRight.*/
+    std::array<Node*, 2> children{nullptr, nullptr};
+  };
+  static constexpr size_t kLeft = 0;
+  static constexpr size_t kRight = 1;
+  /**
+   * @brief Part of the treap used by Diff(): subtree of the node restricted to
+   * the range (lo, hi). Bound is nullptr if it does not restrict the subtree.
+   */
+  struct View {
+    const Node* node = nullptr;
+    const K* lo = nullptr;
+    const K* hi = nullptr;
   };
+  /**
+   * @brief Creates priority for the new node with the given key.
+   */
+  uint64_t NewPriority(const K& key) {
+    if constexpr (kStoredPriority) {
+      return rnd_();
+    } else {
+      return MixBits(typename Priority::Hasher{}(key));
+    }
+  }
+  /**
+   * @brief Gets priority of the node. For KeyHashPriority policy it is
+   * recalculated from the key.
+   */
+  static uint64_t GetPriority(const Node* node) {
+    if constexpr (kStoredPriority) {
+      return node->priority;
+    } else {
+      return MixBits(typename Priority::Hasher{}(node->item.first));
+    }
+  }
+  /**
+   * @brief Checks whether the first node has to be above the second one.
+   * Equal priorities are ordered by keys, so the shape of the treap is
+   * determined only by its content.
+   */
+  static bool IsAbove(const Node* lhs, const Node* rhs) {
+    return IsAbove(GetPriority(lhs), lhs->item.first, GetPriority(rhs),
+                   rhs->item.first);
+  }
+  /**
+   * @overload
+   */
+  static bool IsAbove(uint64_t lhs_priority, const K& lhs_key,
+                      uint64_t rhs_priority, const K& rhs_key) {
+    if (lhs_priority != rhs_priority) return lhs_priority > rhs_priority;
+    return lhs_key < rhs_key;
+  }
+  /**
+   * @brief Combines two hashes, the result depends on their order.
+   */
+  static uint64_t Combine(uint64_t lhs, uint64_t rhs) {
+    return MixBits(lhs ^
+                   (rhs + 0x9e3779b97f4a7c15U + (lhs << 6U) + (lhs >> 2U)));
+  }
+  /**
+   * @brief Recalculates hash of the node key and value. Does nothing in
+   * treaps without hasher.
+   */
+  static void UpdateElementHash([[maybe_unused]] Node* node) {
+    if constexpr (kHashed) {
+      node->element_hash = Combine(MixBits(Hash{}(node->item.first)),
+                                   Hash{}(node->item.second));
+    }
+  }
+  /**
+   * @brief Gets digest of the given subtree.
+   * @param node - root of the subtree. Can be nullptr.
+   */
+  static uint64_t GetDigest(const Node* node) {
+    return node ? node->digest : 0;
+  }
+  /**
+   * @brief Recalculates digest of the node from its children. Does nothing in
+   * treaps without hasher.
+   * @param node - node to be fixed. Can be nullptr.
+   */
+  static void FixDigest([[maybe_unused]] Node* node) {
+    if constexpr (kHashed) {
+      if (!node) return;
+      node->digest =
+          Combine(Combine(GetDigest(node->children[kLeft]), node->element_hash),
+                  GetDigest(node->children[kRight]));
+    }
+  }
+  /**
+   * @brief Recalculates digests of the nodes on the path from the root, from
+   * the deepest node to the root.
+   */
+  static void FixDigests(const std::vector<Node*>& path) {
+    for (auto it = path.rbegin(); it != path.rend(); ++it) FixDigest(*it);
+  }
+  /**
+   * @brief Descends from the view node to the root of the restricted treap,
+   * which is the highest node inside the range.
+   */
+  static void Normalize(View& view) {
+    while (view.node) {
+      const K& key = view.node->item.first;
+      if (view.lo && !(*view.lo < key)) {
+        view.node = view.node->children[kRight];
+      } else if (view.hi && !(key < *view.hi)) {
+        view.node = view.node->children[kLeft];
+      } else {
+        break;
+      }
+    }
+  }
+  /**
+   * @brief Reports differences of two restricted treaps, which cover the same
+   * key range, in ascending key order.
+   */
+  template <typename Visitor>
+  static void DiffViews(View first, View second, Visitor& visitor) {
+    Normalize(first);
+    Normalize(second);
+    if (!first.node && !second.node) return;
+    bool exact = !first.lo && !first.hi && !second.lo && !second.hi;
+    if (exact && GetDigest(first.node) == GetDigest(second.node)) return;
+    if (first.node && second.node &&
+        !(first.node->item.first < second.node->item.first) &&
+        !(second.node->item.first < first.node->item.first)) {
+      DiffViews(View{first.node->children[kLeft], first.lo},
+                View{second.node->children[kLeft], second.lo}, visitor);
+      if (first.node->element_hash != second.node->element_hash) {
+        visitor(first.node->item.first, DiffKind::kValueDiffers);
+      }
+      DiffViews(View{first.node->children[kRight], nullptr, first.hi},
+                View{second.node->children[kRight], nullptr, second.hi},
+                visitor);
+      return;
+    }
+    // The highest root is absent in the other treap, otherwise it would be
+    // the root there as well. The other treap is split virtually by its key.
+    bool first_on_top =
+        first.node && (!second.node || IsAbove(first.node, second.node));
+    const View& top = first_on_top ? first : second;
+    const View& other = first_on_top ? second : first;
+    const K* key = &top.node->item.first;
+    View top_left{top.node->children[kLeft], top.lo};
+    View top_right{top.node->children[kRight], nullptr, top.hi};
+    View other_left{other.node, other.lo, key};
+    View other_right{other.node, key, other.hi};
+    if (first_on_top) {
+      DiffViews(top_left, other_left, visitor);
+      visitor(*key, DiffKind::kOnlyInFirst);
+      DiffViews(top_right, other_right, visitor);
+    } else {
+      DiffViews(other_left, top_left, visitor);
+      visitor(*key, DiffKind::kOnlyInSecond);
+      DiffViews(other_right, top_right, visitor);
+    }
+  }
   /**
    * @brief Merges two treaps passed as their roots.
    *
@@ -192,17 +805,18 @@ class Treap {
     if (!lhs) return rhs;
     if (!rhs) return lhs;
     Node* root = nullptr;
-    if (lhs->priority > rhs->priority) {
+    if (IsAbove(lhs, rhs)) {
       // lhs root has to be on top
       root = lhs;
-      root->left = lhs->left;
-      root->right = Merge(lhs->right, rhs);
+      root->children[kLeft] = lhs->children[kLeft];
+      root->children[kRight] = Merge(lhs->children[kRight], rhs);
     } else {
       // rhs root has to be on top
       root = rhs;
-      root->left = Merge(lhs, rhs->left);
-      root->right = rhs->right;
+      root->children[kLeft] = Merge(lhs, rhs->children[kLeft]);
+      root->children[kRight] = rhs->children[kRight];
     }
+    FixDigest(root);
     return root;
   }
   /**
@@ -227,29 +841,200 @@ class Treap {
     if (root->item.first < key) {
       // root and its left child goes to the first tree
       result.first = root;
-      result.first->left = root->left;
-      auto splitted_right = Split(key, root->right);
-      result.first->right = splitted_right.first;
+      result.first->children[kLeft] = root->children[kLeft];
+      auto splitted_right = Split(key, root->children[kRight]);
+      result.first->children[kRight] = splitted_right.first;
       result.second = splitted_right.second;
     } else {
       // root and its right child goes to the second tree
       result.second = root;
-      result.second->right = root->right;
-      auto splitted_left = Split(key, root->left);
-      result.second->left = splitted_left.second;
+      result.second->children[kRight] = root->children[kRight];
+      auto splitted_left = Split(key, root->children[kLeft]);
+      result.second->children[kLeft] = splitted_left.second;
       result.first = splitted_left.first;
     }
+    FixDigest(result.first);
+    FixDigest(result.second);
     return result;
   }
+  /**
+   * @brief Builds treap from the elements sorted by key. Complexity O(m).
+   *
+   * Nodes are appended to the right spine of the treap. The new node takes
+   * the nodes with lower priorities from the spine as its left subtree.
+   *
+   * @param count is increased by the number of built nodes.
+   * @return root of the built treap. Can be nullptr for the empty range.
+   */
+  template <typename InputIt>
+  Node* BuildSorted(InputIt first, InputIt last, size_t& count) {
+    std::vector<Node*> spine;
+    for (; first != last; ++first) {
+      const auto& [key, value] = *first;
+      assert(spine.empty() || spine.back()->item.first < key);
+      Node* node = NewNode(key, value, NewPriority(key));
+      Node* left = nullptr;
+      while (!spine.empty() && IsAbove(node, spine.back())) {
+        // Subtree of the popped node is complete
+        left = spine.back();
+        spine.pop_back();
+        FixDigest(left);
+      }
+      node->children[kLeft] = left;
+      if (!spine.empty()) spine.back()->children[kRight] = node;
+      spine.push_back(node);
+      ++count;
+    }
+    FixDigests(spine);
+    return spine.empty() ? nullptr : spine.front();
+  }
+  /**
+   * @brief Unites two treaps with arbitrary key ranges. If both treaps contain
+   * the same key the node of the batch is deleted and the node of the tree is
+   * kept, so pointers to its value stay valid. Complexity O(m log(n / m + 1)),
+   * where m is the smaller size.
+   *
+   * @param tree root of the treap, whose values win. Can be nullptr.
+   * @param batch root of the other treap. Can be nullptr.
+   * @param duplicates is increased by the number of deleted batch nodes.
+   * @return root of the united treap.
+   */
+  Node* Unite(Node* tree, Node* batch, size_t& duplicates) {
+    if (!tree) return batch;
+    if (!batch) return tree;
+    if (IsAbove(tree, batch)) {
+      auto [less, rest] = Split(tree->item.first, batch);
+      Node* same = DetachEqualMin(tree->item.first, rest);
+      if (same) {
+        DeleteNode(same);
+        ++duplicates;
+      }
+      tree->children[kLeft] = Unite(tree->children[kLeft], less, duplicates);
+      tree->children[kRight] = Unite(tree->children[kRight], rest, duplicates);
+      FixDigest(tree);
+      return tree;
+    }
+    auto [less, rest] = Split(batch->item.first, tree);
+    Node* same = DetachEqualMin(batch->item.first, rest);
+    if (same) {
+      // Node of the tree is lower than the batch one. It takes the place of
+      // the batch node, so pointers to its value stay valid
+      same->children = batch->children;
+      if constexpr (kStoredPriority) same->priority = batch->priority;
+      DeleteNode(std::exchange(batch, same));
+      ++duplicates;
+    }
+    batch->children[kLeft] = Unite(less, batch->children[kLeft], duplicates);
+    batch->children[kRight] = Unite(rest, batch->children[kRight], duplicates);
+    FixDigest(batch);
+    return batch;
+  }
+  /**
+   * @brief Unlinks the node with the smallest key if it is equal to the given
+   * key. Complexity O(log n).
+   *
+   * @param root root of the treap, whose keys are not less than the given key.
+   * Is updated if the root is unlinked.
+   * @return unlinked node or nullptr if the smallest key differs.
+   */
+  static Node* DetachEqualMin(const K& key, Node*& root) {
+    std::vector<Node*> path;
+    Node** link = &root;
+    while (*link && (*link)->children[kLeft]) {
+      path.push_back(*link);
+      link = &(*link)->children[kLeft];
+    }
+    Node* min = *link;
+    if (!min || key < min->item.first) return nullptr;
+    *link = min->children[kRight];
+    min->children[kRight] = nullptr;
+    FixDigests(path);
+    return min;
+  }
+  /**
+   * @brief Removes the keys of the sorted range from the treap.
+   *
+   * @param erased is increased by the number of removed nodes.
+   * @return root of the resulting treap.
+   */
+  template <typename ForwardIt>
+  Node* EraseKeys(Node* root, ForwardIt first, ForwardIt last,
+                  size_t& erased) {
+    if (!root || first == last) return root;
+    ForwardIt mid = std::lower_bound(first, last, root->item.first);
+    bool found = mid != last && !(root->item.first < *mid);
+    root->children[kLeft] = EraseKeys(root->children[kLeft], first, mid,
+                                      erased);
+    root->children[kRight] = EraseKeys(root->children[kRight],
+                                       found ? std::next(mid) : mid, last,
+                                       erased);
+    if (!found) {
+      FixDigest(root);
+      return root;
+    }
+    Node* replacement = Merge(root->children[kLeft], root->children[kRight]);
+    DeleteNode(root);
+    ++erased;
+    return replacement;
+  }
   /**
    * @brief Deletes all nodes in the treap with the given root. Complexity O(n).
    * @param root root of treap to be deleted. Can be nullptr.
    */
-  static void DeleteTree(Node* root) {
+  void DeleteTree(Node* root) {
+    if (!root) return;
+    DeleteTree(root->children[kLeft]);
+    DeleteTree(root->children[kRight]);
+    DeleteNode(root);
+  }
+  /**
+   * @brief Deletes all nodes of the treap with the given root in key order,
+   * calling the visitor for each of them. Complexity O(n).
+   * @param count is increased by the number of deleted nodes.
+   */
+  template <typename Visitor>
+  void VisitAndDeleteTree(Node* root, Visitor& visitor, size_t& count) {
     if (!root) return;
-    DeleteTree(root->left);
-    DeleteTree(root->right);
-    delete root;
+    VisitAndDeleteTree(root->children[kLeft], visitor, count);
+    Node* right = root->children[kRight];
+    visitor(root->item.first, root->item.second);
+    DeleteNode(root);
+    ++count;
+    VisitAndDeleteTree(right, visitor, count);
+  }
+  /**
+   * @brief Creates node in the node pool if the treap has it, otherwise on
+   * the heap.
+   */
+  Node* NewNode(const K& key, const V& value, uint64_t priority) {
+    if (arena_) return arena_->New(key, value, priority);
+    return new Node(key, value, priority);
+  }
+  /**
+   * @brief Destroys node created by NewNode().
+   */
+  void DeleteNode(Node* node) {
+    if (arena_) {
+      arena_->Delete(node);
+    } else {
+      delete node;
+    }
+  }
+  /**
+   * @brief Finds the node with the smallest key, which is not less than the
+   * given one.
+   *
+   * @return NodePtr found node or nullptr if all keys are less.
+   */
+  template <typename NodePtr>
+  static NodePtr LowerBound(NodePtr root, const K& key) {
+    NodePtr candidate = nullptr;
+    while (root) {
+      bool to_right = root->item.first < key;
+      candidate = to_right ? candidate : root;
+      root = root->children[to_right];
+    }
+    return candidate;
   }
   /**
    * @brief Adds child to the given parent. Parent pointer should not be
@@ -262,16 +1047,24 @@ class Treap {
    */
   static void AddChildToParent(Node* parent, Node* child, bool to_left) {
     assert(parent);
-    if (to_left) {
-      parent->left = child;
-    } else {
-      parent->right = child;
-    }
+    parent->children[to_left ? kLeft : kRight] = child;
+  }
+  /**
+   * @brief Hints the processor to load the node into the cache. Does nothing
+   * for compilers without the prefetch builtin.
+   * @param node node to be loaded. Can be nullptr.
+   */
+  static void Prefetch([[maybe_unused]] const Node* node) {
+#if defined(__GNUC__)
+    __builtin_prefetch(node);
+#endif
   }
 
   Node* root_ = nullptr;
-  std::mt19937_64 rnd_{std::random_device{}()};
+  SplitMix64 rnd_;
   size_t size_ = 0;
+  /**Pool of nodes, absent if nodes are allocated one by one.*/
+  std::unique_ptr<NodeArena<Node>> arena_;
 };
 }  // namespace alpa
 #endif  // ALGORITHM_PACK_TREAP_H
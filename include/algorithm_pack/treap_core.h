@@ -0,0 +1,251 @@
+﻿#ifndef ALGORITHM_PACK_TREAP_CORE_H
+#define ALGORITHM_PACK_TREAP_CORE_H
+
+#include <cassert>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace alpa {
+/**
+ * @brief Split and merge core of the treaps, whose nodes keep parent pointers
+ * and subtree sizes. It is shared by ImplicitTreap, EulerTourForest and
+ * SlidingWindowQuantiles, so the containers differ only in the data they keep
+ * in nodes.
+ *
+ * @tparam Node type of the nodes, has to provide `left`, `right` and `parent`
+ * pointers and `tree_size` field with the number of nodes in its subtree.
+ * @tparam Traits provides `static uint64_t GetPriority(const Node*)` and
+ * `static void Update(Node*)`, which recalculates `tree_size` and other
+ * subtree data of the node from its children.
+ */
+template <typename Node, typename Traits>
+struct TreapCore {
+  /**
+   * @brief Calculates the number of nodes in the given subtree.
+   * @param node - root of the subtree. Can be nullptr.
+   */
+  static size_t GetTreeSize(const Node* node) {
+    return node ? node->tree_size : 0;
+  }
+  /**
+   * @brief Sets parent field of the given node childrens
+   *
+   * @param node - node which is needed to be fixed. Cannot be nullptr.
+   */
+  static void FixParent(Node* node) {
+    if (node->left) node->left->parent = node;
+    if (node->right) node->right->parent = node;
+  }
+  /**
+   * @brief Merges two trees passed via their roots.
+   *
+   * Merge will be performed in the manner, that all elements which was in the
+   * left tree will precede all elements in the right tree in case of container
+   * traversal.  No elements are copied. Method only rearranges pointers.
+   * Complexity O(log n)
+   *
+   * @param lhs - root of the left treap
+   * @param rhs - root of the right treap
+   * @return Node* root of the merged treap. Its parent is not changed. Can
+   * return nullptr, if both input treaps are empty.
+   */
+  static Node* Merge(Node* lhs, Node* rhs) {
+    if (!lhs) return rhs;
+    if (!rhs) return lhs;
+    Node* root = nullptr;
+    if (Traits::GetPriority(lhs) > Traits::GetPriority(rhs)) {
+      // lhs root should be on top
+      root = lhs;
+      root->right = Merge(lhs->right, rhs);
+    } else {
+      // rhs root should be on top
+      root = rhs;
+      root->left = Merge(lhs, rhs->left);
+    }
+    FixParent(root);
+    Traits::Update(root);
+    return root;
+  }
+  /**
+   * @brief Splits current tree in two according to the given element number.
+   *
+   * All elements, which number is smaller than given one will be in the
+   * first tree and all other elements - in the second.  Complexity O(log n).
+   *
+   * @param el_number - element number according to which treap is being
+   * splitted. Note that element number, unlike element index, starts from 1.
+   * @param node - root of the treap, which is being splitted.
+   * @return Roots of two treaps in which the original one was splitted. This
+   * is, parent of each root node is nullptr. The resulting pair can contain
+   * nullptr.
+   */
+  static std::pair<Node*, Node*> Split(size_t el_number, Node* node) {
+    std::pair<Node*, Node*> result{nullptr, nullptr};
+    if (!node) return result;
+    size_t elements_until_this = GetTreeSize(node->left) + 1;
+    if (elements_until_this < el_number) {
+      // node and its left child should be stored in the first field
+      result.first = node;
+      auto [smaller, other] =
+          Split(el_number - elements_until_this, node->right);
+      result.first->right = smaller;
+      result.second = other;
+    } else {
+      // node and its right child should be stored in the right field
+      result.second = node;
+      auto [smaller, other] = Split(el_number, node->left);
+      result.second->left = other;
+      result.first = smaller;
+    }
+    FixRoots(result);
+    return result;
+  }
+  /**
+   * @brief Splits the tree into the nodes, for which the predicate is true,
+   * and the others. The predicate has to be true for a prefix of the tree in
+   * the traversing order, for example for keys less than the given one.
+   * Complexity O(log n).
+   *
+   * @return Roots of the two trees with parent set to nullptr. The resulting
+   * pair can contain nullptr.
+   */
+  template <typename Predicate>
+  static std::pair<Node*, Node*> SplitBy(Node* node, const Predicate& pred) {
+    std::pair<Node*, Node*> result{nullptr, nullptr};
+    if (!node) return result;
+    if (pred(node)) {
+      result.first = node;
+      auto [smaller, other] = SplitBy(node->right, pred);
+      result.first->right = smaller;
+      result.second = other;
+    } else {
+      result.second = node;
+      auto [smaller, other] = SplitBy(node->left, pred);
+      result.second->left = other;
+      result.first = smaller;
+    }
+    FixRoots(result);
+    return result;
+  }
+  /**
+   * @brief Removes the node from its tree, the tree is relinked by merging
+   * the node children. Complexity O(log n), no search is performed.
+   *
+   * @param node node to be removed. Its links are not changed.
+   * @return Node* root of the remaining tree. Can be nullptr.
+   */
+  static Node* Unlink(Node* node) {
+    Node* parent = node->parent;
+    Node* replacement = Merge(node->left, node->right);
+    if (replacement) replacement->parent = parent;
+    if (!parent) return replacement;
+    if (parent->left == node) {
+      parent->left = replacement;
+    } else {
+      parent->right = replacement;
+    }
+    Node* root = parent;
+    for (; parent; parent = parent->parent) {
+      Traits::Update(parent);
+      root = parent;
+    }
+    return root;
+  }
+  /**
+   * @brief Builds the tree from the nodes in the given order. Complexity
+   * O(n).
+   *
+   * Nodes are appended to the right spine of the treap. The new node takes
+   * the nodes with lower priorities from the spine as its left subtree.
+   *
+   * @param nodes nodes without children.
+   * @return Node* root of the built treap. Can be nullptr for empty input.
+   */
+  static Node* BuildTree(const std::vector<Node*>& nodes) {
+    std::vector<Node*> spine;
+    for (Node* node : nodes) {
+      Node* left = nullptr;
+      while (!spine.empty() &&
+             Traits::GetPriority(spine.back()) < Traits::GetPriority(node)) {
+        // Subtree of the popped node is complete
+        left = spine.back();
+        spine.pop_back();
+        Traits::Update(left);
+      }
+      node->left = left;
+      if (left) left->parent = node;
+      node->parent = spine.empty() ? nullptr : spine.back();
+      if (node->parent) node->parent->right = node;
+      spine.push_back(node);
+    }
+    for (auto it = spine.rbegin(); it != spine.rend(); ++it) {
+      Traits::Update(*it);
+    }
+    return spine.empty() ? nullptr : spine.front();
+  }
+  /**
+   * @brief Calculates the element number which corresponds to the given node.
+   * Complexity O(log n).
+   *
+   * @param node element node of the interest. Cannot be nullptr.
+   * @return size_t element number which corresponds to the given node. Note
+   * that unlike the index element number numeration start from 1.
+   */
+  static size_t GetElementNumber(const Node* node) {
+    assert(node);
+    size_t curr_num = GetTreeSize(node->left) + 1;
+    const Node* parent = node->parent;
+    while (parent) {
+      if (parent->right == node) {
+        curr_num += GetTreeSize(parent->left) + 1;
+      }
+      node = parent;
+      parent = parent->parent;
+    }
+    return curr_num;
+  }
+  /**
+   * @brief Gets the root of the treap which holds the given node.
+   * Complexity O(log n).
+   */
+  static const Node* FindRoot(const Node* node) {
+    assert(node);
+    while (node->parent) {
+      node = node->parent;
+    }
+    return node;
+  }
+  /**
+   * @overload
+   */
+  static Node* FindRoot(Node* node) {
+    assert(node);
+    while (node->parent) {
+      node = node->parent;
+    }
+    return node;
+  }
+
+ private:
+  /**
+   * @brief Fixes the roots of two trees produced by a split: sets parents of
+   * their children, recalculates their data and detaches them from the parent.
+   */
+  static void FixRoots(const std::pair<Node*, Node*>& roots) {
+    FixRoot(roots.first);
+    FixRoot(roots.second);
+  }
+  /**
+   * @brief Fixes the root of a single tree, see FixRoots().
+   * @param root - root of the tree. Can be nullptr.
+   */
+  static void FixRoot(Node* root) {
+    if (!root) return;
+    FixParent(root);
+    Traits::Update(root);
+    root->parent = nullptr;
+  }
+};
+}  // namespace alpa
+#endif  // ALGORITHM_PACK_TREAP_CORE_H
@@ -0,0 +1,201 @@
+﻿#ifndef ALGORITHM_PACK_TTL_CACHE_H
+#define ALGORITHM_PACK_TTL_CACHE_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+#include "algorithm_pack/treap.h"
+
+namespace alpa {
+/**
+ * @brief Counters of the cache activity.
+ */
+struct CacheStats {
+  size_t hits = 0;
+  size_t misses = 0;
+  /**Number of entries removed because their time to live ran out.*/
+  size_t expirations = 0;
+  /**Number of entries removed to fit the capacity.*/
+  size_t evictions = 0;
+};
+
+/**
+ * @brief In-process cache with per-entry time to live and LRU eviction.
+ *
+ * Entries are found by the hash index. Expiry order is kept in a Treap keyed
+ * by (expiry time, entry id), so all entries which expired by the given time
+ * form a prefix of the treap and are removed by a single
+ * Treap::EraseRange() in O(log n + k). Recency order is kept in a list, which
+ * is updated in O(1) on each access. When the charged size exceeds the
+ * capacity, expired entries are swept first and then the least recently used
+ * entries are evicted.
+ *
+ * Time is given by the caller in arbitrary units, for example milliseconds of
+ * a monotonic clock. Entry with expiry time t is alive while time is less than
+ * t.
+ *
+ * @tparam K type of keys, has to be hashable by HashFn and comparable by
+ * `operator==()`.
+ * @tparam V type of values.
+ * @tparam HashFn hasher of keys.
+ */
+template <typename K, typename V, typename HashFn = std::hash<K>>
+class TtlCache {
+ public:
+  /**
+   * @brief Creates an empty cache.
+   *
+   * @param capacity maximal total charge of the entries. With the default
+   * charge of Put() it is the number of entries, with charges in bytes it is
+   * the memory budget.
+   * @param seed will be set in the random generator of the expiry treap.
+   */
+  TtlCache(size_t capacity, uint64_t seed)
+      : capacity_(capacity), expiry_(seed) {}
+  TtlCache(const TtlCache&) = delete;
+  TtlCache(TtlCache&&) = delete;
+  TtlCache& operator=(const TtlCache&) = delete;
+  TtlCache& operator=(TtlCache&&) = delete;
+  ~TtlCache() = default;
+  /**
+   * @brief Inserts or replaces the entry. Amortized complexity O(log n).
+   *
+   * @param now current time.
+   * @param ttl time to live of the entry, saturated at the largest time.
+   * Entry with zero time to live is dead at once, so it is not stored.
+   * @param charge size of the entry in units of the capacity. Entry larger
+   * than the capacity is not stored.
+   * @return true if the entry is stored, false otherwise. The previous entry
+   * of the key is removed in both cases.
+   */
+  bool Put(const K& key, const V& value, uint64_t now, uint64_t ttl,
+           size_t charge = 1) {
+    Erase(key);
+    if (ttl == 0 || charge > capacity_) return false;
+    uint64_t expiry = ttl > kMaxTime - now ? kMaxTime : now + ttl;
+    ExpiryKey expiry_key{expiry, next_id_++};
+    recency_.push_front(key);
+    index_.emplace(key, Entry{value, expiry_key, recency_.begin(), charge});
+    expiry_.Insert(expiry_key, key);
+    charge_ += charge;
+    if (charge_ > capacity_) {
+      Expire(now);
+      while (charge_ > capacity_) {
+        EraseEntry(index_.find(recency_.back()));
+        ++stats_.evictions;
+      }
+    }
+    return true;
+  }
+  /**
+   * @brief Gets value of the alive entry and marks it as the most recently
+   * used. Expired entry is removed. Complexity O(1) for the alive entry and
+   * O(log n) otherwise.
+   *
+   * @return V* non owning pointer to the value, which is valid until the next
+   * modification of the cache. If the entry is absent or expired nullptr
+   * will be returned.
+   */
+  V* Get(const K& key, uint64_t now) {
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+      ++stats_.misses;
+      return nullptr;
+    }
+    if (it->second.expiry_key.first <= now) {
+      EraseEntry(it);
+      ++stats_.expirations;
+      ++stats_.misses;
+      return nullptr;
+    }
+    recency_.splice(recency_.begin(), recency_, it->second.recency);
+    ++stats_.hits;
+    return &it->second.value;
+  }
+  /**
+   * @brief Removes the entry. Complexity O(log n).
+   *
+   * @return true if the entry was in the cache, false otherwise.
+   */
+  bool Erase(const K& key) {
+    auto it = index_.find(key);
+    if (it == index_.end()) return false;
+    EraseEntry(it);
+    return true;
+  }
+  /**
+   * @brief Removes all entries which expired by the given time in one sweep.
+   * Complexity O(log n + k) for k expired entries, plus their removal from
+   * the index and the recency list.
+   *
+   * @return size_t number of removed entries.
+   */
+  size_t Expire(uint64_t now) {
+    // Ids are less than the largest one, so expiry time `now` is included
+    size_t expired = expiry_.EraseRange(
+        ExpiryKey{0, 0}, ExpiryKey{now, kMaxTime},
+        [this](const ExpiryKey&, const K& key) {
+          auto it = index_.find(key);
+          charge_ -= it->second.charge;
+          recency_.erase(it->second.recency);
+          index_.erase(it);
+        });
+    stats_.expirations += expired;
+    return expired;
+  }
+  /**
+   * @brief Gets the number of entries. Expired entries are counted until they
+   * are swept.
+   */
+  [[nodiscard]] size_t Size() const { return index_.size(); }
+  [[nodiscard]] bool Empty() const { return index_.empty(); }
+  /**
+   * @brief Gets the total charge of the entries.
+   */
+  [[nodiscard]] size_t Charge() const { return charge_; }
+  [[nodiscard]] size_t Capacity() const { return capacity_; }
+  /**
+   * @brief Gets the counters of the cache activity.
+   */
+  [[nodiscard]] const CacheStats& Stats() const { return stats_; }
+
+ private:
+  static constexpr uint64_t kMaxTime = std::numeric_limits<uint64_t>::max();
+  /**Expiry time and unique id of the entry.*/
+  using ExpiryKey = std::pair<uint64_t, uint64_t>;
+  struct Entry {
+    V value;
+    ExpiryKey expiry_key;
+    typename std::list<K>::iterator recency;
+    size_t charge;
+  };
+  using Index = std::unordered_map<K, Entry, HashFn>;
+
+  /**
+   * @brief Removes the entry from all structures. Complexity O(log n).
+   */
+  void EraseEntry(typename Index::iterator it) {
+    assert(it != index_.end());
+    expiry_.Erase(it->second.expiry_key);
+    charge_ -= it->second.charge;
+    recency_.erase(it->second.recency);
+    index_.erase(it);
+  }
+
+  size_t capacity_;
+  size_t charge_ = 0;
+  uint64_t next_id_ = 0;
+  Index index_;
+  /**Keys from the most recently used to the least recently used.*/
+  std::list<K> recency_;
+  Treap<ExpiryKey, K> expiry_;
+  CacheStats stats_;
+};
+}  // namespace alpa
+#endif  // ALGORITHM_PACK_TTL_CACHE_H
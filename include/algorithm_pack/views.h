@@ -0,0 +1,172 @@
+﻿#ifndef ALGORITHM_PACK_VIEWS_H
+#define ALGORITHM_PACK_VIEWS_H
+
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+
+#if defined(__cpp_lib_ranges)
+#include <ranges>
+#endif
+
+namespace alpa {
+/**
+ * @brief Base of the views, which marks them as `std::ranges::view` when the
+ * standard library provides ranges.
+ */
+#if defined(__cpp_lib_ranges)
+using ViewBase = std::ranges::view_base;
+#else
+struct ViewBase {};
+#endif
+
+/**
+ * @brief Lazy view of the range [first, last), which only stores the two
+ * iterators.
+ *
+ * Elements are produced by the iterators on demand, so a view over a container
+ * part can be passed down a pipeline without copying the part into a buffer.
+ * Methods `begin()` and `end()` are lowercase, so the view can be traversed by
+ * the range-based for loop and used with the standard algorithms. In C++20 it
+ * models `std::ranges::view`. The view is invalidated together with its
+ * iterators.
+ *
+ * @tparam It type of the iterators, at least forward iterator.
+ */
+template <typename It>
+class IteratorRange : public ViewBase {
+ public:
+  using iterator = It;
+  using const_iterator = It;
+  using value_type = typename std::iterator_traits<It>::value_type;
+
+  IteratorRange() = default;
+  /**
+   * @brief Creates view of the range [first, last).
+   */
+  IteratorRange(It first, It last)
+      : first_(std::move(first)), last_(std::move(last)) {}
+  [[nodiscard]] It begin() const { return first_; }
+  [[nodiscard]] It end() const { return last_; }
+  /**
+   * @brief Checks whether the range is empty. Complexity constant.
+   */
+  [[nodiscard]] bool Empty() const { return first_ == last_; }
+  /**
+   * @brief Counts elements of the range. Complexity is the one of
+   * `std::distance()`.
+   */
+  [[nodiscard]] size_t Size() const {
+    return static_cast<size_t>(std::distance(first_, last_));
+  }
+
+ private:
+  It first_;
+  It last_;
+};
+
+/**
+ * @brief Lazy view, which splits the underlying range into consecutive chunks
+ * of the fixed size. The last chunk can be shorter.
+ *
+ * Each chunk is IteratorRange of the underlying iterators, so batches are
+ * formed without copying elements. Moving to the next chunk steps the
+ * underlying iterator over the chunk once.
+ *
+ * @tparam Range type of the underlying view, for example IteratorRange.
+ */
+template <typename Range>
+class ChunkView : public ViewBase {
+ public:
+  using UnderlyingIterator = typename Range::iterator;
+  using Chunk = IteratorRange<UnderlyingIterator>;
+  /**
+   * @brief Forward iterator over chunks.
+   */
+  class Iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = Chunk;
+    using pointer = const Chunk*;
+    using reference = const Chunk&;
+
+    Iterator() = default;
+    friend bool operator==(const Iterator& lhs, const Iterator& rhs) {
+      return lhs.chunk_.begin() == rhs.chunk_.begin();
+    }
+    friend bool operator!=(const Iterator& lhs, const Iterator& rhs) {
+      return !(lhs == rhs);
+    }
+    reference operator*() const { return chunk_; }
+    pointer operator->() const { return &chunk_; }
+    Iterator& operator++() {
+      chunk_ = MakeChunk(chunk_.end(), last_, chunk_size_);
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator old = *this;
+      ++*this;
+      return old;
+    }
+
+   private:
+    friend class ChunkView;
+
+    Iterator(UnderlyingIterator first, UnderlyingIterator last,
+             size_t chunk_size)
+        : chunk_(MakeChunk(first, last, chunk_size)),
+          last_(std::move(last)),
+          chunk_size_(chunk_size) {}
+    /**
+     * @brief Gets the chunk starting at the given iterator.
+     */
+    static Chunk MakeChunk(UnderlyingIterator first,
+                           const UnderlyingIterator& last, size_t chunk_size) {
+      UnderlyingIterator chunk_end = first;
+      for (size_t i = 0; i < chunk_size && chunk_end != last; ++i) {
+        ++chunk_end;
+      }
+      return Chunk{std::move(first), std::move(chunk_end)};
+    }
+
+    Chunk chunk_;
+    UnderlyingIterator last_;
+    size_t chunk_size_ = 0;
+  };
+  using iterator = Iterator;
+
+  ChunkView() = default;
+  /**
+   * @brief Creates view of the given range split into chunks.
+   *
+   * @param range underlying view, which should stay valid while chunks are
+   * traversed.
+   * @param chunk_size maximal number of elements in a chunk, positive.
+   */
+  ChunkView(Range range, size_t chunk_size)
+      : range_(std::move(range)), chunk_size_(chunk_size) {
+    assert(chunk_size_ > 0);
+  }
+  [[nodiscard]] Iterator begin() const {
+    return Iterator{range_.begin(), range_.end(), chunk_size_};
+  }
+  [[nodiscard]] Iterator end() const {
+    return Iterator{range_.end(), range_.end(), chunk_size_};
+  }
+
+ private:
+  Range range_;
+  size_t chunk_size_ = 1;
+};
+
+/**
+ * @brief Splits the given view into chunks of the given size.
+ */
+template <typename Range>
+ChunkView<Range> Chunks(Range range, size_t chunk_size) {
+  return ChunkView<Range>(std::move(range), chunk_size);
+}
+}  // namespace alpa
+#endif  // ALGORITHM_PACK_VIEWS_H
@@ -0,0 +1,154 @@
+﻿#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "algorithm_pack/b_tree_map.h"
+
+using ::testing::ElementsAreArray;
+using ::testing::IsNull;
+using ::testing::NotNull;
+
+namespace {
+template <typename K, size_t kCapacity>
+struct MapConfig {
+  using Key = K;
+  using Map = alpa::BTreeMap<K, uint64_t, kCapacity>;
+};
+
+template <typename Config>
+class BTreeMapTest : public ::testing::Test {};
+
+using MapConfigs =
+    ::testing::Types<MapConfig<int64_t, 32>, MapConfig<int32_t, 8>,
+                     MapConfig<uint32_t, 16>, MapConfig<uint64_t, 64>,
+                     MapConfig<int16_t, 8>>;
+}  // namespace
+
+TYPED_TEST_SUITE(BTreeMapTest, MapConfigs);
+
+TYPED_TEST(BTreeMapTest, CreateEmpty) {
+  typename TypeParam::Map test;
+  EXPECT_TRUE(test.Empty());
+  EXPECT_EQ(test.Size(), 0);
+  EXPECT_THAT(test.Find(0), IsNull());
+  EXPECT_FALSE(test.Erase(0));
+}
+
+TYPED_TEST(BTreeMapTest, RandomOperationsAgainstStdMap) {
+  using Key = typename TypeParam::Key;
+  constexpr int kOperationCount = 30'000;
+  constexpr Key kMin = std::numeric_limits<Key>::min();
+  constexpr Key kMax = std::numeric_limits<Key>::max();
+  // Keys close to the limits check handling of the padding value
+  const std::vector<Key> special_keys{kMin, static_cast<Key>(kMin + 1), 0,
+                                      static_cast<Key>(kMax - 1), kMax};
+  std::mt19937_64 gen(/*seed=*/sizeof(Key));
+  std::uniform_int_distribution<int> key_dist(-2'000, 2'000);
+  std::uniform_int_distribution<int> operation_dist(0, 9);
+  auto next_key = [&]() {
+    int val = key_dist(gen);
+    if (val % 97 == 0) {
+      return special_keys[static_cast<size_t>(val + 2'000) %
+                          special_keys.size()];
+    }
+    return static_cast<Key>(val);
+  };
+  typename TypeParam::Map test;
+  std::map<Key, uint64_t> check;
+  for (int i = 0; i < kOperationCount; ++i) {
+    Key key = next_key();
+    // Inserts dominate in the first half, erasures in the second one
+    int operation = operation_dist(gen);
+    bool insert = i < kOperationCount / 2 ? operation < 7 : operation < 3;
+    if (insert) {
+      auto value = static_cast<uint64_t>(i);
+      uint64_t* res = test.Insert(key, value);
+      ASSERT_THAT(res, NotNull());
+      auto [it, inserted] = check.emplace(key, value);
+      ASSERT_EQ(*res, it->second);
+    } else {
+      ASSERT_EQ(test.Erase(key), check.erase(key) == 1);
+    }
+    ASSERT_EQ(test.Size(), check.size());
+    Key probe = next_key();
+    const uint64_t* found = std::as_const(test).Find(probe);
+    auto it = check.find(probe);
+    ASSERT_EQ(found == nullptr, it == check.end());
+    if (found) {
+      ASSERT_EQ(*found, it->second);
+    }
+  }
+  std::vector<std::pair<Key, uint64_t>> visited;
+  test.VisitRange(kMin, kMax, [&visited](const Key& key, uint64_t& value) {
+    visited.emplace_back(key, value);
+  });
+  std::vector<std::pair<Key, uint64_t>> expected(check.begin(),
+                                                 check.lower_bound(kMax));
+  EXPECT_THAT(visited, ElementsAreArray(expected));
+  for (const auto& [key, value] : check) {
+    ASSERT_TRUE(test.Erase(key));
+  }
+  EXPECT_TRUE(test.Empty());
+}
+
+TYPED_TEST(BTreeMapTest, VisitRange) {
+  using Key = typename TypeParam::Key;
+  typename TypeParam::Map test;
+  for (Key key = 0; key < 1'000; key += 2) {
+    test.Insert(key, static_cast<uint64_t>(key));
+  }
+  std::vector<Key> visited;
+  test.VisitRange(101, 121, [&visited](const Key& key, uint64_t& value) {
+    visited.push_back(key);
+    value = 0;
+  });
+  EXPECT_THAT(visited, ElementsAreArray<Key>(
+                           {102, 104, 106, 108, 110, 112, 114, 116, 118, 120}));
+  ASSERT_THAT(test.Find(110), NotNull());
+  EXPECT_EQ(*test.Find(110), 0);
+  EXPECT_EQ(*test.Find(122), 122);
+  visited.clear();
+  test.VisitRange(500, 500, [&visited](const Key& key, uint64_t&) {
+    visited.push_back(key);
+  });
+  EXPECT_TRUE(visited.empty());
+  test.Clear();
+  EXPECT_TRUE(test.Empty());
+  test.VisitRange(0, 100, [&visited](const Key& key, uint64_t&) {
+    visited.push_back(key);
+  });
+  EXPECT_TRUE(visited.empty());
+}
+
+TEST(BTreeMapStringTest, InsertEraseStrings) {
+  constexpr int kInputSize = 2'000;
+  alpa::BTreeMap<int, std::string, 16> test;
+  for (int i = 0; i < kInputSize; ++i) {
+    std::string* res = test.Insert((i * 7) % kInputSize, std::to_string(i));
+    ASSERT_THAT(res, NotNull());
+  }
+  EXPECT_EQ(test.Size(), kInputSize);
+  std::string* old_value = test.Insert(7, "other");
+  ASSERT_THAT(old_value, NotNull());
+  EXPECT_EQ(*old_value, "1");
+  for (int i = 0; i < kInputSize; i += 2) {
+    EXPECT_TRUE(test.Erase((i * 7) % kInputSize));
+  }
+  for (int i = 0; i < kInputSize; ++i) {
+    std::string* res = test.Find((i * 7) % kInputSize);
+    if (i % 2 == 0) {
+      EXPECT_THAT(res, IsNull());
+    } else {
+      ASSERT_THAT(res, NotNull());
+      EXPECT_EQ(*res, std::to_string(i));
+    }
+  }
+}
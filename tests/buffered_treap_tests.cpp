@@ -0,0 +1,77 @@
+﻿#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <map>
+#include <random>
+#include <string>
+
+#include "algorithm_pack/buffered_treap.h"
+
+using ::testing::IsNull;
+using ::testing::NotNull;
+
+TEST(BufferedTreapTest, CreateEmpty) {
+  alpa::BufferedTreap<int, int> test(/*buffer_capacity=*/4, /*seed=*/1);
+  EXPECT_TRUE(test.Empty());
+  EXPECT_EQ(test.Size(), 0);
+  EXPECT_THAT(test.Find(0), IsNull());
+}
+
+TEST(BufferedTreapTest, OperationsOnSameKey) {
+  alpa::BufferedTreap<int, std::string> test(/*buffer_capacity=*/100,
+                                             /*seed=*/1);
+  test.Insert(1, "a");
+  test.Insert(1, "b");
+  ASSERT_THAT(test.Find(1), NotNull());
+  EXPECT_EQ(*test.Find(1), "a");
+  test.Flush();
+  test.Insert(1, "c");
+  EXPECT_EQ(*test.Find(1), "a");
+  test.Erase(1);
+  EXPECT_THAT(test.Find(1), IsNull());
+  test.Insert(1, "d");
+  test.Insert(1, "e");
+  EXPECT_EQ(test.BufferedCount(), 4);
+  EXPECT_EQ(*test.Find(1), "d");
+  EXPECT_EQ(test.Size(), 1);
+  EXPECT_EQ(test.BufferedCount(), 0);
+  EXPECT_EQ(*test.Find(1), "d");
+  test.Erase(1);
+  test.Erase(2);
+  EXPECT_TRUE(test.Empty());
+}
+
+TEST(BufferedTreapTest, RandomOperationsAgainstStdMap) {
+  constexpr int kOperationCount = 50'000;
+  constexpr size_t kBufferCapacity = 64;
+  std::mt19937_64 gen(/*seed=*/kOperationCount);
+  std::uniform_int_distribution<int> key_dist(0, 2'000);
+  std::uniform_int_distribution<int> operation_dist(0, 9);
+  alpa::BufferedTreap<int, int> test(kBufferCapacity, /*seed=*/1);
+  std::map<int, int> check;
+  for (int i = 0; i < kOperationCount; ++i) {
+    int key = key_dist(gen);
+    int operation = operation_dist(gen);
+    if (operation < 5) {
+      test.Insert(key, i);
+      check.emplace(key, i);
+    } else if (operation < 8) {
+      test.Erase(key);
+      check.erase(key);
+    } else {
+      int* res = test.Find(key);
+      auto it = check.find(key);
+      ASSERT_EQ(res == nullptr, it == check.end());
+      if (res) {
+        ASSERT_EQ(*res, it->second);
+      }
+    }
+    ASSERT_LT(test.BufferedCount(), kBufferCapacity);
+  }
+  EXPECT_EQ(test.Size(), check.size());
+  for (const auto& [key, value] : check) {
+    ASSERT_THAT(test.Find(key), NotNull());
+    ASSERT_EQ(*test.Find(key), value);
+  }
+}
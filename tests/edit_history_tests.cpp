@@ -0,0 +1,127 @@
+﻿#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "algorithm_pack/edit_history.h"
+#include "algorithm_pack/implicit_treap.h"
+
+namespace {
+using Document = alpa::ImplicitTreap<char>;
+
+Document MakeDocument(const std::string& text) {
+  return Document(std::vector<char>(text.begin(), text.end()), /*seed=*/1);
+}
+
+std::string ToString(const Document& document) {
+  return std::string(document.Begin(), document.End());
+}
+}  // namespace
+
+TEST(EditHistoryTest, UndoRedoRangeEdits) {
+  alpa::EditHistory<char> test(MakeDocument("hello world"),
+                               /*max_kept_elements=*/100,
+                               /*coalesce_limit=*/0);
+  EXPECT_FALSE(test.Undo());
+  test.Replace(6, 11, MakeDocument("there"));
+  test.Erase(0, 6);
+  test.Insert(5, MakeDocument(", friend"));
+  EXPECT_EQ(ToString(test.GetDocument()), "there, friend");
+  EXPECT_EQ(test.UndoCount(), 3);
+  EXPECT_TRUE(test.Undo());
+  EXPECT_EQ(ToString(test.GetDocument()), "there");
+  EXPECT_TRUE(test.Undo());
+  EXPECT_EQ(ToString(test.GetDocument()), "hello there");
+  EXPECT_TRUE(test.Redo());
+  EXPECT_EQ(ToString(test.GetDocument()), "there");
+  EXPECT_TRUE(test.Undo());
+  EXPECT_TRUE(test.Undo());
+  EXPECT_EQ(ToString(test.GetDocument()), "hello world");
+  EXPECT_FALSE(test.Undo());
+  EXPECT_EQ(test.RedoCount(), 3);
+  // New edit drops the redo steps
+  test.Insert(0, '>');
+  EXPECT_EQ(test.RedoCount(), 0);
+  EXPECT_FALSE(test.Redo());
+  EXPECT_EQ(ToString(test.GetDocument()), ">hello world");
+}
+
+TEST(EditHistoryTest, CoalescesTyping) {
+  alpa::EditHistory<char> test(MakeDocument("ab"), /*max_kept_elements=*/100,
+                               /*coalesce_limit=*/4);
+  const std::string typed = "123456";
+  for (size_t i = 0; i < typed.size(); ++i) test.Insert(1 + i, typed[i]);
+  EXPECT_EQ(ToString(test.GetDocument()), "a123456b");
+  // Six characters form two steps of at most four elements
+  EXPECT_EQ(test.UndoCount(), 2);
+  // Backspace and forward delete are coalesced in the same way
+  test.Seal();
+  test.Erase(6, 7);
+  test.Erase(5, 6);
+  test.Erase(4, 5);
+  EXPECT_EQ(ToString(test.GetDocument()), "a123b");
+  test.Seal();
+  test.Erase(0, 1);
+  test.Erase(0, 1);
+  EXPECT_EQ(ToString(test.GetDocument()), "23b");
+  EXPECT_EQ(test.UndoCount(), 4);
+  EXPECT_EQ(test.KeptElements(), 5);
+  test.Undo();
+  EXPECT_EQ(ToString(test.GetDocument()), "a123b");
+  test.Undo();
+  EXPECT_EQ(ToString(test.GetDocument()), "a123456b");
+  test.Undo();
+  EXPECT_EQ(ToString(test.GetDocument()), "a1234b");
+  test.Undo();
+  EXPECT_EQ(ToString(test.GetDocument()), "ab");
+}
+
+TEST(EditHistoryTest, DropsOldStepsOverLimit) {
+  alpa::EditHistory<char> test(MakeDocument(std::string(100, 'x')),
+                               /*max_kept_elements=*/25,
+                               /*coalesce_limit=*/0);
+  for (int i = 0; i < 5; ++i) test.Erase(0, 10);
+  EXPECT_EQ(test.UndoCount(), 2);
+  EXPECT_EQ(test.KeptElements(), 20);
+  test.Erase(0, 40);
+  EXPECT_EQ(test.UndoCount(), 1);
+  EXPECT_EQ(test.KeptElements(), 40);
+  EXPECT_TRUE(test.Undo());
+  EXPECT_FALSE(test.Undo());
+  EXPECT_EQ(test.GetDocument().Size(), 50);
+}
+
+TEST(EditHistoryTest, RandomEditsUndoneAndRedone) {
+  constexpr int kEditCount = 300;
+  std::mt19937_64 gen(/*seed=*/kEditCount);
+  alpa::EditHistory<char> test(MakeDocument("start"),
+                               /*max_kept_elements=*/1'000'000,
+                               /*coalesce_limit=*/8);
+  std::vector<std::string> versions{"start"};
+  std::string check = "start";
+  for (int i = 0; i < kEditCount; ++i) {
+    std::uniform_int_distribution<size_t> pos_dist(0, check.size());
+    size_t start = pos_dist(gen);
+    size_t end = std::min(check.size(), start + pos_dist(gen) % 20);
+    std::string inserted(gen() % 3 == 0 ? 0 : gen() % 30 + 1,
+                         static_cast<char>('a' + i % 26));
+    test.Replace(start, end, MakeDocument(inserted));
+    test.Seal();
+    check.replace(start, end - start, inserted);
+    if (start != end || !inserted.empty()) versions.push_back(check);
+    ASSERT_EQ(ToString(test.GetDocument()), check);
+  }
+  ASSERT_EQ(test.UndoCount() + 1, versions.size());
+  for (size_t i = versions.size() - 1; i > 0; --i) {
+    ASSERT_TRUE(test.Undo());
+    ASSERT_EQ(ToString(test.GetDocument()), versions[i - 1]);
+  }
+  for (size_t i = 1; i < versions.size(); ++i) {
+    ASSERT_TRUE(test.Redo());
+    ASSERT_EQ(ToString(test.GetDocument()), versions[i]);
+  }
+}
@@ -0,0 +1,137 @@
+﻿#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "algorithm_pack/euler_tour_forest.h"
+
+namespace {
+// Naive forest representation which answers queries via graph traversal
+class NaiveForest {
+ public:
+  explicit NaiveForest(size_t vertex_count) : adjacency_(vertex_count) {}
+
+  void Link(size_t u, size_t v) {
+    adjacency_[u].insert(v);
+    adjacency_[v].insert(u);
+  }
+
+  void Cut(size_t u, size_t v) {
+    adjacency_[u].erase(v);
+    adjacency_[v].erase(u);
+  }
+
+  // Number of vertices reachable from `v` without passing through `banned`
+  size_t CountReachable(size_t v, size_t banned) const {
+    std::vector<bool> visited(adjacency_.size(), false);
+    std::vector<size_t> stack{v};
+    visited[v] = true;
+    size_t count = 0;
+    while (!stack.empty()) {
+      size_t curr = stack.back();
+      stack.pop_back();
+      ++count;
+      for (size_t next : adjacency_[curr]) {
+        if (visited[next] || (curr == v && next == banned)) continue;
+        visited[next] = true;
+        stack.push_back(next);
+      }
+    }
+    return count;
+  }
+
+  bool Connected(size_t u, size_t v) const {
+    std::vector<bool> visited(adjacency_.size(), false);
+    std::vector<size_t> stack{u};
+    visited[u] = true;
+    while (!stack.empty()) {
+      size_t curr = stack.back();
+      stack.pop_back();
+      if (curr == v) return true;
+      for (size_t next : adjacency_[curr]) {
+        if (visited[next]) continue;
+        visited[next] = true;
+        stack.push_back(next);
+      }
+    }
+    return false;
+  }
+
+ private:
+  std::vector<std::set<size_t>> adjacency_;
+};
+}  // namespace
+
+TEST(EulerTourForestTest, IsolatedVertices) {
+  constexpr size_t kVertexCount = 5;
+  alpa::EulerTourForest test(kVertexCount, /*seed=*/kVertexCount);
+  EXPECT_EQ(test.VertexCount(), kVertexCount);
+  EXPECT_EQ(test.EdgeCount(), 0);
+  for (size_t i = 0; i < kVertexCount; ++i) {
+    EXPECT_EQ(test.ComponentSize(i), 1);
+    for (size_t j = 0; j < kVertexCount; ++j) {
+      EXPECT_EQ(test.Connected(i, j), i == j);
+    }
+  }
+}
+
+TEST(EulerTourForestTest, LinkAndCutPath) {
+  constexpr size_t kVertexCount = 6;
+  alpa::EulerTourForest test(kVertexCount, /*seed=*/kVertexCount);
+  for (size_t i = 1; i < kVertexCount; ++i) {
+    EXPECT_TRUE(test.Link(i - 1, i));
+    EXPECT_EQ(test.ComponentSize(0), i + 1);
+  }
+  EXPECT_EQ(test.EdgeCount(), kVertexCount - 1);
+  EXPECT_TRUE(test.Connected(0, kVertexCount - 1));
+  // Cycle is not allowed
+  EXPECT_FALSE(test.Link(0, kVertexCount - 1));
+  EXPECT_EQ(test.SubtreeSize(/*v=*/2, /*parent=*/1), kVertexCount - 2);
+  EXPECT_EQ(test.SubtreeSize(/*v=*/1, /*parent=*/2), 2);
+  EXPECT_TRUE(test.Cut(2, 1));
+  EXPECT_FALSE(test.Cut(2, 1));
+  EXPECT_FALSE(test.HasEdge(1, 2));
+  EXPECT_FALSE(test.Connected(0, kVertexCount - 1));
+  EXPECT_TRUE(test.Connected(0, 1));
+  EXPECT_TRUE(test.Connected(2, kVertexCount - 1));
+  EXPECT_EQ(test.ComponentSize(0), 2);
+  EXPECT_EQ(test.ComponentSize(kVertexCount - 1), kVertexCount - 2);
+}
+
+TEST(EulerTourForestTest, RandomOperations) {
+  constexpr size_t kVertexCount = 40;
+  constexpr int kOperationCount = 3'000;
+  alpa::EulerTourForest test(kVertexCount, /*seed=*/kVertexCount);
+  NaiveForest expected(kVertexCount);
+  std::vector<std::pair<size_t, size_t>> edges;
+  std::mt19937 rnd(kOperationCount);
+  std::uniform_int_distribution<size_t> vertex_dist(0, kVertexCount - 1);
+  for (int i = 0; i < kOperationCount; ++i) {
+    size_t u = vertex_dist(rnd);
+    size_t v = vertex_dist(rnd);
+    if (!edges.empty() && rnd() % 3 == 0) {
+      size_t index = rnd() % edges.size();
+      auto [from, to] = edges[index];
+      EXPECT_EQ(test.SubtreeSize(from, to), expected.CountReachable(from, to));
+      EXPECT_TRUE(test.Cut(from, to));
+      expected.Cut(from, to);
+      edges[index] = edges.back();
+      edges.pop_back();
+    } else {
+      bool connected = expected.Connected(u, v);
+      ASSERT_EQ(test.Connected(u, v), connected);
+      EXPECT_EQ(test.Link(u, v), !connected);
+      if (!connected) {
+        expected.Link(u, v);
+        edges.emplace_back(u, v);
+      }
+    }
+    EXPECT_EQ(test.EdgeCount(), edges.size());
+    EXPECT_EQ(test.ComponentSize(u), expected.CountReachable(u, u));
+  }
+}
@@ -0,0 +1,151 @@
+﻿#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <random>
+#include <string>
+#include <system_error>
+
+#include "algorithm_pack/external_treap.h"
+
+using ::testing::Optional;
+
+namespace {
+/**
+ * @brief Provides path to the temporary file, which is removed at the end of
+ * the test.
+ */
+class ExternalTreapTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    const auto* info = ::testing::UnitTest::GetInstance()->current_test_info();
+    path_ = (std::filesystem::temp_directory_path() /
+             (std::string("alpa_external_treap_") + info->name()))
+                .string();
+    std::filesystem::remove(path_);
+  }
+  void TearDown() override { std::filesystem::remove(path_); }
+
+  std::string path_;
+};
+}  // namespace
+
+TEST_F(ExternalTreapTest, CreateEmpty) {
+  alpa::ExternalTreap<int, int> test(path_, /*pool_pages=*/4, /*seed=*/1);
+  EXPECT_TRUE(test.Empty());
+  EXPECT_EQ(test.Size(), 0);
+  EXPECT_EQ(test.Find(0), std::nullopt);
+  EXPECT_FALSE(test.Erase(0));
+  EXPECT_FALSE(test.Update(0, 1));
+}
+
+TEST_F(ExternalTreapTest, RandomOperationsAgainstStdMap) {
+  constexpr int kOperationCount = 20'000;
+  std::mt19937_64 gen(/*seed=*/kOperationCount);
+  std::uniform_int_distribution<int> key_dist(0, 3'000);
+  std::uniform_int_distribution<int> operation_dist(0, 9);
+  alpa::ExternalTreap<int, int64_t, 256> test(path_, /*pool_pages=*/8,
+                                               /*seed=*/1);
+  std::map<int, int64_t> check;
+  for (int i = 0; i < kOperationCount; ++i) {
+    int key = key_dist(gen);
+    int operation = operation_dist(gen);
+    if (operation < 5) {
+      ASSERT_EQ(test.Insert(key, i), check.emplace(key, i).second);
+    } else if (operation < 7) {
+      bool exists = check.count(key) == 1;
+      if (exists) check[key] = -i;
+      ASSERT_EQ(test.Update(key, -i), exists);
+    } else {
+      ASSERT_EQ(test.Erase(key), check.erase(key) == 1);
+    }
+    ASSERT_EQ(test.Size(), check.size());
+  }
+  for (int key = 0; key <= 3'000; ++key) {
+    auto it = check.find(key);
+    if (it == check.end()) {
+      ASSERT_EQ(test.Find(key), std::nullopt);
+    } else {
+      ASSERT_THAT(test.Find(key), Optional(it->second));
+    }
+  }
+}
+
+TEST_F(ExternalTreapTest, ReopenFile) {
+  constexpr int kInputSize = 2'000;
+  {
+    alpa::ExternalTreap<int, double, 512> test(path_, /*pool_pages=*/4,
+                                               /*seed=*/1);
+    for (int i = 0; i < kInputSize; ++i) test.Insert(i, i / 2.0);
+    for (int i = 0; i < kInputSize; i += 2) test.Erase(i);
+    test.Flush();
+  }
+  alpa::ExternalTreap<int, double, 512> test(path_, /*pool_pages=*/4,
+                                             /*seed=*/2);
+  EXPECT_EQ(test.Size(), kInputSize / 2);
+  for (int i = 0; i < kInputSize; ++i) {
+    if (i % 2 == 0) {
+      ASSERT_EQ(test.Find(i), std::nullopt);
+    } else {
+      ASSERT_THAT(test.Find(i), Optional(i / 2.0));
+    }
+  }
+  // Erased slots are reused, so the file does not grow
+  uint64_t page_count = test.PageCount();
+  for (int i = 0; i < kInputSize; i += 2) test.Insert(i, 0.0);
+  EXPECT_LE(test.PageCount(), page_count * 5 / 4);
+  EXPECT_THROW((alpa::ExternalTreap<int, int, 512>(path_, 4, 1)),
+               std::system_error);
+  EXPECT_THROW((alpa::ExternalTreap<int, double>(path_, 4, 1)),
+               std::system_error);
+}
+
+TEST_F(ExternalTreapTest, CompactKeepsContent) {
+  constexpr int kInputSize = 3'000;
+  alpa::ExternalTreap<int, int, 256> test(path_, /*pool_pages=*/4, /*seed=*/1);
+  for (int i = 0; i < kInputSize; ++i) test.Insert((i * 7) % kInputSize, i);
+  for (int i = 0; i < kInputSize; i += 3) test.Erase(i);
+  test.Compact();
+  EXPECT_FALSE(std::filesystem::exists(path_ + ".compact"));
+  for (int i = 0; i < kInputSize; i += 3) test.Insert(i, -i);
+  test.Compact();
+  EXPECT_EQ(test.Size(), kInputSize);
+  for (int i = 0; i < kInputSize; ++i) {
+    ASSERT_THAT(test.Find((i * 7) % kInputSize),
+                Optional(((i * 7) % kInputSize) % 3 == 0
+                             ? -((i * 7) % kInputSize)
+                             : i));
+  }
+}
+
+TEST_F(ExternalTreapTest, PageReadsPerLookup) {
+  constexpr int kInputSize = 100'000;
+  constexpr size_t kPoolPages = 16;
+  alpa::ExternalTreap<int64_t, int64_t> test(path_, kPoolPages, /*seed=*/1);
+  std::mt19937_64 gen(/*seed=*/kInputSize);
+  std::uniform_int_distribution<int64_t> key_dist(0, kInputSize * 10);
+  for (int i = 0; i < kInputSize; ++i) test.Insert(key_dist(gen), i);
+  test.Flush();
+  // Data set is at least ten times larger than the pool
+  EXPECT_GT(test.PageCount(), kPoolPages * 10);
+  constexpr int kLookupCount = 2'000;
+  auto measure_reads = [&]() {
+    test.ResetStats();
+    for (int i = 0; i < kLookupCount; ++i) test.Find(key_dist(gen));
+    EXPECT_EQ(test.Stats().page_writes, 0);
+    return static_cast<double>(test.Stats().page_reads) / kLookupCount;
+  };
+  double reads_before = measure_reads();
+  test.Compact();
+  double reads_after = measure_reads();
+  // Path from the root has about 2 ln(n) nodes, after compaction each page
+  // covers several levels of it
+  EXPECT_LT(reads_after, std::log(kInputSize) / 2);
+  EXPECT_LT(reads_after * 3, reads_before);
+  RecordProperty("reads_before", std::to_string(reads_before));
+  RecordProperty("reads_after", std::to_string(reads_after));
+}
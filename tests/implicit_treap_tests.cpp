@@ -3,12 +3,17 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <iterator>
+#include <limits>
 #include <numeric>
 #include <random>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -897,4 +902,686 @@ TEST(ImplicitTreapTest, ClearTest) {
   test.Clear();
   EXPECT_EQ(test.Size(), 0);
   EXPECT_TRUE(test.Empty());
-}
\ No newline at end of file
+}
+
+TEST(ImplicitTreapTest, RangeHashEqualRanges) {
+  using HashedTreap = alpa::ImplicitTreap<int, std::hash<int>>;
+  const std::vector<int> input{1, 2, 3, 1, 2, 3, 4, 1, 2, 3, 1, 2};
+  HashedTreap test(input, /*seed=*/input.size());
+  EXPECT_EQ(test.RangeHash(0, 0), 0);
+  EXPECT_EQ(test.RangeHash(0, 3), test.RangeHash(3, 6));
+  EXPECT_EQ(test.RangeHash(0, 3), test.RangeHash(7, 10));
+  EXPECT_NE(test.RangeHash(0, 3), test.RangeHash(1, 4));
+  EXPECT_NE(test.RangeHash(0, 4), test.RangeHash(3, 7));
+  EXPECT_TRUE(test.RangeEqual(0, 7, 5));
+  EXPECT_FALSE(test.RangeEqual(0, 3, 4));
+  EXPECT_EQ(test.LongestCommonPrefix(0, 3), 3);
+  EXPECT_EQ(test.LongestCommonPrefix(0, 7), 5);
+  EXPECT_EQ(test.LongestCommonPrefix(0, 0), input.size());
+  EXPECT_EQ(test.LongestCommonPrefix(input.size(), 0), 0);
+  // Hashes do not depend on the treap structure
+  HashedTreap other(input, /*seed=*/input.size() + 1);
+  EXPECT_EQ(other.RangeHash(2, 9), test.RangeHash(2, 9));
+  EXPECT_TRUE(other.RangeEqual(1, test, 1, input.size() - 1));
+}
+
+TEST(ImplicitTreapTest, RangeHashAfterModifications) {
+  using HashedTreap = alpa::ImplicitTreap<int, std::hash<int>>;
+  constexpr int kInputSize = 300;
+  constexpr int kOperationCount = 300;
+  std::mt19937 rnd(kInputSize);
+  std::uniform_int_distribution<int> value_dist(0, 2);
+  std::vector<int> expected(kInputSize);
+  for (auto& el : expected) el = value_dist(rnd);
+  HashedTreap test(expected, /*seed=*/kInputSize);
+  for (int i = 0; i < kOperationCount; ++i) {
+    switch (rnd() % 4) {
+      case 0: {
+        size_t pos = rnd() % (expected.size() + 1);
+        int value = value_dist(rnd);
+        test.Insert(value, pos);
+        expected.insert(expected.begin() + static_cast<int>(pos), value);
+        break;
+      }
+      case 1: {
+        size_t pos = rnd() % expected.size();
+        test.Erase(pos);
+        expected.erase(expected.begin() + static_cast<int>(pos));
+        break;
+      }
+      case 2: {
+        size_t begin = rnd() % expected.size();
+        size_t end = begin + rnd() % (expected.size() - begin) + 1;
+        size_t new_begin = begin + rnd() % (end - begin);
+        test.Rotate(begin, new_begin, end);
+        std::rotate(expected.begin() + static_cast<int>(begin),
+                    expected.begin() + static_cast<int>(new_begin),
+                    expected.begin() + static_cast<int>(end));
+        break;
+      }
+      default: {
+        size_t begin = rnd() % expected.size();
+        size_t end = begin + rnd() % (expected.size() - begin);
+        HashedTreap extracted = test.Extract(begin, end);
+        test.Concatenate(std::move(extracted));
+        std::rotate(expected.begin() + static_cast<int>(begin),
+                    expected.begin() + static_cast<int>(end), expected.end());
+        break;
+      }
+    }
+    size_t lhs = rnd() % expected.size();
+    size_t rhs = rnd() % expected.size();
+    auto mismatch =
+        std::mismatch(expected.begin() + static_cast<int>(lhs), expected.end(),
+                      expected.begin() + static_cast<int>(rhs), expected.end());
+    auto common = static_cast<size_t>(std::distance(
+        expected.begin() + static_cast<int>(lhs), mismatch.first));
+    ASSERT_EQ(test.LongestCommonPrefix(lhs, rhs), common);
+    HashedTreap copy(expected, /*seed=*/static_cast<uint64_t>(i));
+    EXPECT_EQ(copy.RangeHash(0, expected.size()),
+              test.RangeHash(0, test.Size()));
+  }
+}
+
+TEST(ImplicitTreapTest, RangeHashStrings) {
+  using HashedTreap = alpa::ImplicitTreap<std::string, std::hash<std::string>>;
+  const std::vector<std::string> lhs_input{"a", "b", "c", "d", "e"};
+  const std::vector<std::string> rhs_input{"x", "b", "c", "d", "y"};
+  HashedTreap lhs(lhs_input, /*seed=*/lhs_input.size());
+  HashedTreap rhs(rhs_input, /*seed=*/rhs_input.size());
+  EXPECT_FALSE(lhs.RangeEqual(0, rhs, 0, 1));
+  EXPECT_TRUE(lhs.RangeEqual(1, rhs, 1, 3));
+  EXPECT_EQ(lhs.LongestCommonPrefix(1, rhs, 1), 3);
+  rhs.Insert("a", 0);
+  EXPECT_EQ(lhs.LongestCommonPrefix(0, rhs, 0), 1);
+}
+
+TEST(ImplicitTreapTest, SortRange) {
+  constexpr int kInputSize = 500;
+  std::vector<int> input(kInputSize);
+  std::mt19937 rnd(kInputSize);
+  std::uniform_int_distribution<int> dist(0, kInputSize / 4);
+  for (auto& el : input) el = dist(rnd);
+  alpa::ImplicitTreap<int> test(input, /*seed=*/kInputSize);
+  auto it = test.Begin() + 10;
+  test.SortRange(10, 400);
+  std::sort(input.begin() + 10, input.begin() + 400);
+  EXPECT_THAT(std::vector<int>(test.Begin(), test.End()),
+              ElementsAreArray(input));
+  EXPECT_EQ(*it, input[10]);
+  test.SortRange(0, test.Size(), std::greater<>{});
+  std::sort(input.begin(), input.end(), std::greater<>{});
+  EXPECT_THAT(std::vector<int>(test.Begin(), test.End()),
+              ElementsAreArray(input));
+  // Empty and single element ranges
+  test.SortRange(5, 5);
+  test.SortRange(5, 6);
+  EXPECT_THAT(std::vector<int>(test.Begin(), test.End()),
+              ElementsAreArray(input));
+}
+
+TEST(ImplicitTreapTest, StableSortRange) {
+  using Item = std::pair<int, int>;
+  constexpr int kInputSize = 300;
+  std::vector<Item> input(kInputSize);
+  std::mt19937 rnd(kInputSize);
+  std::uniform_int_distribution<int> dist(0, 5);
+  for (int i = 0; i < kInputSize; ++i) {
+    input[static_cast<size_t>(i)] = {dist(rnd), i};
+  }
+  auto by_first = [](const Item& lhs, const Item& rhs) {
+    return lhs.first < rhs.first;
+  };
+  alpa::ImplicitTreap<Item> test(input, /*seed=*/kInputSize);
+  test.StableSortRange(20, 250, by_first);
+  std::stable_sort(input.begin() + 20, input.begin() + 250, by_first);
+  EXPECT_THAT(std::vector<Item>(test.Begin(), test.End()),
+              ElementsAreArray(input));
+}
+
+TEST(ImplicitTreapTest, SortRangeKeepsHashes) {
+  using HashedTreap = alpa::ImplicitTreap<int, std::hash<int>>;
+  const std::vector<int> input{9, 8, 7, 6, 5, 4, 3, 2, 1, 0};
+  HashedTreap test(input, /*seed=*/input.size());
+  test.SortRange(2, 8);
+  const std::vector<int> expected{9, 8, 2, 3, 4, 5, 6, 7, 1, 0};
+  HashedTreap sorted(expected, /*seed=*/expected.size());
+  EXPECT_EQ(test.RangeHash(0, test.Size()),
+            sorted.RangeHash(0, sorted.Size()));
+  EXPECT_EQ(test.LongestCommonPrefix(0, sorted, 0), expected.size());
+}
+
+TEST(ImplicitTreapTest, RangeEqualResistsPreparedCollision) {
+  using HashedTreap = alpa::ImplicitTreap<uint64_t, std::hash<uint64_t>>;
+  // Sequences collide for the hash base 0x1e3779b97f4a7c15 and the identity
+  // hasher: (1 + 1) * base + (base + 6) == (2 + 1) * base + 6
+  constexpr uint64_t kFixedBase = 0x1e3779b97f4a7c15;
+  HashedTreap first(std::vector<uint64_t>{1, kFixedBase + 5}, /*seed=*/1);
+  HashedTreap second(std::vector<uint64_t>{2, 5}, /*seed=*/2);
+  EXPECT_FALSE(first.RangeEqual(0, second, 0, 2));
+  EXPECT_EQ(first.LongestCommonPrefix(0, second, 0), 0);
+  // Equal sequences in different containers still compare equal
+  HashedTreap copy(std::vector<uint64_t>{1, kFixedBase + 5}, /*seed=*/3);
+  EXPECT_TRUE(first.RangeEqual(0, copy, 0, 2));
+}
+
+TEST(ImplicitTreapTest, SortRangeThrowingComparator) {
+  using HashedTreap = alpa::ImplicitTreap<int, std::hash<int>>;
+  constexpr int kInputSize = 200;
+  std::vector<int> input(kInputSize);
+  std::iota(input.rbegin(), input.rend(), 0);
+  HashedTreap test(input, /*seed=*/kInputSize);
+  int comparisons = 0;
+  auto throwing = [&comparisons](int lhs, int rhs) {
+    if (++comparisons > kInputSize) throw std::runtime_error("comparator");
+    return lhs < rhs;
+  };
+  EXPECT_THROW(test.SortRange(10, 150, throwing), std::runtime_error);
+  ASSERT_EQ(test.Size(), input.size());
+  std::vector<int> content(test.Begin(), test.End());
+  EXPECT_TRUE(std::equal(input.begin(), input.begin() + 10, content.begin()));
+  EXPECT_TRUE(
+      std::equal(input.begin() + 150, input.end(), content.begin() + 150));
+  // Elements of the range are unspecified, but the treap stays consistent
+  HashedTreap reference(content, /*seed=*/0);
+  EXPECT_EQ(test.RangeHash(0, test.Size()),
+            reference.RangeHash(0, reference.Size()));
+}
+
+namespace {
+/**
+ * @brief Element whose move assignment throws once the budget runs out.
+ */
+struct ThrowingMove {
+  explicit ThrowingMove(int g_value) : value(g_value) {}
+  ThrowingMove(const ThrowingMove&) = default;
+  ThrowingMove(ThrowingMove&&) = default;
+  ThrowingMove& operator=(const ThrowingMove&) = default;
+  ThrowingMove& operator=(ThrowingMove&& other) {
+    if (budget-- == 0) throw std::runtime_error("move");
+    value = other.value;
+    return *this;
+  }
+  ~ThrowingMove() = default;
+  friend bool operator<(const ThrowingMove& lhs, const ThrowingMove& rhs) {
+    return lhs.value < rhs.value;
+  }
+
+  static inline int budget = 0;
+  int value;
+};
+}  // namespace
+
+TEST(ImplicitTreapTest, SortRangeThrowingMoveBack) {
+  std::vector<ThrowingMove> input;
+  for (int i = 100; i > 0; --i) input.emplace_back(i);
+  alpa::ImplicitTreap<ThrowingMove> test(input, /*seed=*/input.size());
+  // Sorting a copy of the range measures how many moves the sort needs
+  std::vector<ThrowingMove> measured(input.begin() + 10, input.begin() + 90);
+  ThrowingMove::budget = std::numeric_limits<int>::max();
+  std::sort(measured.begin(), measured.end());
+  int sort_moves = std::numeric_limits<int>::max() - ThrowingMove::budget;
+  // Moves back to the nodes run out of the budget
+  ThrowingMove::budget = sort_moves + 5;
+  EXPECT_THROW(test.SortRange(10, 90), std::runtime_error);
+  ThrowingMove::budget = std::numeric_limits<int>::max();
+  ASSERT_EQ(test.Size(), input.size());
+  EXPECT_EQ(std::distance(test.Begin(), test.End()),
+            static_cast<std::ptrdiff_t>(input.size()));
+  EXPECT_EQ(test[0].value, 100);
+  EXPECT_EQ(test[99].value, 1);
+  test.Erase(50);
+  EXPECT_EQ(test.Size(), input.size() - 1);
+}
+
+TEST(ImplicitTreapTest, IteratorDifferenceType) {
+  static_assert(
+      std::is_same_v<alpa::ImplicitTreap<int>::Iterator::difference_type,
+                     std::ptrdiff_t>);
+  static_assert(
+      std::is_same_v<alpa::ImplicitTreap<int>::ConstIterator::difference_type,
+                     std::ptrdiff_t>);
+  constexpr std::ptrdiff_t kInputSize = 1'000;
+  std::vector<int> input(static_cast<size_t>(kInputSize));
+  std::iota(input.begin(), input.end(), 0);
+  alpa::ImplicitTreap<int> test(input, /*seed=*/input.size());
+  std::ptrdiff_t distance = test.End() - test.Begin();
+  EXPECT_EQ(distance, kInputSize);
+  EXPECT_EQ(std::distance(test.CBegin(), test.CEnd()), kInputSize);
+  auto it = test.End();
+  it -= kInputSize;
+  EXPECT_EQ(it, test.Begin());
+  it += kInputSize - 1;
+  EXPECT_EQ(*it, input.back());
+}
+
+TEST(ImplicitTreapTest, HandlesFollowElements) {
+  using Treap = alpa::ImplicitTreap<int>;
+  constexpr int kInputSize = 200;
+  std::vector<int> expected(kInputSize);
+  std::iota(expected.begin(), expected.end(), 0);
+  Treap test(/*seed=*/kInputSize);
+  std::vector<Treap::Handle> handles;
+  for (const auto& el : expected) {
+    handles.push_back(test.PushBack(el));
+  }
+  std::mt19937 rnd(kInputSize);
+  for (int i = 0; i < kInputSize; ++i) {
+    size_t pos = rnd() % expected.size();
+    if (rnd() % 2 == 0) {
+      test.Insert(-1, pos);
+      expected.insert(expected.begin() + static_cast<int>(pos), -1);
+    } else if (expected[pos] == -1) {
+      test.Erase(pos);
+      expected.erase(expected.begin() + static_cast<int>(pos));
+    } else {
+      size_t new_begin = rnd() % expected.size();
+      test.Rotate(0, new_begin, test.Size());
+      std::rotate(expected.begin(),
+                  expected.begin() + static_cast<int>(new_begin),
+                  expected.end());
+    }
+  }
+  for (int i = 0; i < kInputSize; ++i) {
+    auto& handle = handles[static_cast<size_t>(i)];
+    ASSERT_TRUE(handle);
+    EXPECT_EQ(*handle, i);
+    size_t index = test.IndexOf(handle);
+    ASSERT_LT(index, expected.size());
+    EXPECT_EQ(expected[index], i);
+    EXPECT_EQ(test.HandleAt(index), handle);
+  }
+}
+
+TEST(ImplicitTreapTest, HandleInsertAndErase) {
+  using Treap = alpa::ImplicitTreap<int>;
+  Treap test(/*seed=*/1);
+  EXPECT_FALSE(Treap::Handle{});
+  Treap::Handle two = test.InsertAfter(Treap::Handle{}, 2);
+  Treap::Handle one = test.InsertAfter(Treap::Handle{}, 1);
+  Treap::Handle four = test.InsertAfter(two, 4);
+  Treap::Handle three = test.InsertAfter(two, 3);
+  test.PushBack(5);
+  EXPECT_THAT(std::vector<int>(test.Begin(), test.End()),
+              ElementsAre(1, 2, 3, 4, 5));
+  EXPECT_EQ(test.IndexOf(three), 2);
+  test.Erase(two);
+  EXPECT_EQ(test.Size(), 4);
+  EXPECT_THAT(std::vector<int>(test.Begin(), test.End()),
+              ElementsAre(1, 3, 4, 5));
+  EXPECT_EQ(test.IndexOf(four), 2);
+  *four = 40;
+  EXPECT_EQ(test[2], 40);
+  test.Erase(one);
+  test.Erase(test.HandleAt(test.Size() - 1));
+  EXPECT_THAT(std::vector<int>(test.Begin(), test.End()), ElementsAre(3, 40));
+  test.Erase(three);
+  test.Erase(four);
+  EXPECT_TRUE(test.Empty());
+  EXPECT_EQ(test.Size(), 0);
+}
+
+TEST(ImplicitTreapTest, HandleEraseKeepsHashes) {
+  using HashedTreap = alpa::ImplicitTreap<int, std::hash<int>>;
+  constexpr int kInputSize = 100;
+  std::vector<int> expected(kInputSize);
+  std::iota(expected.begin(), expected.end(), 0);
+  HashedTreap test(/*seed=*/kInputSize);
+  std::vector<HashedTreap::Handle> handles;
+  for (const auto& el : expected) {
+    handles.push_back(test.PushBack(el));
+  }
+  for (size_t i = 0; i < handles.size(); i += 3) {
+    test.Erase(handles[i]);
+  }
+  std::vector<int> remaining;
+  for (size_t i = 0; i < expected.size(); ++i) {
+    if (i % 3 != 0) remaining.push_back(expected[i]);
+  }
+  HashedTreap reference(remaining, /*seed=*/remaining.size());
+  ASSERT_EQ(test.Size(), remaining.size());
+  EXPECT_EQ(test.RangeHash(0, test.Size()),
+            reference.RangeHash(0, reference.Size()));
+}
+
+TEST(ImplicitTreapTest, AddressPriority) {
+  using AddressTreap =
+      alpa::ImplicitTreap<int, std::hash<int>, alpa::AddressPriority>;
+  constexpr int kInputSize = 2'000;
+  std::mt19937 rnd(kInputSize);
+  std::vector<int> expected(kInputSize);
+  std::iota(expected.begin(), expected.end(), 0);
+  AddressTreap test(expected, /*seed=*/0);
+  for (int i = 0; i < kInputSize; ++i) {
+    size_t pos = rnd() % (expected.size() + 1);
+    if (i % 3 == 0) {
+      test.Insert(-i, pos);
+      expected.insert(expected.begin() + static_cast<int>(pos), -i);
+    } else if (pos < expected.size()) {
+      test.Erase(pos);
+      expected.erase(expected.begin() + static_cast<int>(pos));
+    }
+  }
+  size_t begin = expected.size() / 3;
+  size_t end = expected.size() / 2;
+  AddressTreap extracted = test.Extract(begin, end);
+  test.Concatenate(std::move(extracted));
+  std::rotate(expected.begin() + static_cast<int>(begin),
+              expected.begin() + static_cast<int>(end), expected.end());
+  ASSERT_EQ(test.Size(), expected.size());
+  EXPECT_TRUE(std::equal(test.Begin(), test.End(), expected.begin()));
+  AddressTreap reference(expected, /*seed=*/1);
+  EXPECT_EQ(test.RangeHash(0, test.Size()),
+            reference.RangeHash(0, reference.Size()));
+}
+
+TEST(ImplicitTreapTest, CompactKeepsContent) {
+  using HashedTreap = alpa::ImplicitTreap<std::string, std::hash<std::string>>;
+  constexpr int kInputSize = 1'000;
+  std::mt19937 rnd(kInputSize);
+  HashedTreap test(/*seed=*/kInputSize);
+  std::vector<std::string> expected;
+  for (int i = 0; i < kInputSize; ++i) {
+    size_t pos = rnd() % (expected.size() + 1);
+    test.Insert(std::to_string(i), pos);
+    expected.insert(expected.begin() + static_cast<int>(pos),
+                    std::to_string(i));
+  }
+  test.Compact();
+  // Consecutive elements are placed in consecutive nodes
+  for (size_t i = 0; i + 1 < expected.size(); ++i) {
+    auto distance = reinterpret_cast<std::uintptr_t>(&test[i + 1]) -
+                    reinterpret_cast<std::uintptr_t>(&test[i]);
+    ASSERT_EQ(distance, reinterpret_cast<std::uintptr_t>(&test[1]) -
+                            reinterpret_cast<std::uintptr_t>(&test[0]));
+  }
+  // Nodes from the arena are erased and moved between treaps
+  for (int i = 0; i < kInputSize / 2; ++i) {
+    size_t pos = rnd() % expected.size();
+    test.Erase(pos);
+    expected.erase(expected.begin() + static_cast<int>(pos));
+    test.Insert(std::to_string(-i), pos);
+    expected.insert(expected.begin() + static_cast<int>(pos),
+                    std::to_string(-i));
+  }
+  HashedTreap extracted = test.Extract(10, 500);
+  HashedTreap other(/*seed=*/1);
+  other.PushBack("other");
+  other.Concatenate(std::move(extracted));
+  test.Compact();
+  test.Erase(0);
+  other.Compact();
+  other.Erase(1);
+  std::vector<std::string> expected_other{"other"};
+  expected_other.insert(expected_other.end(), expected.begin() + 11,
+                        expected.begin() + 500);
+  expected.erase(expected.begin() + 10, expected.begin() + 500);
+  expected.erase(expected.begin());
+  EXPECT_TRUE(std::equal(test.Begin(), test.End(), expected.begin(),
+                         expected.end()));
+  EXPECT_TRUE(std::equal(other.Begin(), other.End(), expected_other.begin(),
+                         expected_other.end()));
+  HashedTreap reference(expected, /*seed=*/2);
+  EXPECT_EQ(test.RangeHash(0, test.Size()),
+            reference.RangeHash(0, reference.Size()));
+  test.Clear();
+  test.Compact();
+  EXPECT_TRUE(test.Empty());
+}
+
+TEST(ImplicitTreapTest, InsertTreap) {
+  alpa::ImplicitTreap<int> test(std::vector<int>{0, 1, 5, 6}, /*seed=*/1);
+  test.Insert(alpa::ImplicitTreap<int>(std::vector<int>{2, 3, 4}, 2),
+              /*pos=*/2);
+  alpa::ImplicitTreap<int> other(std::vector<int>{7}, /*seed=*/3);
+  test.Insert(std::move(other), 100);
+  EXPECT_TRUE(other.Empty());
+  test.Insert(alpa::ImplicitTreap<int>{}, 0);
+  EXPECT_THAT(std::vector<int>(test.Begin(), test.End()),
+              ElementsAre(0, 1, 2, 3, 4, 5, 6, 7));
+}
+
+TEST(ImplicitTreapTest, SplitAtPositions) {
+  constexpr size_t kInputSize = 1'000;
+  std::vector<int> input(kInputSize);
+  std::iota(input.begin(), input.end(), 0);
+  alpa::ImplicitTreap<int, std::hash<int>> test(input, /*seed=*/1);
+  const std::vector<size_t> positions{0, 10, 10, 500, 999, 1'000};
+  auto piece_range = [&positions, &input](size_t i) {
+    return std::make_pair(i == 0 ? 0 : positions[i - 1],
+                          i == positions.size() ? input.size() : positions[i]);
+  };
+  std::vector<uint64_t> hashes;
+  for (size_t i = 0; i <= positions.size(); ++i) {
+    auto [begin, end] = piece_range(i);
+    hashes.push_back(test.RangeHash(begin, end));
+  }
+  auto pieces = test.SplitAt(positions);
+  EXPECT_TRUE(test.Empty());
+  ASSERT_EQ(pieces.size(), positions.size() + 1);
+  for (size_t i = 0; i < pieces.size(); ++i) {
+    auto [begin, end] = piece_range(i);
+    ASSERT_EQ(pieces[i].Size(), end - begin);
+    EXPECT_TRUE(std::equal(pieces[i].Begin(), pieces[i].End(),
+                           input.begin() + static_cast<std::ptrdiff_t>(begin),
+                           input.begin() + static_cast<std::ptrdiff_t>(end)));
+    EXPECT_EQ(pieces[i].RangeHash(0, end - begin), hashes[i]);
+  }
+}
+
+TEST(ImplicitTreapTest, ParallelApply) {
+  constexpr int kInputSize = 100'000;
+  constexpr size_t kPieceCount = 16;
+  std::vector<int> input(kInputSize);
+  std::iota(input.begin(), input.end(), 0);
+  alpa::ImplicitTreap<int> test(input, /*seed=*/1);
+  std::vector<size_t> positions;
+  for (size_t i = 1; i < kPieceCount; ++i) {
+    positions.push_back(i * kInputSize / kPieceCount);
+  }
+  // Each piece is negated and gets its number appended
+  test.ParallelApply(
+      positions,
+      [](alpa::ImplicitTreap<int>& piece, size_t index) {
+        for (auto it = piece.Begin(); it != piece.End(); ++it) *it = -*it;
+        piece.PushBack(static_cast<int>(index));
+      },
+      /*thread_count=*/4);
+  std::vector<int> expected;
+  for (size_t i = 0; i < kPieceCount; ++i) {
+    size_t begin = i == 0 ? 0 : positions[i - 1];
+    size_t end = i + 1 == kPieceCount ? input.size() : positions[i];
+    for (size_t j = begin; j < end; ++j) expected.push_back(-input[j]);
+    expected.push_back(static_cast<int>(i));
+  }
+  ASSERT_EQ(test.Size(), expected.size());
+  EXPECT_TRUE(std::equal(test.Begin(), test.End(), expected.begin()));
+  // Treap is merged back even if a call throws
+  auto throwing = [](alpa::ImplicitTreap<int>&, size_t index) {
+    if (index == 3) throw std::runtime_error("piece 3");
+  };
+  EXPECT_THROW(test.ParallelApply(positions, throwing), std::runtime_error);
+  EXPECT_EQ(test.Size(), expected.size());
+  EXPECT_TRUE(std::equal(test.Begin(), test.End(), expected.begin()));
+}
+
+TEST(ImplicitTreapTest, ParallelBuild) {
+  using Treap = alpa::ImplicitTreap<int, std::hash<int>>;
+  constexpr int kInputSize = 100'000;
+  std::vector<int> input(kInputSize);
+  std::mt19937 rnd(kInputSize);
+  for (auto& el : input) el = static_cast<int>(rnd() % 1'000);
+  Treap sequential(input, /*seed=*/7);
+  for (size_t thread_count : {0U, 1U, 3U, 8U}) {
+    Treap test(input, /*seed=*/7, thread_count);
+    ASSERT_EQ(test.Size(), input.size());
+    EXPECT_TRUE(std::equal(test.Begin(), test.End(), input.begin()));
+    EXPECT_EQ(test.RangeHash(0, test.Size()),
+              sequential.RangeHash(0, sequential.Size()));
+    EXPECT_EQ(test.RangeHash(100, 60'000), sequential.RangeHash(100, 60'000));
+    test.Insert(-1, 500);
+    test.Erase(0);
+    EXPECT_EQ(test[499], -1);
+    EXPECT_EQ(test.Size(), input.size());
+  }
+  // More threads than elements and an empty input
+  std::vector<int> small = {1, 2, 3};
+  Treap small_test(small, /*seed=*/1, /*thread_count=*/16);
+  EXPECT_THAT(std::vector<int>(small_test.Begin(), small_test.End()),
+              ElementsAre(1, 2, 3));
+  Treap empty_test(std::vector<int>{}, /*seed=*/1, /*thread_count=*/4);
+  EXPECT_TRUE(empty_test.Empty());
+  // Address priorities do not need the generator
+  alpa::ImplicitTreap<int, void, alpa::AddressPriority> address_test(
+      input, /*seed=*/1, /*thread_count=*/4);
+  EXPECT_TRUE(
+      std::equal(address_test.Begin(), address_test.End(), input.begin()));
+}
+
+namespace {
+/**
+ * @brief Element whose copy constructor throws once the budget runs out.
+ */
+struct ThrowingCopy {
+  explicit ThrowingCopy(int g_value) : value(g_value) {}
+  ThrowingCopy(const ThrowingCopy& other) : value(other.value) {
+    if (budget-- == 0) throw std::runtime_error("copy");
+  }
+  ThrowingCopy(ThrowingCopy&&) = default;
+  ThrowingCopy& operator=(const ThrowingCopy&) = default;
+  ThrowingCopy& operator=(ThrowingCopy&&) = default;
+  ~ThrowingCopy() = default;
+
+  static inline std::atomic<int> budget = 0;
+  int value;
+};
+}  // namespace
+
+TEST(ImplicitTreapTest, ParallelBuildThrowingCopy) {
+  std::vector<ThrowingCopy> input;
+  for (int i = 0; i < 1'000; ++i) input.emplace_back(i);
+  ThrowingCopy::budget = 700;
+  using Treap = alpa::ImplicitTreap<ThrowingCopy>;
+  EXPECT_THROW(Treap(input, /*seed=*/1, /*thread_count=*/4),
+               std::runtime_error);
+  ThrowingCopy::budget = std::numeric_limits<int>::max();
+  Treap test(input, /*seed=*/1, /*thread_count=*/4);
+  EXPECT_EQ(test.Size(), input.size());
+  EXPECT_EQ(test[999].value, 999);
+}
+
+TEST(ImplicitTreapTest, ReorderBlocks) {
+  constexpr size_t kInputSize = 2'000;
+  std::mt19937_64 gen(/*seed=*/kInputSize);
+  std::vector<int> check(kInputSize);
+  std::iota(check.begin(), check.end(), 0);
+  alpa::ImplicitTreap<int, std::hash<int>> test(check, /*seed=*/1);
+  for (int round = 0; round < 50; ++round) {
+    std::uniform_int_distribution<size_t> pos_dist(0, kInputSize);
+    std::vector<size_t> boundaries(gen() % 10);
+    for (size_t& boundary : boundaries) boundary = pos_dist(gen);
+    std::sort(boundaries.begin(), boundaries.end());
+    std::vector<size_t> permutation(std::max<size_t>(boundaries.size(), 1) -
+                                    1);
+    std::iota(permutation.begin(), permutation.end(), 0);
+    std::shuffle(permutation.begin(), permutation.end(), gen);
+    auto at = [&check](size_t pos) {
+      return check.begin() + static_cast<std::ptrdiff_t>(pos);
+    };
+    std::vector<int> reordered(
+        check.begin(), boundaries.empty() ? check.end() : at(boundaries[0]));
+    for (size_t block : permutation) {
+      reordered.insert(reordered.end(), at(boundaries[block]),
+                       at(boundaries[block + 1]));
+    }
+    if (!boundaries.empty()) {
+      reordered.insert(reordered.end(), at(boundaries.back()), check.end());
+    }
+    check = std::move(reordered);
+    test.ReorderBlocks(boundaries, permutation);
+    ASSERT_EQ(test.Size(), kInputSize);
+    ASSERT_TRUE(std::equal(test.Begin(), test.End(), check.begin()));
+  }
+  alpa::ImplicitTreap<int, std::hash<int>> fresh(check, /*seed=*/2);
+  EXPECT_EQ(test.RangeHash(0, kInputSize), fresh.RangeHash(0, kInputSize));
+}
+
+TEST(ImplicitTreapTest, Splice) {
+  constexpr int kOperationCount = 300;
+  std::mt19937_64 gen(/*seed=*/kOperationCount);
+  std::array<std::vector<int>, 2> check;
+  check[0].resize(500);
+  std::iota(check[0].begin(), check[0].end(), 0);
+  check[1].resize(300);
+  std::iota(check[1].begin(), check[1].end(), 1'000);
+  std::array<alpa::ImplicitTreap<int, std::hash<int>>, 2> test{
+      alpa::ImplicitTreap<int, std::hash<int>>(check[0], /*seed=*/1),
+      alpa::ImplicitTreap<int, std::hash<int>>(check[1], /*seed=*/2)};
+  for (int i = 0; i < kOperationCount; ++i) {
+    size_t dst = gen() % 2;
+    size_t src = gen() % 2;
+    auto at = [](std::vector<int>& values, size_t pos) {
+      return values.begin() + static_cast<std::ptrdiff_t>(pos);
+    };
+    size_t src_start = gen() % (check[src].size() + 1);
+    size_t src_end = src_start + gen() % (check[src].size() - src_start + 1);
+    size_t dst_pos = gen() % (check[dst].size() + 1);
+    if (src == dst) {
+      if (dst_pos > src_start && dst_pos < src_end) dst_pos = src_end;
+      std::vector<int>& values = check[src];
+      if (dst_pos < src_start) {
+        std::rotate(at(values, dst_pos), at(values, src_start),
+                    at(values, src_end));
+      } else if (dst_pos > src_end) {
+        std::rotate(at(values, src_start), at(values, src_end),
+                    at(values, dst_pos));
+      }
+    } else {
+      std::vector<int> moved(at(check[src], src_start),
+                             at(check[src], src_end));
+      check[src].erase(at(check[src], src_start), at(check[src], src_end));
+      check[dst].insert(at(check[dst], dst_pos), moved.begin(), moved.end());
+    }
+    test[dst].Splice(dst_pos, test[src], src_start, src_end);
+    for (size_t j = 0; j < 2; ++j) {
+      ASSERT_EQ(test[j].Size(), check[j].size());
+      ASSERT_TRUE(
+          std::equal(test[j].Begin(), test[j].End(), check[j].begin()));
+    }
+  }
+  for (size_t j = 0; j < 2; ++j) {
+    alpa::ImplicitTreap<int, std::hash<int>> fresh(check[j], /*seed=*/3);
+    EXPECT_EQ(test[j].RangeHash(0, check[j].size()),
+              fresh.RangeHash(0, check[j].size()));
+  }
+}
+
+TEST(ImplicitTreapTest, PartitionEvenlyAndConcatenateAll) {
+  constexpr size_t kInputSize = 1'003;
+  std::vector<int> input(kInputSize);
+  std::iota(input.begin(), input.end(), 0);
+  alpa::ImplicitTreap<int, std::hash<int>> test(input, /*seed=*/1);
+  uint64_t hash = test.RangeHash(0, kInputSize);
+  auto pieces = test.PartitionEvenly(10);
+  EXPECT_TRUE(test.Empty());
+  ASSERT_EQ(pieces.size(), 10);
+  for (size_t i = 0; i < pieces.size(); ++i) {
+    EXPECT_EQ(pieces[i].Size(), i < 3 ? 101 : 100);
+  }
+  EXPECT_EQ(*pieces[3].Begin(), 303);
+  alpa::ImplicitTreap<int, std::hash<int>> gathered;
+  gathered.PushBack(-1);
+  gathered.ConcatenateAll(std::move(pieces));
+  gathered.Erase(0);
+  ASSERT_EQ(gathered.Size(), kInputSize);
+  EXPECT_TRUE(std::equal(gathered.Begin(), gathered.End(), input.begin()));
+  EXPECT_EQ(gathered.RangeHash(0, kInputSize), hash);
+  // More pieces than elements gives empty pieces at the end
+  alpa::ImplicitTreap<int> small(std::vector<int>{1, 2}, /*seed=*/1);
+  auto small_pieces = small.PartitionEvenly(4);
+  EXPECT_EQ(small_pieces[1].Size(), 1);
+  EXPECT_TRUE(small_pieces[2].Empty());
+  small.ConcatenateAll(std::move(small_pieces));
+  EXPECT_THAT(std::vector<int>(small.Begin(), small.End()),
+              ElementsAre(1, 2));
+}
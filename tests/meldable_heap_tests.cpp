@@ -0,0 +1,152 @@
+﻿#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <numeric>
+#include <queue>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "algorithm_pack/meldable_heap.h"
+
+using ::testing::ElementsAreArray;
+
+namespace {
+/**
+ * @brief Pops all elements from the heap in order.
+ */
+template <typename T, typename Compare>
+std::vector<T> PopAll(alpa::MeldableHeap<T, Compare>& heap) {
+  std::vector<T> result;
+  while (!heap.Empty()) {
+    result.push_back(heap.Top());
+    heap.Pop();
+  }
+  return result;
+}
+}  // namespace
+
+TEST(MeldableHeapTest, CreateEmpty) {
+  alpa::MeldableHeap<int> test;
+  EXPECT_TRUE(test.Empty());
+  EXPECT_EQ(test.Size(), 0);
+}
+
+TEST(MeldableHeapTest, PushAndPop) {
+  constexpr int kInputSize = 1'000;
+  std::mt19937_64 gen(/*seed=*/kInputSize);
+  std::uniform_int_distribution<int> dist(-100, 100);
+  alpa::MeldableHeap<int> test(/*seed=*/kInputSize);
+  std::priority_queue<int, std::vector<int>, std::greater<>> check;
+  for (int i = 0; i < kInputSize; ++i) {
+    int val = dist(gen);
+    test.Push(val);
+    check.push(val);
+    ASSERT_EQ(test.Top(), check.top());
+    if (i % 3 == 0) {
+      test.Pop();
+      check.pop();
+    }
+    ASSERT_EQ(test.Size(), check.size());
+  }
+  while (!check.empty()) {
+    ASSERT_EQ(test.Top(), check.top());
+    test.Pop();
+    check.pop();
+  }
+  EXPECT_TRUE(test.Empty());
+}
+
+TEST(MeldableHeapTest, CustomComparator) {
+  const std::vector<std::string> input{"b", "d", "a", "c", "e"};
+  alpa::MeldableHeap<std::string, std::greater<>> test(/*seed=*/input.size());
+  for (const auto& val : input) test.Push(val);
+  EXPECT_THAT(PopAll(test), ElementsAreArray({"e", "d", "c", "b", "a"}));
+}
+
+TEST(MeldableHeapTest, MeldOverlappingHeaps) {
+  constexpr int kInputSize = 500;
+  std::mt19937_64 gen(/*seed=*/kInputSize);
+  std::uniform_int_distribution<int> dist(0, 50);
+  alpa::MeldableHeap<int> first(/*seed=*/1);
+  alpa::MeldableHeap<int> second(/*seed=*/2);
+  std::vector<int> check;
+  std::vector<alpa::MeldableHeap<int>::Handle> handles;
+  for (int i = 0; i < kInputSize; ++i) {
+    int val = dist(gen);
+    check.push_back(val);
+    handles.push_back(i % 2 == 0 ? first.Push(val) : second.Push(val));
+  }
+  first.Meld(std::move(second)).Meld(alpa::MeldableHeap<int>(/*seed=*/3));
+  EXPECT_EQ(first.Size(), check.size());
+  // Handles of the melded heap now refer to the result
+  for (size_t i = 0; i < handles.size(); i += 7) {
+    first.Erase(handles[i]);
+    check[i] = -1;
+  }
+  check.erase(std::remove(check.begin(), check.end(), -1), check.end());
+  std::sort(check.begin(), check.end());
+  EXPECT_THAT(PopAll(first), ElementsAreArray(check));
+}
+
+TEST(MeldableHeapTest, DecreaseKey) {
+  constexpr int kInputSize = 300;
+  std::vector<int> values(kInputSize);
+  std::iota(values.begin(), values.end(), kInputSize);
+  alpa::MeldableHeap<int> test(/*seed=*/kInputSize);
+  std::vector<alpa::MeldableHeap<int>::Handle> handles;
+  for (const auto& val : values) handles.push_back(test.Push(val));
+  std::mt19937_64 gen(/*seed=*/kInputSize);
+  for (int i = 0; i < kInputSize; ++i) {
+    size_t pos = std::uniform_int_distribution<size_t>(0, values.size() - 1)(
+        gen);
+    int decrease = std::uniform_int_distribution<int>(0, 50)(gen);
+    values[pos] -= decrease;
+    test.DecreaseKey(handles[pos], values[pos]);
+    EXPECT_EQ(*handles[pos], values[pos]);
+    EXPECT_EQ(test.Top(), *std::min_element(values.begin(), values.end()));
+  }
+  EXPECT_EQ(*test.TopHandle(), test.Top());
+  std::sort(values.begin(), values.end());
+  EXPECT_THAT(PopAll(test), ElementsAreArray(values));
+}
+
+TEST(MeldableHeapTest, FromRange) {
+  constexpr std::array<size_t, 6> kInputSizes{0, 1, 2, 7, 100, 1'000};
+  for (size_t input_size : kInputSizes) {
+    std::vector<int> input(input_size);
+    std::mt19937_64 gen(/*seed=*/input_size);
+    std::generate(input.begin(), input.end(), [&gen]() {
+      return std::uniform_int_distribution<int>(-1'000, 1'000)(gen);
+    });
+    alpa::MeldableHeap<int> test(input.begin(), input.end(),
+                                 /*seed=*/input_size);
+    EXPECT_EQ(test.Size(), input_size);
+    test.Push(0);
+    input.push_back(0);
+    std::sort(input.begin(), input.end());
+    EXPECT_THAT(PopAll(test), ElementsAreArray(input));
+  }
+}
+
+TEST(MeldableHeapTest, MoveAndClear) {
+  const std::vector<int> input{5, 3, 8, 1};
+  alpa::MeldableHeap<int> first(input.begin(), input.end(), /*seed=*/1);
+  alpa::MeldableHeap<int> second(std::move(first));
+  EXPECT_EQ(second.Top(), 1);
+  alpa::MeldableHeap<int> third(/*seed=*/2);
+  third.Push(10);
+  third = std::move(second);
+  EXPECT_EQ(third.Size(), input.size());
+  EXPECT_EQ(third.Top(), 1);
+  third.Clear();
+  EXPECT_TRUE(third.Empty());
+  third.Push(4);
+  EXPECT_EQ(third.Top(), 4);
+}
@@ -0,0 +1,100 @@
+﻿#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "algorithm_pack/implicit_treap.h"
+#include "algorithm_pack/node_arena.h"
+#include "algorithm_pack/treap.h"
+
+using ::testing::IsNull;
+using ::testing::NotNull;
+
+TEST(NodeArenaTest, ReusesFreedNodes) {
+  alpa::NodeArena<std::string> arena(alpa::NodeMemory::kHeap);
+  std::string* first = arena.New("first");
+  std::string* second = arena.New(size_t{3}, 'a');
+  EXPECT_EQ(*first, "first");
+  EXPECT_EQ(*second, "aaa");
+  arena.Delete(first);
+  std::string* third = arena.New("third");
+  EXPECT_EQ(third, first);
+  EXPECT_EQ(*third, "third");
+  arena.Delete(second);
+  arena.Delete(third);
+  alpa::ArenaStats stats = arena.Stats();
+  EXPECT_GE(stats.reserved_bytes, alpa::MemoryBlock::kHugePageSize);
+  EXPECT_EQ(stats.huge_page_bytes, 0);
+}
+
+TEST(NodeArenaTest, GrowsOverSeveralBlocks) {
+  constexpr size_t kNodeCount = 300'000;
+  alpa::NodeArena<uint64_t> arena(alpa::NodeMemory::kHugePages);
+  std::vector<uint64_t*> nodes;
+  for (size_t i = 0; i < kNodeCount; ++i) nodes.push_back(arena.New(i));
+  for (size_t i = 0; i < kNodeCount; ++i) ASSERT_EQ(*nodes[i], i);
+  alpa::ArenaStats stats = arena.Stats();
+  EXPECT_GE(stats.reserved_bytes, kNodeCount * sizeof(uint64_t));
+  EXPECT_LE(stats.huge_page_bytes, stats.reserved_bytes);
+  EXPECT_GE(stats.HugePageCoverage(), 0.0);
+  EXPECT_LE(stats.HugePageCoverage(), 1.0);
+  for (uint64_t* node : nodes) arena.Delete(node);
+}
+
+TEST(NodeArenaTest, TreapInHugePages) {
+  constexpr int kOperationCount = 20'000;
+  std::mt19937_64 gen(/*seed=*/kOperationCount);
+  std::uniform_int_distribution<int> key_dist(0, 5'000);
+  alpa::Treap<int, std::string> test(/*seed=*/1, alpa::NodeMemory::kHugePages);
+  std::map<int, std::string> check;
+  for (int i = 0; i < kOperationCount; ++i) {
+    int key = key_dist(gen);
+    if (i % 3 == 2) {
+      ASSERT_EQ(test.Erase(key), check.erase(key) == 1);
+    } else {
+      test.Insert(key, std::to_string(i));
+      check.emplace(key, std::to_string(i));
+    }
+  }
+  std::vector<std::pair<int, std::string>> batch{{-2, "a"}, {-1, "b"}};
+  test.InsertSorted(batch.begin(), batch.end());
+  check.insert(batch.begin(), batch.end());
+  ASSERT_EQ(test.Size(), check.size());
+  for (int key = -2; key <= 5'000; ++key) {
+    auto it = check.find(key);
+    if (it == check.end()) {
+      ASSERT_THAT(test.Find(key), IsNull());
+    } else {
+      ASSERT_THAT(test.Find(key), NotNull());
+      ASSERT_EQ(*test.Find(key), it->second);
+    }
+  }
+  EXPECT_GT(test.MemoryStats().reserved_bytes, 0);
+  alpa::Treap<int, int> heap_test;
+  EXPECT_EQ(heap_test.MemoryStats().reserved_bytes, 0);
+}
+
+TEST(NodeArenaTest, ImplicitTreapCompactIntoHugePages) {
+  constexpr int kInputSize = 100'000;
+  std::vector<int> expected(kInputSize);
+  std::iota(expected.begin(), expected.end(), 0);
+  alpa::ImplicitTreap<int, std::hash<int>> test(expected, /*seed=*/1);
+  EXPECT_EQ(test.MemoryStats().reserved_bytes, 0);
+  test.Compact(alpa::NodeMemory::kHugePages);
+  alpa::ArenaStats stats = test.MemoryStats();
+  EXPECT_GE(stats.reserved_bytes, alpa::MemoryBlock::kHugePageSize);
+  EXPECT_LE(stats.huge_page_bytes, stats.reserved_bytes);
+  test.Erase(0);
+  test.PushBack(kInputSize);
+  expected.erase(expected.begin());
+  expected.push_back(kInputSize);
+  EXPECT_TRUE(std::equal(test.Begin(), test.End(), expected.begin(),
+                         expected.end()));
+}
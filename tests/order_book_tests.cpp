@@ -0,0 +1,272 @@
+﻿#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <map>
+#include <optional>
+#include <random>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "algorithm_pack/order_book.h"
+
+using ::testing::ElementsAre;
+using ::testing::IsNull;
+using ::testing::NotNull;
+using ::testing::Optional;
+
+namespace {
+using Book = alpa::OrderBook<int>;
+using Fill = std::tuple<Book::OrderId, int, Book::Quantity>;
+
+/**
+ * @brief Straightforward order book based on lists, used as a reference.
+ */
+class NaiveBook {
+ public:
+  bool Add(Book::OrderId id, alpa::Side side, int price,
+           Book::Quantity quantity) {
+    if (quantity == 0 || orders_.count(id) != 0) return false;
+    orders_[id] = {side, price};
+    Queue(side, price).push_back({id, quantity});
+    return true;
+  }
+  bool Reduce(Book::OrderId id, Book::Quantity quantity) {
+    auto it = orders_.find(id);
+    if (it == orders_.end()) return false;
+    auto& queue = Queue(it->second.first, it->second.second);
+    auto order_it = FindInQueue(queue, id);
+    if (quantity >= order_it->quantity) {
+      Remove(id);
+    } else {
+      order_it->quantity -= quantity;
+    }
+    return true;
+  }
+  bool Delete(Book::OrderId id) {
+    if (orders_.count(id) == 0) return false;
+    Remove(id);
+    return true;
+  }
+  Book::Quantity Match(alpa::Side side, int limit, Book::Quantity quantity) {
+    Book::Quantity filled = 0;
+    while (quantity > 0) {
+      std::optional<int> best =
+          side == alpa::Side::kBuy ? BestAsk() : BestBid();
+      if (!best) break;
+      if (side == alpa::Side::kBuy ? *best > limit : *best < limit) break;
+      alpa::Side resting =
+          side == alpa::Side::kBuy ? alpa::Side::kSell : alpa::Side::kBuy;
+      auto& front = Queue(resting, *best).front();
+      Book::Quantity fill = std::min(front.quantity, quantity);
+      quantity -= fill;
+      filled += fill;
+      if (fill == front.quantity) {
+        Remove(front.id);
+      } else {
+        front.quantity -= fill;
+      }
+    }
+    return filled;
+  }
+  [[nodiscard]] std::optional<int> BestBid() const {
+    if (bids_.empty()) return std::nullopt;
+    return std::prev(bids_.end())->first;
+  }
+  [[nodiscard]] std::optional<int> BestAsk() const {
+    if (asks_.empty()) return std::nullopt;
+    return asks_.begin()->first;
+  }
+  [[nodiscard]] Book::Quantity Volume(alpa::Side side, int price) const {
+    const auto& levels = side == alpa::Side::kBuy ? bids_ : asks_;
+    auto it = levels.find(price);
+    if (it == levels.end()) return 0;
+    Book::Quantity volume = 0;
+    for (const auto& order : it->second) volume += order.quantity;
+    return volume;
+  }
+  [[nodiscard]] std::optional<size_t> QueuePosition(Book::OrderId id) {
+    auto it = orders_.find(id);
+    if (it == orders_.end()) return std::nullopt;
+    auto& queue = Queue(it->second.first, it->second.second);
+    return static_cast<size_t>(
+        std::distance(queue.begin(), FindInQueue(queue, id)));
+  }
+  [[nodiscard]] size_t Size() const { return orders_.size(); }
+
+ private:
+  std::list<Book::Order>& Queue(alpa::Side side, int price) {
+    return side == alpa::Side::kBuy ? bids_[price] : asks_[price];
+  }
+  static std::list<Book::Order>::iterator FindInQueue(
+      std::list<Book::Order>& queue, Book::OrderId id) {
+    return std::find_if(
+        queue.begin(), queue.end(),
+        [id](const Book::Order& order) { return order.id == id; });
+  }
+  void Remove(Book::OrderId id) {
+    auto it = orders_.find(id);
+    auto& levels = it->second.first == alpa::Side::kBuy ? bids_ : asks_;
+    auto& queue = levels[it->second.second];
+    queue.erase(FindInQueue(queue, id));
+    if (queue.empty()) levels.erase(it->second.second);
+    orders_.erase(it);
+  }
+
+  std::map<int, std::list<Book::Order>> bids_;
+  std::map<int, std::list<Book::Order>> asks_;
+  std::unordered_map<Book::OrderId, std::pair<alpa::Side, int>> orders_;
+};
+}  // namespace
+
+TEST(OrderBookTest, CreateEmpty) {
+  Book test(/*seed=*/1);
+  EXPECT_TRUE(test.Empty());
+  EXPECT_EQ(test.Size(), 0);
+  EXPECT_EQ(test.BestBid(), std::nullopt);
+  EXPECT_EQ(test.BestAsk(), std::nullopt);
+  EXPECT_EQ(test.QueuePosition(1), std::nullopt);
+  EXPECT_FALSE(test.Delete(1));
+  EXPECT_FALSE(test.Reduce(1, 10));
+  EXPECT_EQ(test.Match(alpa::Side::kBuy, 100, 10), 0);
+}
+
+TEST(OrderBookTest, BestPricesAndVolumes) {
+  Book test(/*seed=*/2);
+  EXPECT_TRUE(test.Add(1, alpa::Side::kBuy, 99, 10));
+  EXPECT_TRUE(test.Add(2, alpa::Side::kBuy, 100, 5));
+  EXPECT_TRUE(test.Add(3, alpa::Side::kBuy, 98, 7));
+  EXPECT_TRUE(test.Add(4, alpa::Side::kSell, 102, 3));
+  EXPECT_TRUE(test.Add(5, alpa::Side::kSell, 101, 4));
+  EXPECT_TRUE(test.Add(6, alpa::Side::kSell, 101, 6));
+  EXPECT_FALSE(test.Add(6, alpa::Side::kSell, 105, 1));
+  EXPECT_FALSE(test.Add(7, alpa::Side::kSell, 105, 0));
+  EXPECT_EQ(test.Size(), 6);
+  EXPECT_THAT(test.BestBid(), Optional(100));
+  EXPECT_THAT(test.BestAsk(), Optional(101));
+  EXPECT_EQ(test.Volume(alpa::Side::kSell, 101), 10);
+  EXPECT_EQ(test.OrderCount(alpa::Side::kSell, 101), 2);
+  EXPECT_EQ(test.Volume(alpa::Side::kBuy, 101), 0);
+  EXPECT_EQ(test.LevelCount(alpa::Side::kBuy), 3);
+  EXPECT_EQ(test.LevelCount(alpa::Side::kSell), 2);
+  EXPECT_TRUE(test.Delete(2));
+  EXPECT_THAT(test.BestBid(), Optional(99));
+  EXPECT_TRUE(test.Reduce(5, 4));
+  EXPECT_TRUE(test.Reduce(6, 2));
+  EXPECT_THAT(test.BestAsk(), Optional(101));
+  EXPECT_EQ(test.Volume(alpa::Side::kSell, 101), 4);
+  EXPECT_TRUE(test.Delete(6));
+  EXPECT_THAT(test.BestAsk(), Optional(102));
+  const Book::Order* order = test.FindOrder(4);
+  ASSERT_THAT(order, NotNull());
+  EXPECT_EQ(order->quantity, 3);
+  EXPECT_THAT(test.FindOrder(6), IsNull());
+}
+
+TEST(OrderBookTest, TimePriorityAndQueuePosition) {
+  Book test(/*seed=*/3);
+  for (Book::OrderId id = 1; id <= 5; ++id) {
+    test.Add(id, alpa::Side::kSell, 50, id * 10);
+  }
+  EXPECT_THAT(test.QueuePosition(4), Optional(3));
+  EXPECT_TRUE(test.Delete(2));
+  EXPECT_THAT(test.QueuePosition(4), Optional(2));
+  // Partial reduction keeps the priority, replacement loses it
+  EXPECT_TRUE(test.Reduce(3, 5));
+  EXPECT_THAT(test.QueuePosition(3), Optional(1));
+  EXPECT_TRUE(test.Replace(3, 7, 50, 30));
+  EXPECT_EQ(test.QueuePosition(3), std::nullopt);
+  EXPECT_THAT(test.QueuePosition(7), Optional(3));
+  EXPECT_FALSE(test.Replace(7, 1, 50, 10));
+  EXPECT_THAT(test.QueuePosition(7), Optional(3));
+  std::vector<Fill> fills;
+  auto filled = test.Match(alpa::Side::kBuy, 50, 65,
+                           [&fills](Book::OrderId id, int price,
+                                    Book::Quantity quantity) {
+                             fills.emplace_back(id, price, quantity);
+                           });
+  EXPECT_EQ(filled, 65);
+  EXPECT_THAT(fills, ElementsAre(Fill{1, 50, 10}, Fill{4, 50, 40},
+                                 Fill{5, 50, 15}));
+  EXPECT_THAT(test.QueuePosition(5), Optional(0));
+  EXPECT_EQ(test.Volume(alpa::Side::kSell, 50), 65);
+}
+
+TEST(OrderBookTest, MatchRespectsLimit) {
+  Book test(/*seed=*/4);
+  test.Add(1, alpa::Side::kBuy, 10, 5);
+  test.Add(2, alpa::Side::kBuy, 9, 5);
+  test.Add(3, alpa::Side::kBuy, 8, 5);
+  std::vector<Fill> fills;
+  auto on_fill = [&fills](Book::OrderId id, int price,
+                          Book::Quantity quantity) {
+    fills.emplace_back(id, price, quantity);
+  };
+  EXPECT_EQ(test.Match(alpa::Side::kSell, 9, 100, on_fill), 10);
+  EXPECT_THAT(fills, ElementsAre(Fill{1, 10, 5}, Fill{2, 9, 5}));
+  EXPECT_THAT(test.BestBid(), Optional(8));
+  EXPECT_EQ(test.Match(alpa::Side::kSell, 9, 100), 0);
+  EXPECT_EQ(test.Size(), 1);
+}
+
+TEST(OrderBookTest, RandomMessagesAgainstNaive) {
+  constexpr int kMessageCount = 20'000;
+  constexpr int kMidPrice = 1'000;
+  std::mt19937_64 gen(/*seed=*/5);
+  std::uniform_int_distribution<int> message_dist(0, 9);
+  std::uniform_int_distribution<int> offset_dist(0, 20);
+  std::uniform_int_distribution<Book::Quantity> quantity_dist(1, 100);
+  Book test(/*seed=*/5);
+  NaiveBook naive;
+  std::vector<Book::OrderId> ids;
+  Book::OrderId next_id = 1;
+  for (int i = 0; i < kMessageCount; ++i) {
+    int message = message_dist(gen);
+    Book::Quantity quantity = quantity_dist(gen);
+    if (message < 5 || ids.empty()) {
+      auto side = message % 2 == 0 ? alpa::Side::kBuy : alpa::Side::kSell;
+      // Buy orders are placed below and sell orders above the mid price
+      int price = side == alpa::Side::kBuy ? kMidPrice - offset_dist(gen)
+                                           : kMidPrice + 1 + offset_dist(gen);
+      ASSERT_EQ(test.Add(next_id, side, price, quantity),
+                naive.Add(next_id, side, price, quantity));
+      ids.push_back(next_id++);
+    } else if (message == 9) {
+      auto side = quantity % 2 == 0 ? alpa::Side::kBuy : alpa::Side::kSell;
+      int limit = kMidPrice + offset_dist(gen) - 10;
+      ASSERT_EQ(test.Match(side, limit, quantity),
+                naive.Match(side, limit, quantity));
+    } else {
+      size_t pos =
+          std::uniform_int_distribution<size_t>(0, ids.size() - 1)(gen);
+      Book::OrderId id = ids[pos];
+      if (message < 8) {
+        ASSERT_EQ(test.Reduce(id, quantity), naive.Reduce(id, quantity));
+      } else {
+        ASSERT_EQ(test.Delete(id), naive.Delete(id));
+        ids[pos] = ids.back();
+        ids.pop_back();
+      }
+      ASSERT_EQ(test.QueuePosition(id), naive.QueuePosition(id));
+    }
+    ASSERT_EQ(test.Size(), naive.Size());
+    ASSERT_EQ(test.BestBid(), naive.BestBid());
+    ASSERT_EQ(test.BestAsk(), naive.BestAsk());
+    if (auto bid = naive.BestBid()) {
+      ASSERT_EQ(test.Volume(alpa::Side::kBuy, *bid),
+                naive.Volume(alpa::Side::kBuy, *bid));
+    }
+    if (auto ask = naive.BestAsk()) {
+      ASSERT_EQ(test.Volume(alpa::Side::kSell, *ask),
+                naive.Volume(alpa::Side::kSell, *ask));
+    }
+  }
+  for (auto id : ids) {
+    ASSERT_EQ(test.QueuePosition(id), naive.QueuePosition(id));
+  }
+}
@@ -0,0 +1,59 @@
+﻿#include <gtest/gtest.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <set>
+
+#include "algorithm_pack/implicit_treap.h"
+#include "algorithm_pack/random.h"
+#include "algorithm_pack/treap.h"
+
+TEST(SplitMix64Test, SeedRepeatsSequence) {
+  alpa::SplitMix64 first(/*seed=*/42);
+  alpa::SplitMix64 second(/*seed=*/7);
+  second.Seed(42);
+  for (int i = 0; i < 100; ++i) ASSERT_EQ(first(), second());
+  // Reference values of SplitMix64 for the zero seed
+  alpa::SplitMix64 zero(/*seed=*/0);
+  EXPECT_EQ(zero(), 0xe220a8397b1dcdafU);
+  EXPECT_EQ(zero(), 0x6e789e6aa1b965f4U);
+}
+
+TEST(SplitMix64Test, DiscardSkipsValues) {
+  alpa::SplitMix64 first(/*seed=*/42);
+  alpa::SplitMix64 second(/*seed=*/42);
+  for (int i = 0; i < 1'000; ++i) first();
+  second.Discard(1'000);
+  for (int i = 0; i < 100; ++i) ASSERT_EQ(first(), second());
+  second.Discard(0);
+  EXPECT_EQ(first(), second());
+}
+
+TEST(SplitMix64Test, DefaultSeedsDiffer) {
+  std::set<uint64_t> first_values;
+  for (int i = 0; i < 1'000; ++i) {
+    alpa::SplitMix64 rnd;
+    first_values.insert(rnd());
+  }
+  EXPECT_EQ(first_values.size(), 1'000);
+}
+
+TEST(SplitMix64Test, WorksWithDistributions) {
+  constexpr int kSampleCount = 100'000;
+  alpa::SplitMix64 rnd(/*seed=*/kSampleCount);
+  std::uniform_int_distribution<size_t> dist(0, 9);
+  std::array<int, 10> counts{};
+  for (int i = 0; i < kSampleCount; ++i) ++counts[dist(rnd)];
+  for (int count : counts) {
+    EXPECT_GT(count, kSampleCount / 10 * 9 / 10);
+    EXPECT_LT(count, kSampleCount / 10 * 11 / 10);
+  }
+}
+
+TEST(SplitMix64Test, ContainersStaySmall) {
+  // Empty containers are cheap to keep in large numbers
+  EXPECT_LE(sizeof(alpa::Treap<int, int>), 4 * sizeof(void*));
+  EXPECT_LE(sizeof(alpa::ImplicitTreap<int>), 4 * sizeof(void*));
+}
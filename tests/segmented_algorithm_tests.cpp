@@ -0,0 +1,80 @@
+﻿#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <iterator>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "algorithm_pack/implicit_treap.h"
+#include "algorithm_pack/segmented_algorithm.h"
+
+using ::testing::ElementsAreArray;
+
+static_assert(
+    alpa::kIsSegmentedIterator<alpa::ImplicitTreap<int>::Iterator> &&
+        alpa::kIsSegmentedIterator<alpa::ImplicitTreap<int>::ConstIterator>,
+    "ImplicitTreap iterators are expected to be segmented");
+static_assert(!alpa::kIsSegmentedIterator<std::vector<int>::iterator>,
+              "Vector iterators are not segmented");
+
+TEST(SegmentedAlgorithmTest, ForEachAndAccumulate) {
+  constexpr int kInputSize = 1'000;
+  std::vector<int> input(kInputSize);
+  std::iota(input.begin(), input.end(), 0);
+  alpa::ImplicitTreap<int> test(input, /*seed=*/kInputSize);
+  for (int from : {0, 1, 17, 500, kInputSize - 1, kInputSize}) {
+    for (int to : {from, from + 1, from + 3, kInputSize}) {
+      if (to > kInputSize) continue;
+      std::vector<int> visited;
+      alpa::ForEach(test.CBegin() + from, test.CBegin() + to,
+                    [&visited](int val) { visited.push_back(val); });
+      EXPECT_THAT(visited,
+                  ElementsAreArray(input.begin() + from, input.begin() + to));
+      EXPECT_EQ(alpa::Accumulate(test.Begin() + from, test.Begin() + to, 0),
+                std::accumulate(input.begin() + from, input.begin() + to, 0));
+    }
+  }
+  alpa::ForEach(test.Begin(), test.End(), [](int& val) { val *= 2; });
+  EXPECT_EQ(alpa::Accumulate(test.CBegin(), test.CEnd(), 0),
+            std::accumulate(input.begin(), input.end(), 0) * 2);
+}
+
+TEST(SegmentedAlgorithmTest, Find) {
+  const std::vector<std::string> input{"a", "b", "c", "d", "b", "e"};
+  alpa::ImplicitTreap<std::string> test(input, /*seed=*/input.size());
+  auto it = alpa::Find(test.Begin(), test.End(), "b");
+  ASSERT_NE(it, test.End());
+  EXPECT_EQ(it - test.Begin(), 1);
+  it = alpa::Find(std::next(it), test.End(), "b");
+  ASSERT_NE(it, test.End());
+  EXPECT_EQ(it - test.Begin(), 4);
+  EXPECT_EQ(alpa::Find(test.Begin(), test.End(), "z"), test.End());
+  EXPECT_EQ(alpa::Find(test.CBegin(), test.CBegin() + 3, "d"),
+            test.CBegin() + 3);
+  auto cit = alpa::FindIf(test.CBegin(), test.CEnd(),
+                          [](const std::string& val) { return val > "c"; });
+  EXPECT_EQ(*cit, "d");
+  // Fallback to the standard algorithm
+  EXPECT_EQ(alpa::Find(input.begin(), input.end(), "c"), input.begin() + 2);
+}
+
+TEST(SegmentedAlgorithmTest, FillAndCopy) {
+  constexpr int kInputSize = 200;
+  constexpr int kFillValue = -1;
+  std::vector<int> input(kInputSize);
+  std::iota(input.begin(), input.end(), 0);
+  alpa::ImplicitTreap<int> test(input, /*seed=*/kInputSize);
+  alpa::Fill(test.Begin() + 50, test.Begin() + 150, kFillValue);
+  std::fill(input.begin() + 50, input.begin() + 150, kFillValue);
+  std::vector<int> copied;
+  alpa::Copy(test.CBegin(), test.CEnd(), std::back_inserter(copied));
+  EXPECT_THAT(copied, ElementsAreArray(input));
+  std::vector<int> buffer(kInputSize);
+  auto buffer_end =
+      alpa::Copy(test.Begin() + 10, test.Begin() + 20, buffer.begin());
+  EXPECT_EQ(buffer_end, buffer.begin() + 10);
+  EXPECT_THAT(std::vector<int>(buffer.begin(), buffer_end),
+              ElementsAreArray(input.begin() + 10, input.begin() + 20));
+}
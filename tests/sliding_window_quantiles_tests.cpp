@@ -0,0 +1,90 @@
+﻿#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <vector>
+
+#include "algorithm_pack/sliding_window_quantiles.h"
+
+namespace {
+/**
+ * @brief Checks all order statistics of the window against the sorted copy of
+ * the reference window.
+ */
+void ExpectSameWindow(const alpa::SlidingWindowQuantiles<int>& test,
+                      const std::deque<int>& check) {
+  std::vector<int> sorted(check.begin(), check.end());
+  std::sort(sorted.begin(), sorted.end());
+  ASSERT_EQ(test.Size(), sorted.size());
+  for (size_t rank = 0; rank < sorted.size(); ++rank) {
+    ASSERT_EQ(test.Select(rank), sorted[rank]);
+  }
+}
+}  // namespace
+
+TEST(SlidingWindowQuantilesTest, PushAgainstSortedWindow) {
+  constexpr size_t kWindowSize = 100;
+  constexpr int kOperationCount = 5'000;
+  std::mt19937_64 gen(/*seed=*/kWindowSize);
+  // Narrow range gives many equal samples
+  std::uniform_int_distribution<int> value_dist(-30, 30);
+  alpa::SlidingWindowQuantiles<int> test(kWindowSize, /*seed=*/1);
+  std::deque<int> check;
+  EXPECT_TRUE(test.Empty());
+  for (int i = 0; i < kOperationCount; ++i) {
+    int value = value_dist(gen);
+    test.Push(value);
+    check.push_back(value);
+    if (check.size() > kWindowSize) check.pop_front();
+    if (i % 97 == 0) ExpectSameWindow(test, check);
+    int probe = value_dist(gen);
+    ASSERT_EQ(test.CountLess(probe),
+              static_cast<size_t>(std::count_if(
+                  check.begin(), check.end(),
+                  [probe](int sample) { return sample < probe; })));
+  }
+  ExpectSameWindow(test, check);
+  EXPECT_EQ(test.WindowSize(), kWindowSize);
+}
+
+TEST(SlidingWindowQuantilesTest, Quantiles) {
+  alpa::SlidingWindowQuantiles<int> test(/*window_size=*/1'000, /*seed=*/1);
+  for (int i = 0; i < 1'500; ++i) test.Push(i);
+  // Window holds 500..1499
+  EXPECT_EQ(test.Quantile(0.0), 500);
+  EXPECT_EQ(test.Quantile(0.5), 999);
+  EXPECT_EQ(test.Quantile(0.99), 1'489);
+  EXPECT_EQ(test.Quantile(1.0), 1'499);
+  test.Clear();
+  EXPECT_TRUE(test.Empty());
+  test.Push(7);
+  EXPECT_EQ(test.Quantile(0.99), 7);
+}
+
+TEST(SlidingWindowQuantilesTest, BatchAdvance) {
+  constexpr size_t kWindowSize = 64;
+  std::mt19937_64 gen(/*seed=*/kWindowSize);
+  std::uniform_int_distribution<int> value_dist(0, 100);
+  std::uniform_int_distribution<size_t> batch_dist(0, 3 * kWindowSize);
+  alpa::SlidingWindowQuantiles<int> test(kWindowSize, /*seed=*/1);
+  std::deque<int> check;
+  for (int i = 0; i < 200; ++i) {
+    std::vector<int> batch(batch_dist(gen));
+    for (int& value : batch) value = value_dist(gen);
+    test.Advance(batch.begin(), batch.end());
+    for (int value : batch) {
+      check.push_back(value);
+      if (check.size() > kWindowSize) check.pop_front();
+    }
+    ExpectSameWindow(test, check);
+    // Single pushes keep evicting in the order of arrival after a rebuild
+    int value = value_dist(gen);
+    test.Push(value);
+    check.push_back(value);
+    if (check.size() > kWindowSize) check.pop_front();
+    ExpectSameWindow(test, check);
+  }
+}
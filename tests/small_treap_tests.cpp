@@ -0,0 +1,127 @@
+﻿#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "algorithm_pack/small_treap.h"
+
+using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
+using ::testing::IsNull;
+using ::testing::NotNull;
+
+namespace {
+/**
+ * @brief Collects content of the container in the visiting order.
+ */
+template <typename Container>
+auto Content(Container& container) {
+  std::vector<std::pair<int, int>> result;
+  container.ForEach([&](const int& key, int& value) {
+    result.emplace_back(key, value);
+  });
+  return result;
+}
+}  // namespace
+
+TEST(SmallTreapTest, InlineOperations) {
+  alpa::SmallTreap<int, int, 4> test;
+  EXPECT_TRUE(test.Empty());
+  EXPECT_TRUE(test.IsInline());
+  EXPECT_EQ(*test.Insert(3, 30), 30);
+  EXPECT_EQ(*test.Insert(1, 10), 10);
+  EXPECT_EQ(*test.Insert(2, 20), 20);
+  // Existing key keeps its value
+  EXPECT_EQ(*test.Insert(1, 11), 10);
+  EXPECT_EQ(test.Size(), 3);
+  EXPECT_TRUE(test.IsInline());
+  ASSERT_THAT(test.Find(2), NotNull());
+  *test.Find(2) = 21;
+  EXPECT_THAT(test.Find(4), IsNull());
+  EXPECT_THAT(test.Find(0), IsNull());
+  EXPECT_THAT(Content(test), ElementsAre(std::pair(1, 10), std::pair(2, 21),
+                                         std::pair(3, 30)));
+  EXPECT_TRUE(test.Erase(1));
+  EXPECT_FALSE(test.Erase(1));
+  EXPECT_THAT(Content(test), ElementsAre(std::pair(2, 21), std::pair(3, 30)));
+  test.Clear();
+  EXPECT_TRUE(test.Empty());
+}
+
+TEST(SmallTreapTest, SwitchesRepresentation) {
+  alpa::SmallTreap<int, int, 8> test;
+  for (int i = 0; i < 8; ++i) test.Insert(i * 2, i);
+  EXPECT_TRUE(test.IsInline());
+  // Insertion into the full array switches to the tree
+  EXPECT_EQ(*test.Insert(5, 100), 100);
+  EXPECT_FALSE(test.IsInline());
+  EXPECT_EQ(test.Size(), 9);
+  EXPECT_EQ(*test.Find(5), 100);
+  EXPECT_EQ(*test.Find(14), 7);
+  // Erasure switches back only at half of the inline capacity
+  for (int key : {0, 2, 4, 5}) EXPECT_TRUE(test.Erase(key));
+  EXPECT_FALSE(test.IsInline());
+  EXPECT_TRUE(test.Erase(6));
+  EXPECT_TRUE(test.IsInline());
+  EXPECT_THAT(Content(test), ElementsAre(std::pair(8, 4), std::pair(10, 5),
+                                         std::pair(12, 6), std::pair(14, 7)));
+  test.Insert(1, 1);
+  EXPECT_EQ(*test.Find(1), 1);
+  test.Clear();
+  EXPECT_TRUE(test.IsInline());
+}
+
+TEST(SmallTreapTest, RandomOperations) {
+  alpa::SmallTreap<int, int> test;
+  std::map<int, int> expected;
+  std::mt19937 rnd(/*seed=*/5);
+  for (int i = 0; i < 20'000; ++i) {
+    // Key range keeps the size around the inline capacity
+    int key = static_cast<int>(rnd() % 40);
+    switch (rnd() % 3) {
+      case 0:
+        ASSERT_EQ(*test.Insert(key, i), expected.emplace(key, i).first->second);
+        break;
+      case 1:
+        ASSERT_EQ(test.Erase(key), expected.erase(key) == 1);
+        break;
+      default: {
+        auto it = expected.find(key);
+        int* value = test.Find(key);
+        ASSERT_EQ(value != nullptr, it != expected.end());
+        if (value) {
+          ASSERT_EQ(*value, it->second);
+        }
+      }
+    }
+    ASSERT_EQ(test.Size(), expected.size());
+  }
+  EXPECT_THAT(Content(test),
+              ElementsAreArray(expected.begin(), expected.end()));
+}
+
+TEST(SmallTreapTest, NonTrivialElements) {
+  alpa::SmallTreap<std::string, std::vector<int>, 2> test;
+  test.Insert("b", {2});
+  test.Insert("a", {1});
+  test.Insert("c", {3, 3});
+  EXPECT_FALSE(test.IsInline());
+  EXPECT_THAT(*test.Find("c"), ElementsAre(3, 3));
+  // String copy may throw, so elements stay in the tree
+  test.Erase("a");
+  test.Erase("c");
+  EXPECT_FALSE(test.IsInline());
+  EXPECT_THAT(*test.Find("b"), ElementsAre(2));
+  EXPECT_THAT(test.Find("a"), IsNull());
+}
+
+TEST(SmallTreapTest, EmptyContainerIsSmall) {
+  // Empty container takes no more than the inline array and two words
+  EXPECT_LE((sizeof(alpa::SmallTreap<int, int, 16>)),
+            16 * sizeof(std::pair<int, int>) + 2 * sizeof(void*));
+}
@@ -5,11 +5,16 @@
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <map>
+#include <random>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "algorithm_pack/treap.h"
 
+using ::testing::ElementsAreArray;
 using ::testing::IsEmpty;
 using ::testing::IsNull;
 using ::testing::Not;
@@ -175,3 +180,332 @@ TEST(TreapTest, EraseNotExisting) {
     }
   } while (std::next_permutation(input.begin(), input.end()));
 }
+
+TEST(TreapTest, MinAndMax) {
+  alpa::Treap<int, std::string> test(/*seed=*/1);
+  EXPECT_THAT(test.Min(), IsNull());
+  EXPECT_THAT(test.Max(), IsNull());
+  constexpr std::array<int, 7> kInput{4, 2, 9, -3, 7, 0, 5};
+  int min = kInput.front();
+  int max = kInput.front();
+  for (const auto& key : kInput) {
+    test.Insert(key, std::to_string(key));
+    min = std::min(min, key);
+    max = std::max(max, key);
+    ASSERT_THAT(test.Min(), NotNull());
+    ASSERT_THAT(test.Max(), NotNull());
+    EXPECT_EQ(test.Min()->first, min);
+    EXPECT_EQ(test.Min()->second, std::to_string(min));
+    EXPECT_EQ(test.Max()->first, max);
+  }
+  test.Erase(-3);
+  EXPECT_EQ(test.Min()->first, 0);
+  test.Max()->second = "max";
+  const auto& c_test = test;
+  const std::string* res = c_test.Find(9);
+  ASSERT_THAT(res, NotNull());
+  EXPECT_EQ(*res, "max");
+  EXPECT_THAT(c_test.Find(100), IsNull());
+}
+
+TEST(TreapTest, FindRandomKeys) {
+  constexpr int kInputSize = 5'000;
+  std::mt19937_64 gen(/*seed=*/kInputSize);
+  std::uniform_int_distribution<int64_t> dist(-kInputSize, kInputSize);
+  alpa::Treap<int64_t, int> int_test(/*seed=*/kInputSize);
+  alpa::Treap<std::string, int> string_test(/*seed=*/kInputSize);
+  std::map<int64_t, int> check;
+  for (int i = 0; i < kInputSize; ++i) {
+    int64_t key = dist(gen);
+    int_test.Insert(key, i);
+    string_test.Insert(std::to_string(key), i);
+    check.emplace(key, i);
+  }
+  for (int64_t key = -kInputSize - 1; key <= kInputSize + 1; ++key) {
+    auto it = check.find(key);
+    int* int_res = int_test.Find(key);
+    int* string_res = string_test.Find(std::to_string(key));
+    if (it == check.end()) {
+      EXPECT_THAT(int_res, IsNull());
+      EXPECT_THAT(string_res, IsNull());
+    } else {
+      ASSERT_THAT(int_res, NotNull());
+      ASSERT_THAT(string_res, NotNull());
+      EXPECT_EQ(*int_res, it->second);
+      EXPECT_EQ(*string_res, it->second);
+    }
+  }
+}
+
+namespace {
+using HashedTreap = alpa::Treap<int, int, alpa::StdHash>;
+using DiffEntry = std::pair<int, alpa::DiffKind>;
+
+/**
+ * @brief Builds two hashed treaps from the same random content, then applies
+ * random modifications to the second one and returns expected differences.
+ */
+std::vector<DiffEntry> FillReplicas(HashedTreap& first, HashedTreap& second,
+                                    int size, int modification_count) {
+  std::mt19937_64 gen(/*seed=*/static_cast<uint64_t>(size));
+  std::uniform_int_distribution<int> key_dist(0, size * 2);
+  std::map<int, int> first_check;
+  for (int i = 0; i < size; ++i) first_check.emplace(key_dist(gen), i);
+  for (const auto& [key, value] : first_check) first.Insert(key, value);
+  // The second replica is filled in the reverse order
+  for (auto it = first_check.rbegin(); it != first_check.rend(); ++it) {
+    second.Insert(it->first, it->second);
+  }
+  std::map<int, int> second_check = first_check;
+  for (int i = 0; i < modification_count; ++i) {
+    int key = key_dist(gen);
+    if (second_check.count(key) == 0) {
+      second_check.emplace(key, -i);
+      second.Insert(key, -i);
+    } else if (i % 2 == 0) {
+      second_check.erase(key);
+      second.Erase(key);
+    } else {
+      second_check[key] = -i;
+      second.Erase(key);
+      second.Insert(key, -i);
+    }
+  }
+  std::vector<DiffEntry> expected;
+  for (int key = 0; key <= size * 2; ++key) {
+    auto first_it = first_check.find(key);
+    auto second_it = second_check.find(key);
+    bool in_first = first_it != first_check.end();
+    bool in_second = second_it != second_check.end();
+    if (in_first && !in_second) {
+      expected.emplace_back(key, alpa::DiffKind::kOnlyInFirst);
+    } else if (!in_first && in_second) {
+      expected.emplace_back(key, alpa::DiffKind::kOnlyInSecond);
+    } else if (in_first && first_it->second != second_it->second) {
+      expected.emplace_back(key, alpa::DiffKind::kValueDiffers);
+    }
+  }
+  return expected;
+}
+}  // namespace
+
+TEST(TreapTest, DigestDependsOnlyOnContent) {
+  constexpr int kInputSize = 1'000;
+  HashedTreap first;
+  HashedTreap second;
+  EXPECT_EQ(first.Digest(), 0);
+  for (int i = 0; i < kInputSize; ++i) {
+    first.Insert(i, i * 2);
+    second.Insert(kInputSize - 1 - i, (kInputSize - 1 - i) * 2);
+  }
+  EXPECT_EQ(first.Digest(), second.Digest());
+  ASSERT_TRUE(second.Erase(kInputSize / 2));
+  EXPECT_NE(first.Digest(), second.Digest());
+  second.Insert(kInputSize / 2, 0);
+  EXPECT_NE(first.Digest(), second.Digest());
+  ASSERT_TRUE(second.Erase(kInputSize / 2));
+  second.Insert(kInputSize / 2, kInputSize);
+  EXPECT_EQ(first.Digest(), second.Digest());
+  alpa::Treap<std::string, std::string, alpa::StdHash> string_first;
+  alpa::Treap<std::string, std::string, alpa::StdHash> string_second;
+  string_first.Insert("a", "1");
+  string_first.Insert("b", "2");
+  string_second.Insert("b", "2");
+  string_second.Insert("a", "1");
+  EXPECT_EQ(string_first.Digest(), string_second.Digest());
+}
+
+TEST(TreapTest, DiffRandomReplicas) {
+  constexpr int kInputSize = 5'000;
+  constexpr int kModificationCount = 50;
+  HashedTreap first;
+  HashedTreap second;
+  std::vector<DiffEntry> expected =
+      FillReplicas(first, second, kInputSize, kModificationCount);
+  std::vector<DiffEntry> found;
+  HashedTreap::Diff(first, second, [&found](int key, alpa::DiffKind kind) {
+    found.emplace_back(key, kind);
+  });
+  EXPECT_THAT(found, ElementsAreArray(expected));
+  found.clear();
+  HashedTreap::Diff(first, first, [&found](int key, alpa::DiffKind kind) {
+    found.emplace_back(key, kind);
+  });
+  EXPECT_THAT(found, IsEmpty());
+}
+
+TEST(TreapTest, DiffWithRemoteReplica) {
+  constexpr int kInputSize = 5'000;
+  constexpr int kModificationCount = 20;
+  HashedTreap local;
+  HashedTreap remote;
+  std::vector<DiffEntry> expected =
+      FillReplicas(local, remote, kInputSize, kModificationCount);
+  size_t round_count = 0;
+  size_t query_count = 0;
+  auto remote_call = [&](const std::vector<HashedTreap::RangeQuery>& queries) {
+    ++round_count;
+    query_count += queries.size();
+    return remote.Summarize(queries);
+  };
+  std::vector<DiffEntry> found;
+  local.DiffWithRemote(remote_call, [&found](int key, alpa::DiffKind kind) {
+    found.emplace_back(key, kind);
+  });
+  std::sort(found.begin(), found.end());
+  EXPECT_THAT(found, ElementsAreArray(expected));
+  // Only paths to the differences are explored
+  EXPECT_LT(query_count, kInputSize / 4);
+  EXPECT_LT(round_count, 100);
+  round_count = 0;
+  local.DiffWithRemote(
+      [&local, &round_count](
+          const std::vector<HashedTreap::RangeQuery>& queries) {
+        ++round_count;
+        return local.Summarize(queries);
+      },
+      [](int, alpa::DiffKind) { FAIL(); });
+  EXPECT_EQ(round_count, 1);
+}
+
+TEST(TreapTest, InsertAndEraseSorted) {
+  constexpr int kInputSize = 3'000;
+  std::mt19937_64 gen(/*seed=*/kInputSize);
+  std::uniform_int_distribution<int> key_dist(0, kInputSize);
+  alpa::Treap<int, int> test(/*seed=*/kInputSize);
+  std::map<int, int> check;
+  for (int round = 0; round < 20; ++round) {
+    std::map<int, int> batch;
+    for (int i = 0; i < round * 20; ++i) batch.emplace(key_dist(gen), round);
+    test.InsertSorted(batch.begin(), batch.end());
+    check.insert(batch.begin(), batch.end());
+    std::vector<int> erased;
+    for (int key = key_dist(gen) % 50; key < kInputSize; key += 50) {
+      erased.push_back(key);
+    }
+    EXPECT_EQ(test.EraseSorted(erased.begin(), erased.end()),
+              std::count_if(erased.begin(), erased.end(),
+                            [&check](int key) { return check.erase(key); }));
+    ASSERT_EQ(test.Size(), check.size());
+  }
+  for (int key = 0; key <= kInputSize; ++key) {
+    auto it = check.find(key);
+    if (it == check.end()) {
+      ASSERT_THAT(test.Find(key), IsNull());
+    } else {
+      ASSERT_THAT(test.Find(key), NotNull());
+      ASSERT_EQ(*test.Find(key), it->second);
+    }
+  }
+}
+
+TEST(TreapTest, InsertSortedKeepsDigest) {
+  constexpr int kInputSize = 1'000;
+  HashedTreap first;
+  HashedTreap second;
+  std::vector<std::pair<int, int>> batch;
+  for (int i = 0; i < kInputSize; ++i) {
+    if (i % 3 == 0) {
+      first.Insert(i, i);
+    } else {
+      batch.emplace_back(i, i);
+    }
+    second.Insert(i, i);
+  }
+  // Existing keys keep their values
+  batch.emplace(batch.begin(), 0, -1);
+  first.InsertSorted(batch.begin(), batch.end());
+  EXPECT_EQ(first.Size(), kInputSize);
+  EXPECT_EQ(first.Digest(), second.Digest());
+  std::vector<int> erased{1, 2, 500, kInputSize};
+  EXPECT_EQ(first.EraseSorted(erased.begin(), erased.end()), 3);
+  for (int key : erased) second.Erase(key);
+  EXPECT_EQ(first.Digest(), second.Digest());
+}
+
+TEST(TreapTest, EraseRange) {
+  constexpr int kInputSize = 2'000;
+  std::mt19937_64 gen(/*seed=*/kInputSize);
+  std::uniform_int_distribution<int> key_dist(0, kInputSize);
+  alpa::Treap<int, int> test(/*seed=*/kInputSize);
+  std::map<int, int> check;
+  for (int i = 0; i < kInputSize; ++i) {
+    int key = key_dist(gen);
+    test.Insert(key, i);
+    check.emplace(key, i);
+  }
+  for (int round = 0; round < 50; ++round) {
+    int lo = key_dist(gen);
+    int hi = lo + key_dist(gen) % 100;
+    std::vector<std::pair<int, int>> erased;
+    size_t erased_count =
+        test.EraseRange(lo, hi, [&erased](const int& key, int& value) {
+          erased.emplace_back(key, value);
+        });
+    EXPECT_EQ(erased_count, erased.size());
+    std::vector<std::pair<int, int>> expected(check.lower_bound(lo),
+                                              check.lower_bound(hi));
+    check.erase(check.lower_bound(lo), check.lower_bound(hi));
+    ASSERT_THAT(erased, ElementsAreArray(expected));
+    ASSERT_EQ(test.Size(), check.size());
+  }
+  EXPECT_EQ(test.EraseRange(10, 5), 0);
+  EXPECT_EQ(test.EraseRange(-1, kInputSize + 1), check.size());
+  EXPECT_TRUE(test.Empty());
+  test.Insert(1, 1);
+  EXPECT_THAT(test.Find(1), NotNull());
+}
+
+TEST(TreapTest, InsertSortedKeepsValuePointers) {
+  std::vector<std::pair<int, int>> batch;
+  for (int key = 0; key < 100; key += 4) batch.emplace_back(key, -key);
+  for (uint64_t seed = 0; seed < 200; ++seed) {
+    alpa::Treap<int, int> test(seed);
+    HashedTreap hashed(seed);
+    for (int key = 0; key < 100; key += 10) {
+      test.Insert(key, key);
+      hashed.Insert(key, key);
+    }
+    int* value = test.Find(40);
+    int* hashed_value = hashed.Find(40);
+    test.InsertSorted(batch.begin(), batch.end());
+    hashed.InsertSorted(batch.begin(), batch.end());
+    ASSERT_EQ(test.Find(40), value);
+    ASSERT_EQ(*value, 40);
+    ASSERT_EQ(hashed.Find(40), hashed_value);
+    ASSERT_EQ(*hashed_value, 40);
+  }
+}
+
+TEST(TreapTest, KeyHashPriority) {
+  using KeyHashTreap =
+      alpa::Treap<int, int, void, alpa::KeyHashPriority<std::hash<int>>>;
+  constexpr int kInputSize = 3'000;
+  std::mt19937_64 gen(/*seed=*/kInputSize);
+  std::uniform_int_distribution<int> key_dist(0, kInputSize);
+  KeyHashTreap test;
+  std::map<int, int> check;
+  for (int i = 0; i < kInputSize; ++i) {
+    int key = key_dist(gen);
+    if (i % 3 == 0) {
+      EXPECT_EQ(test.Erase(key), check.erase(key) > 0);
+    } else {
+      test.Insert(key, i);
+      check.emplace(key, i);
+    }
+  }
+  std::map<int, int> batch;
+  for (int i = 0; i < kInputSize / 10; ++i) batch.emplace(key_dist(gen), -i);
+  test.InsertSorted(batch.begin(), batch.end());
+  check.insert(batch.begin(), batch.end());
+  ASSERT_EQ(test.Size(), check.size());
+  for (int key = 0; key <= kInputSize; ++key) {
+    auto it = check.find(key);
+    if (it == check.end()) {
+      ASSERT_THAT(test.Find(key), IsNull());
+    } else {
+      ASSERT_THAT(test.Find(key), NotNull());
+      ASSERT_EQ(*test.Find(key), it->second);
+    }
+  }
+}
@@ -0,0 +1,119 @@
+﻿#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+
+#include "algorithm_pack/ttl_cache.h"
+
+using ::testing::IsNull;
+using ::testing::NotNull;
+
+TEST(TtlCacheTest, ExpiresByTime) {
+  alpa::TtlCache<int, std::string> test(/*capacity=*/100, /*seed=*/1);
+  EXPECT_TRUE(test.Empty());
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_TRUE(test.Put(i, std::to_string(i), /*now=*/0,
+                         /*ttl=*/static_cast<uint64_t>(10 + i)));
+  }
+  ASSERT_THAT(test.Get(3, /*now=*/5), NotNull());
+  EXPECT_EQ(*test.Get(3, /*now=*/5), "3");
+  // Entry with expiry time 13 is dead at time 13
+  EXPECT_THAT(test.Get(3, /*now=*/13), IsNull());
+  EXPECT_EQ(test.Size(), 9);
+  EXPECT_EQ(test.Expire(/*now=*/14), 4);
+  EXPECT_EQ(test.Size(), 5);
+  EXPECT_EQ(test.Charge(), 5);
+  EXPECT_THAT(test.Get(5, /*now=*/14), NotNull());
+  // Replacement restarts time to live
+  EXPECT_TRUE(test.Put(5, "new", /*now=*/14, /*ttl=*/100));
+  EXPECT_EQ(test.Expire(/*now=*/50), 4);
+  ASSERT_THAT(test.Get(5, /*now=*/50), NotNull());
+  EXPECT_EQ(*test.Get(5, /*now=*/50), "new");
+  EXPECT_TRUE(test.Put(6, "forever", /*now=*/50,
+                       /*ttl=*/std::numeric_limits<uint64_t>::max()));
+  EXPECT_EQ(test.Expire(/*now=*/1'000), 1);
+  EXPECT_THAT(test.Get(6, /*now=*/1'000), NotNull());
+  EXPECT_EQ(test.Stats().expirations, 10);
+}
+
+TEST(TtlCacheTest, EvictsLeastRecentlyUsed) {
+  alpa::TtlCache<int, int> test(/*capacity=*/10, /*seed=*/1);
+  for (int i = 0; i < 10; ++i) test.Put(i, i, /*now=*/0, /*ttl=*/1'000);
+  ASSERT_THAT(test.Get(0, /*now=*/1), NotNull());
+  EXPECT_TRUE(test.Put(10, 10, /*now=*/2, /*ttl=*/1'000));
+  EXPECT_THAT(test.Get(1, /*now=*/3), IsNull());
+  EXPECT_THAT(test.Get(0, /*now=*/3), NotNull());
+  // Charges are accounted as memory: the large entry displaces four others
+  EXPECT_TRUE(test.Put(11, 11, /*now=*/4, /*ttl=*/1'000, /*charge=*/4));
+  EXPECT_EQ(test.Charge(), 10);
+  EXPECT_EQ(test.Size(), 7);
+  EXPECT_THAT(test.Get(5, /*now=*/5), IsNull());
+  EXPECT_THAT(test.Get(6, /*now=*/5), NotNull());
+  EXPECT_FALSE(test.Put(12, 12, /*now=*/6, /*ttl=*/1'000, /*charge=*/11));
+  EXPECT_EQ(test.Stats().evictions, 5);
+  EXPECT_TRUE(test.Put(13, 13, /*now=*/6, /*ttl=*/1));
+  EXPECT_EQ(test.Stats().evictions, 6);
+  // Expired entries are swept before the live ones are evicted
+  EXPECT_TRUE(test.Put(14, 14, /*now=*/10, /*ttl=*/1'000));
+  EXPECT_EQ(test.Stats().evictions, 6);
+  EXPECT_EQ(test.Stats().expirations, 1);
+}
+
+TEST(TtlCacheTest, ZeroTtlIsNotStored) {
+  alpa::TtlCache<int, int> test(/*capacity=*/2, /*seed=*/1);
+  EXPECT_TRUE(test.Put(1, 1, /*now=*/0, /*ttl=*/10));
+  EXPECT_TRUE(test.Put(2, 2, /*now=*/0, /*ttl=*/10));
+  // Dead entry neither evicts the live ones nor keeps the old value
+  EXPECT_FALSE(test.Put(3, 3, /*now=*/5, /*ttl=*/0));
+  EXPECT_FALSE(test.Put(1, -1, /*now=*/5, /*ttl=*/0));
+  EXPECT_THAT(test.Get(3, /*now=*/5), IsNull());
+  EXPECT_THAT(test.Get(1, /*now=*/5), IsNull());
+  ASSERT_THAT(test.Get(2, /*now=*/5), NotNull());
+  EXPECT_EQ(test.Size(), 1);
+  EXPECT_EQ(test.Charge(), 1);
+  EXPECT_EQ(test.Stats().evictions, 0);
+  EXPECT_EQ(test.Stats().expirations, 0);
+}
+
+TEST(TtlCacheTest, RandomOperationsWithMixedTtl) {
+  constexpr int kOperationCount = 20'000;
+  constexpr size_t kCapacity = 300;
+  std::mt19937_64 gen(/*seed=*/kOperationCount);
+  std::uniform_int_distribution<int> key_dist(0, 1'000);
+  std::uniform_int_distribution<uint64_t> ttl_dist(1, 500);
+  alpa::TtlCache<int, int> test(kCapacity, /*seed=*/1);
+  // Reference keeps value and expiry, recency is not checked here
+  std::map<int, std::pair<int, uint64_t>> check;
+  for (int i = 0; i < kOperationCount; ++i) {
+    auto now = static_cast<uint64_t>(i);
+    int key = key_dist(gen);
+    if (i % 2 == 0) {
+      uint64_t ttl = ttl_dist(gen);
+      ASSERT_TRUE(test.Put(key, i, now, ttl));
+      check[key] = {i, now + ttl};
+    } else {
+      int* found = test.Get(key, now);
+      auto it = check.find(key);
+      if (found) {
+        ASSERT_NE(it, check.end());
+        ASSERT_EQ(*found, it->second.first);
+        ASSERT_LT(now, it->second.second);
+      } else if (it != check.end() && it->second.second > now) {
+        // Alive entry can be missing only after eviction
+        ASSERT_GT(test.Stats().evictions, 0);
+      }
+    }
+    if (i % 100 == 0) test.Expire(now);
+    ASSERT_LE(test.Size(), kCapacity);
+    ASSERT_EQ(test.Charge(), test.Size());
+  }
+  EXPECT_GT(test.Stats().hits, 0);
+  test.Expire(std::numeric_limits<uint64_t>::max());
+  EXPECT_TRUE(test.Empty());
+}
@@ -0,0 +1,118 @@
+﻿#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <numeric>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "algorithm_pack/implicit_treap.h"
+#include "algorithm_pack/treap.h"
+#include "algorithm_pack/views.h"
+
+#if defined(__cpp_lib_ranges)
+#include <ranges>
+#endif
+
+using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
+
+#if defined(__cpp_lib_ranges)
+namespace {
+using TreapRange = decltype(std::declval<alpa::Treap<int, int>&>().Range(0, 0));
+using ConstTreapRange =
+    decltype(std::declval<const alpa::Treap<int, int>&>().Range(0, 0));
+using ImplicitRange =
+    decltype(std::declval<alpa::ImplicitTreap<int>&>().Range(0, 0));
+using ConstImplicitRange =
+    decltype(std::declval<const alpa::ImplicitTreap<int>&>().Range(0, 0));
+
+static_assert(std::ranges::view<TreapRange> &&
+              std::ranges::forward_range<TreapRange>);
+static_assert(std::ranges::view<ConstTreapRange> &&
+              std::ranges::forward_range<ConstTreapRange>);
+static_assert(std::ranges::view<ImplicitRange> &&
+              std::ranges::forward_range<ImplicitRange>);
+static_assert(std::ranges::view<ConstImplicitRange> &&
+              std::ranges::forward_range<ConstImplicitRange>);
+static_assert(std::ranges::view<alpa::ChunkView<ImplicitRange>> &&
+              std::ranges::forward_range<alpa::ChunkView<ImplicitRange>>);
+}  // namespace
+#endif
+
+TEST(ViewsTest, ChunksOfVector) {
+  std::vector<int> input(10);
+  std::iota(input.begin(), input.end(), 0);
+  alpa::IteratorRange range(input.begin(), input.end());
+  EXPECT_EQ(range.Size(), input.size());
+  std::vector<std::vector<int>> chunks;
+  for (const auto& chunk : alpa::Chunks(range, 4)) {
+    chunks.emplace_back(chunk.begin(), chunk.end());
+  }
+  EXPECT_THAT(chunks, ElementsAre(ElementsAre(0, 1, 2, 3),
+                                  ElementsAre(4, 5, 6, 7), ElementsAre(8, 9)));
+  alpa::IteratorRange empty(input.end(), input.end());
+  EXPECT_TRUE(empty.Empty());
+  auto empty_chunks = alpa::Chunks(empty, 3);
+  EXPECT_EQ(empty_chunks.begin(), empty_chunks.end());
+}
+
+TEST(ViewsTest, TreapKeyRange) {
+  constexpr int kInputSize = 5'000;
+  std::mt19937_64 gen(/*seed=*/kInputSize);
+  std::uniform_int_distribution<int> key_dist(0, kInputSize);
+  alpa::Treap<int, std::string> test(/*seed=*/1);
+  std::map<int, std::string> check;
+  for (int i = 0; i < kInputSize; ++i) {
+    int key = key_dist(gen);
+    test.Insert(key, std::to_string(i));
+    check.emplace(key, std::to_string(i));
+  }
+  for (int i = 0; i < 100; ++i) {
+    int lo = key_dist(gen) - 10;
+    int hi = key_dist(gen) + 10;
+    std::vector<std::pair<int, std::string>> expected;
+    if (lo < hi) {
+      expected.assign(check.lower_bound(lo), check.lower_bound(hi));
+    }
+    const auto& const_test = test;
+    EXPECT_THAT(const_test.Range(lo, hi), ElementsAreArray(expected));
+    EXPECT_THAT(test.Range(lo, hi), ElementsAreArray(expected));
+  }
+  EXPECT_THAT(test.Range(-2, -1), ElementsAre());
+  for (auto& [key, value] : test.Range(10, 20)) value = "changed";
+  for (int key = 10; key < 20; ++key) {
+    if (check.count(key) != 0) {
+      EXPECT_EQ(*test.Find(key), "changed");
+    }
+  }
+  alpa::Treap<int, int> empty;
+  EXPECT_THAT(empty.Range(0, 10), ElementsAre());
+}
+
+TEST(ViewsTest, ImplicitTreapChunkPipeline) {
+  constexpr int kInputSize = 1'000;
+  std::vector<int> input(kInputSize);
+  std::iota(input.begin(), input.end(), 0);
+  alpa::ImplicitTreap<int, std::hash<int>> test(input, /*seed=*/1);
+  const auto& const_test = test;
+  EXPECT_THAT(const_test.Range(100, 110),
+              ElementsAreArray(input.begin() + 100, input.begin() + 110));
+  EXPECT_THAT(test.Range(kInputSize, kInputSize), ElementsAre());
+  for (int& value : test.Range(0, 10)) value = -value;
+  EXPECT_EQ(test[9], -9);
+  // Consumer receives batches directly from the tree
+  std::vector<size_t> chunk_sizes;
+  int sum = 0;
+  for (const auto& chunk : alpa::Chunks(const_test.Range(10, 1'000), 64)) {
+    chunk_sizes.push_back(chunk.Size());
+    sum = std::accumulate(chunk.begin(), chunk.end(), sum);
+  }
+  EXPECT_EQ(chunk_sizes.size(), 16);
+  EXPECT_EQ(chunk_sizes.back(), 990 - 15 * 64);
+  EXPECT_EQ(sum, std::accumulate(input.begin() + 10, input.end(), 0));
+}